@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#endif
+
+// whole file write through a temporary next to path, which only replaces path in Commit once every byte made it
+// to disk - a crash, a full disk or a failed write leave the previous file untouched
+class AtomicFile
+{
+public:
+	explicit AtomicFile(const std::string& path)
+		: _path(path)
+		, _temporary_path(path + ".tmp")
+	{
+		_p_file = fopen(_temporary_path.c_str(), "wb");
+		_written = _p_file != nullptr;
+	}
+
+	// without Commit the temporary is discarded
+	~AtomicFile()
+	{
+		if (_p_file != nullptr)
+		{
+			fclose(_p_file);
+			remove(_temporary_path.c_str());
+		}
+	}
+
+	AtomicFile(const AtomicFile&) = delete;
+	AtomicFile& operator=(const AtomicFile&) = delete;
+
+	// a failure sticks, Commit reports it
+	void Write(const void* p_data, size_t size)
+	{
+		if (_written && size > 0)
+		{
+			_written = fwrite(p_data, size, 1, _p_file) == 1;
+			_position += size;
+		}
+	}
+
+	// zeros up to offset, e.g. to align the next blob
+	void PadTo(uint64_t offset)
+	{
+		static const uint8_t ZEROS[64] = {};
+
+		while (_written && _position < offset)
+		{
+			Write(ZEROS, static_cast<size_t>(offset - _position < sizeof(ZEROS) ? offset - _position : sizeof(ZEROS)));
+		}
+	}
+
+	// false when anything failed, path then still holds what it held before
+	bool Commit()
+	{
+		if (_p_file == nullptr)
+		{
+			return false;
+		}
+
+		bool written = fclose(_p_file) == 0 && _written;
+		_p_file = nullptr;
+
+		if (written && Replace())
+		{
+			return true;
+		}
+
+		remove(_temporary_path.c_str());
+		return false;
+	}
+
+private:
+	// a single call on either platform, so there is no moment without a file at path
+	bool Replace() const
+	{
+#ifdef _WIN32
+		return MoveFileExA(_temporary_path.c_str(), _path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		return rename(_temporary_path.c_str(), _path.c_str()) == 0;
+#endif
+	}
+
+	// BEGIN PRIVATE MEMBERS
+	std::string _path;
+	std::string _temporary_path;
+	FILE* _p_file = nullptr;
+	uint64_t _position = 0;
+	bool _written = false;
+	// END PRIVATE MEMBERS
+};
@@ -0,0 +1,535 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "ThreadPool.h"
+
+// block compressed formats the offline encoder writes - 4x4 texel blocks
+enum class BlockFormat : uint32_t
+{
+	BC1,	///< 8 bytes, rgb 565 endpoints with 2 bit indices, alpha ignored
+	BC3,	///< 16 bytes, bc1 color plus an 8 bit alpha ramp with 3 bit indices
+	BC7		///< 16 bytes, mode 6 only - rgba 7.7.7.7 endpoints with p-bits and 4 bit indices
+};
+
+// cpu block compression encoder - pca endpoints refined by least squares, good enough for offline cooking
+// without the exhaustive partition search of production bc7 encoders
+class BlockCompressor
+{
+public:
+	static uint32_t BlockBytes(BlockFormat format)
+	{
+		return format == BlockFormat::BC1 ? 8 : 16;
+	}
+
+	static uint64_t ImageBytes(BlockFormat format, uint32_t width, uint32_t height)
+	{
+		return static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+	}
+
+	// compresses a tightly packed RGBA8 image row of blocks by row of blocks on the pool, blocks reaching
+	// past the edge repeat the last texel. output receives ImageBytes bytes
+	static void CompressImage(BlockFormat format, const uint8_t* p_rgba, uint32_t width, uint32_t height, uint8_t* p_output, ThreadPool& thread_pool)
+	{
+		const uint32_t blocks_x = (width + 3) / 4;
+		const uint32_t blocks_y = (height + 3) / 4;
+		const uint32_t block_bytes = BlockBytes(format);
+
+		thread_pool.ParallelFor(blocks_y, [&](uint32_t block_y)
+		{
+			uint8_t texels[64];
+
+			for (uint32_t block_x = 0; block_x < blocks_x; ++block_x)
+			{
+				for (uint32_t y = 0; y < 4; ++y)
+				{
+					uint32_t source_y = std::min(block_y * 4 + y, height - 1);
+
+					for (uint32_t x = 0; x < 4; ++x)
+					{
+						uint32_t source_x = std::min(block_x * 4 + x, width - 1);
+						memcpy(texels + (y * 4 + x) * 4, p_rgba + (static_cast<size_t>(source_y) * width + source_x) * 4, 4);
+					}
+				}
+
+				CompressBlock(format, texels, p_output + (static_cast<size_t>(block_y) * blocks_x + block_x) * block_bytes);
+			}
+		});
+	}
+
+	// texels are 16 RGBA8 values in row order
+	static void CompressBlock(BlockFormat format, const uint8_t texels[64], uint8_t* p_output)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1:
+			EncodeColorBlock(texels, p_output);
+			break;
+		case BlockFormat::BC3:
+			EncodeAlphaBlock(texels, p_output);
+			EncodeColorBlock(texels, p_output + 8);
+			break;
+		case BlockFormat::BC7:
+			EncodeMode6Block(texels, p_output);
+			break;
+		}
+	}
+
+private:
+	static const uint32_t REFINE_ITERATIONS = 2;
+
+	// dominant direction of the texel cloud through power iteration on the covariance matrix
+	template<uint32_t CHANNELS>
+	static void PrincipalAxis(const float (*p_texels)[4], float mean[CHANNELS], float axis[CHANNELS])
+	{
+		for (uint32_t c = 0; c < CHANNELS; ++c)
+		{
+			mean[c] = 0.0f;
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				mean[c] += p_texels[i][c];
+			}
+			mean[c] /= 16.0f;
+		}
+
+		float covariance[CHANNELS][CHANNELS] = {};
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			for (uint32_t a = 0; a < CHANNELS; ++a)
+			{
+				for (uint32_t b = 0; b < CHANNELS; ++b)
+				{
+					covariance[a][b] += (p_texels[i][a] - mean[a]) * (p_texels[i][b] - mean[b]);
+				}
+			}
+		}
+
+		for (uint32_t c = 0; c < CHANNELS; ++c)
+		{
+			axis[c] = 1.0f;
+		}
+
+		for (uint32_t iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[CHANNELS] = {};
+			float length = 0.0f;
+
+			for (uint32_t a = 0; a < CHANNELS; ++a)
+			{
+				for (uint32_t b = 0; b < CHANNELS; ++b)
+				{
+					next[a] += covariance[a][b] * axis[b];
+				}
+				length = std::max(length, fabsf(next[a]));
+			}
+
+			// a flat block has no direction, the endpoints then collapse onto the mean
+			if (length < 1e-6f)
+			{
+				for (uint32_t c = 0; c < CHANNELS; ++c)
+				{
+					axis[c] = 0.0f;
+				}
+				return;
+			}
+
+			for (uint32_t c = 0; c < CHANNELS; ++c)
+			{
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float length = 0.0f;
+		for (uint32_t c = 0; c < CHANNELS; ++c)
+		{
+			length += axis[c] * axis[c];
+		}
+		length = sqrtf(length);
+
+		for (uint32_t c = 0; c < CHANNELS; ++c)
+		{
+			axis[c] /= length;
+		}
+	}
+
+	// endpoints at the extreme projections of the texels onto the principal axis
+	template<uint32_t CHANNELS>
+	static void AxisEndpoints(const float (*p_texels)[4], float endpoint_0[CHANNELS], float endpoint_1[CHANNELS])
+	{
+		float mean[CHANNELS];
+		float axis[CHANNELS];
+		PrincipalAxis<CHANNELS>(p_texels, mean, axis);
+
+		float min_t = std::numeric_limits<float>::max();
+		float max_t = -std::numeric_limits<float>::max();
+
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			float t = 0.0f;
+			for (uint32_t c = 0; c < CHANNELS; ++c)
+			{
+				t += (p_texels[i][c] - mean[c]) * axis[c];
+			}
+			min_t = std::min(min_t, t);
+			max_t = std::max(max_t, t);
+		}
+
+		for (uint32_t c = 0; c < CHANNELS; ++c)
+		{
+			endpoint_0[c] = std::min(std::max(mean[c] + axis[c] * max_t, 0.0f), 255.0f);
+			endpoint_1[c] = std::min(std::max(mean[c] + axis[c] * min_t, 0.0f), 255.0f);
+		}
+	}
+
+	// least squares endpoints for fixed indices - weights[i] is how much of endpoint 0 texel i gets
+	// returns false when the weights cannot separate the endpoints
+	template<uint32_t CHANNELS>
+	static bool RefitEndpoints(const float (*p_texels)[4], const float weights[16], float endpoint_0[CHANNELS], float endpoint_1[CHANNELS])
+	{
+		float aa = 0.0f;
+		float bb = 0.0f;
+		float ab = 0.0f;
+		float ax[CHANNELS] = {};
+		float bx[CHANNELS] = {};
+
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			float a = weights[i];
+			float b = 1.0f - a;
+			aa += a * a;
+			bb += b * b;
+			ab += a * b;
+
+			for (uint32_t c = 0; c < CHANNELS; ++c)
+			{
+				ax[c] += a * p_texels[i][c];
+				bx[c] += b * p_texels[i][c];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) < 1e-6f)
+		{
+			return false;
+		}
+
+		for (uint32_t c = 0; c < CHANNELS; ++c)
+		{
+			endpoint_0[c] = std::min(std::max((ax[c] * bb - bx[c] * ab) / determinant, 0.0f), 255.0f);
+			endpoint_1[c] = std::min(std::max((bx[c] * aa - ax[c] * ab) / determinant, 0.0f), 255.0f);
+		}
+
+		return true;
+	}
+
+	static uint16_t PackColor565(const float color[3])
+	{
+		uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+		uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+		uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	static void UnpackColor565(uint16_t packed, int32_t color[3])
+	{
+		int32_t r = (packed >> 11) & 31;
+		int32_t g = (packed >> 5) & 63;
+		int32_t b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// bc1 color block in four color mode (color 0 > color 1), also the color half of bc3
+	static void EncodeColorBlock(const uint8_t texels[64], uint8_t* p_output)
+	{
+		float colors[16][4];
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				colors[i][c] = texels[i * 4 + c];
+			}
+		}
+
+		float endpoint_0[3];
+		float endpoint_1[3];
+		AxisEndpoints<3>(colors, endpoint_0, endpoint_1);
+
+		static const float WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+		uint16_t best_packed[2] = { 0, 0 };
+		uint32_t best_indices = 0;
+		int64_t best_error = std::numeric_limits<int64_t>::max();
+
+		for (uint32_t iteration = 0; iteration <= REFINE_ITERATIONS; ++iteration)
+		{
+			uint16_t packed[2] = { PackColor565(endpoint_0), PackColor565(endpoint_1) };
+
+			// color 0 must compare greater or the block decodes in three color mode
+			if (packed[0] < packed[1])
+			{
+				std::swap(packed[0], packed[1]);
+			}
+
+			int32_t palette[4][3];
+			UnpackColor565(packed[0], palette[0]);
+			UnpackColor565(packed[1], palette[1]);
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			// equal endpoints decode as three color mode, index 0 is still color 0 there
+			uint32_t palette_size = packed[0] == packed[1] ? 1 : 4;
+
+			uint32_t indices = 0;
+			int64_t error = 0;
+			float weights[16];
+
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				uint32_t best_index = 0;
+				int32_t best_distance = std::numeric_limits<int32_t>::max();
+
+				for (uint32_t index = 0; index < palette_size; ++index)
+				{
+					int32_t distance = 0;
+					for (uint32_t c = 0; c < 3; ++c)
+					{
+						int32_t delta = texels[i * 4 + c] - palette[index][c];
+						distance += delta * delta;
+					}
+
+					if (distance < best_distance)
+					{
+						best_distance = distance;
+						best_index = index;
+					}
+				}
+
+				indices |= best_index << (2 * i);
+				error += best_distance;
+				weights[i] = WEIGHTS[best_index];
+			}
+
+			if (error < best_error)
+			{
+				best_error = error;
+				best_indices = indices;
+				best_packed[0] = packed[0];
+				best_packed[1] = packed[1];
+			}
+
+			if (error == 0 || !RefitEndpoints<3>(colors, weights, endpoint_0, endpoint_1))
+			{
+				break;
+			}
+		}
+
+		memcpy(p_output, &best_packed[0], 2);
+		memcpy(p_output + 2, &best_packed[1], 2);
+		memcpy(p_output + 4, &best_indices, 4);
+	}
+
+	// bc4 style alpha ramp in eight value mode, the alpha half of bc3
+	static void EncodeAlphaBlock(const uint8_t texels[64], uint8_t* p_output)
+	{
+		int32_t alpha_min = 255;
+		int32_t alpha_max = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			alpha_min = std::min<int32_t>(alpha_min, texels[i * 4 + 3]);
+			alpha_max = std::max<int32_t>(alpha_max, texels[i * 4 + 3]);
+		}
+
+		int32_t palette[8];
+		palette[0] = alpha_max;
+		palette[1] = alpha_min;
+		for (int32_t i = 1; i < 7; ++i)
+		{
+			palette[i + 1] = ((7 - i) * alpha_max + i * alpha_min) / 7;
+		}
+
+		uint64_t indices = 0;
+		if (alpha_max != alpha_min)
+		{
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				uint32_t best_index = 0;
+				int32_t best_distance = std::numeric_limits<int32_t>::max();
+
+				for (uint32_t index = 0; index < 8; ++index)
+				{
+					int32_t distance = std::abs(texels[i * 4 + 3] - palette[index]);
+					if (distance < best_distance)
+					{
+						best_distance = distance;
+						best_index = index;
+					}
+				}
+
+				indices |= static_cast<uint64_t>(best_index) << (3 * i);
+			}
+		}
+
+		p_output[0] = static_cast<uint8_t>(alpha_max);
+		p_output[1] = static_cast<uint8_t>(alpha_min);
+		for (uint32_t byte = 0; byte < 6; ++byte)
+		{
+			p_output[2 + byte] = static_cast<uint8_t>(indices >> (8 * byte));
+		}
+	}
+
+	static void WriteBits(uint8_t* p_block, uint32_t& position, uint32_t value, uint32_t bit_count)
+	{
+		for (uint32_t bit = 0; bit < bit_count; ++bit, ++position)
+		{
+			p_block[position >> 3] |= static_cast<uint8_t>(((value >> bit) & 1) << (position & 7));
+		}
+	}
+
+	// bc7 mode 6 - one subset, rgba endpoints of 7 bits plus a shared low bit per endpoint, 4 bit indices
+	static void EncodeMode6Block(const uint8_t texels[64], uint8_t* p_output)
+	{
+		static const int32_t WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		float colors[16][4];
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				colors[i][c] = texels[i * 4 + c];
+			}
+		}
+
+		float endpoint_0[4];
+		float endpoint_1[4];
+		AxisEndpoints<4>(colors, endpoint_0, endpoint_1);
+
+		int32_t best_quantized[2][4] = {};
+		uint32_t best_p_bits[2] = { 0, 0 };
+		uint8_t best_indices[16] = {};
+		int64_t best_error = std::numeric_limits<int64_t>::max();
+
+		for (uint32_t iteration = 0; iteration <= REFINE_ITERATIONS; ++iteration)
+		{
+			int64_t iteration_error = std::numeric_limits<int64_t>::max();
+			uint8_t iteration_indices[16] = {};
+
+			// the p-bits are shared by all channels of an endpoint, try every combination
+			for (uint32_t p_bits = 0; p_bits < 4; ++p_bits)
+			{
+				uint32_t p_0 = p_bits & 1;
+				uint32_t p_1 = p_bits >> 1;
+
+				int32_t quantized[2][4];
+				int32_t palette[16][4];
+
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					quantized[0][c] = std::min(std::max(static_cast<int32_t>((endpoint_0[c] - p_0) / 2.0f + 0.5f), 0), 127);
+					quantized[1][c] = std::min(std::max(static_cast<int32_t>((endpoint_1[c] - p_1) / 2.0f + 0.5f), 0), 127);
+
+					int32_t value_0 = (quantized[0][c] << 1) | static_cast<int32_t>(p_0);
+					int32_t value_1 = (quantized[1][c] << 1) | static_cast<int32_t>(p_1);
+
+					for (uint32_t index = 0; index < 16; ++index)
+					{
+						palette[index][c] = ((64 - WEIGHTS[index]) * value_0 + WEIGHTS[index] * value_1 + 32) >> 6;
+					}
+				}
+
+				uint8_t indices[16];
+				int64_t error = 0;
+
+				for (uint32_t i = 0; i < 16; ++i)
+				{
+					int32_t best_distance = std::numeric_limits<int32_t>::max();
+
+					for (uint32_t index = 0; index < 16; ++index)
+					{
+						int32_t distance = 0;
+						for (uint32_t c = 0; c < 4; ++c)
+						{
+							int32_t delta = texels[i * 4 + c] - palette[index][c];
+							distance += delta * delta;
+						}
+
+						if (distance < best_distance)
+						{
+							best_distance = distance;
+							indices[i] = static_cast<uint8_t>(index);
+						}
+					}
+
+					error += best_distance;
+				}
+
+				if (error < iteration_error)
+				{
+					iteration_error = error;
+					memcpy(iteration_indices, indices, sizeof(indices));
+				}
+
+				if (error < best_error)
+				{
+					best_error = error;
+					memcpy(best_quantized, quantized, sizeof(quantized));
+					best_p_bits[0] = p_0;
+					best_p_bits[1] = p_1;
+					memcpy(best_indices, indices, sizeof(indices));
+				}
+			}
+
+			float weights[16];
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				weights[i] = 1.0f - WEIGHTS[iteration_indices[i]] / 64.0f;
+			}
+
+			if (best_error == 0 || !RefitEndpoints<4>(colors, weights, endpoint_0, endpoint_1))
+			{
+				break;
+			}
+		}
+
+		// the anchor texel's index is stored with an implicit zero top bit - swap the endpoints when it is set
+		if (best_indices[0] & 8)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				std::swap(best_quantized[0][c], best_quantized[1][c]);
+			}
+			std::swap(best_p_bits[0], best_p_bits[1]);
+
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				best_indices[i] = static_cast<uint8_t>(15 - best_indices[i]);
+			}
+		}
+
+		memset(p_output, 0, 16);
+		uint32_t position = 0;
+
+		WriteBits(p_output, position, 1 << 6, 7);
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			WriteBits(p_output, position, static_cast<uint32_t>(best_quantized[0][c]), 7);
+			WriteBits(p_output, position, static_cast<uint32_t>(best_quantized[1][c]), 7);
+		}
+		WriteBits(p_output, position, best_p_bits[0], 1);
+		WriteBits(p_output, position, best_p_bits[1], 1);
+
+		WriteBits(p_output, position, best_indices[0], 3);
+		for (uint32_t i = 1; i < 16; ++i)
+		{
+			WriteBits(p_output, position, best_indices[i], 4);
+		}
+	}
+};
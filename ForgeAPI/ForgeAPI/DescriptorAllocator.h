@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// linear descriptor set allocation for one frame in flight - sets are never freed one by one, Reset returns every
+// pool at once after the fence of the frame has signaled. a full pool moves on to the next one, pools are only
+// created when every existing one is full, so a steady frame allocates from warm pools without touching the driver
+class DescriptorAllocator
+{
+public:
+	// pool_sizes are per set - each pool has room for sets_per_pool sets of that size
+	void Initialize(VkDevice device, const std::vector<VkDescriptorPoolSize>& pool_sizes, uint32_t sets_per_pool)
+	{
+		_vk_device = device;
+		_sets_per_pool = sets_per_pool;
+		_pool_sizes = pool_sizes;
+
+		for (VkDescriptorPoolSize& pool_size : _pool_sizes)
+		{
+			pool_size.descriptorCount *= sets_per_pool;
+		}
+
+		_current = 0;
+	}
+
+	void Release()
+	{
+		for (VkDescriptorPool pool : _pools)
+		{
+			vkDestroyDescriptorPool(_vk_device, pool, nullptr);
+		}
+		_pools.clear();
+		_current = 0;
+	}
+
+	// invalidates every set allocated since the last reset - only once nothing pending references them
+	void Reset()
+	{
+		for (uint32_t i = 0; i < _pools.size() && i <= _current; ++i)
+		{
+			vkResetDescriptorPool(_vk_device, _pools[i], 0);
+		}
+
+		_current = 0;
+		_allocated_sets = 0;
+	}
+
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout)
+	{
+		VkDescriptorSetAllocateInfo alloc_info = {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		alloc_info.descriptorSetCount = 1;
+		alloc_info.pSetLayouts = &layout;
+
+		for (;;)
+		{
+			bool fresh_pool = _current == _pools.size();
+
+			if (fresh_pool)
+			{
+				_pools.push_back(CreatePool());
+			}
+
+			alloc_info.descriptorPool = _pools[_current];
+
+			VkDescriptorSet descriptor_set;
+			if (vkAllocateDescriptorSets(_vk_device, &alloc_info, &descriptor_set) == VK_SUCCESS)
+			{
+				++_allocated_sets;
+				return descriptor_set;
+			}
+
+			// out of pool memory or fragmented, 1.0 drivers may report either as out of memory
+			if (fresh_pool)
+			{
+				throw std::runtime_error("Failed To Allocate Descriptor Set!");
+			}
+
+			++_current;
+		}
+	}
+
+	uint32_t PoolCount() const
+	{
+		return static_cast<uint32_t>(_pools.size());
+	}
+
+	// since the last reset
+	uint32_t AllocatedSets() const
+	{
+		return _allocated_sets;
+	}
+
+private:
+	VkDescriptorPool CreatePool() const
+	{
+		VkDescriptorPoolCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		create_info.poolSizeCount = static_cast<uint32_t>(_pool_sizes.size());
+		create_info.pPoolSizes = _pool_sizes.data();
+		create_info.maxSets = _sets_per_pool;
+
+		VkDescriptorPool pool;
+		if (vkCreateDescriptorPool(_vk_device, &create_info, nullptr, &pool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Descriptor Pool!");
+		}
+
+		return pool;
+	}
+
+	// BEGIN PRIVATE MEMBERS
+	VkDevice _vk_device = VK_NULL_HANDLE;
+	std::vector<VkDescriptorPoolSize> _pool_sizes;	///< already multiplied by _sets_per_pool
+	uint32_t _sets_per_pool = 0;
+	std::vector<VkDescriptorPool> _pools;
+	uint32_t _current = 0;	///< pools before it are full
+	uint32_t _allocated_sets = 0;
+	// END PRIVATE MEMBERS
+};
@@ -0,0 +1,356 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "TlsfRangeAllocator.h"
+
+// linear resources (buffers, linear images) and optimal images must not share a bufferImageGranularity page
+enum class ResourceKind : uint32_t
+{
+	Linear,
+	Optimal,
+	Count
+};
+
+struct GpuAllocation
+{
+	VkDeviceMemory _memory = VK_NULL_HANDLE;	///< shared with other allocations unless dedicated - DO NOT FREE DIRECTLY
+	VkDeviceSize _offset = 0;
+	VkDeviceSize _size = 0;
+	void* _p_mapped = nullptr;					///< persistently mapped pointer at _offset, host visible memory only
+	uint32_t _pool_index = UINT32_MAX;			///< UINT32_MAX for dedicated allocations
+	uint32_t _block_index = 0;
+	uint32_t _range_handle = TlsfRangeAllocator::INVALID_HANDLE;
+};
+
+struct AllocatorStatistics
+{
+	uint32_t _device_allocation_count = 0;	///< live vkAllocateMemory calls, blocks plus dedicated
+	uint32_t _block_count = 0;
+	uint32_t _dedicated_count = 0;
+	uint32_t _allocation_count = 0;			///< resources currently placed
+	VkDeviceSize _reserved_bytes = 0;		///< device memory owned by the allocator
+	VkDeviceSize _used_bytes = 0;			///< bytes handed out to resources
+	uint64_t _total_allocations = 0;		///< lifetime allocate calls
+};
+
+// sub-allocates resources out of large device memory blocks, one pool of blocks per memory type and resource kind
+// each block is managed by a TlsfRangeAllocator, large resources get a dedicated vkAllocateMemory
+class DeviceMemoryAllocator
+{
+public:
+	static const VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+	void Initialize(VkPhysicalDevice physical_device, VkDevice logical_device)
+	{
+		_vk_logical_device = logical_device;
+
+		vkGetPhysicalDeviceMemoryProperties(physical_device, &_memory_properties);
+
+		VkPhysicalDeviceProperties device_properties;
+		vkGetPhysicalDeviceProperties(physical_device, &device_properties);
+		_buffer_image_granularity = device_properties.limits.bufferImageGranularity;
+		_max_allocation_count = device_properties.limits.maxMemoryAllocationCount;
+
+		_pools.clear();
+		_pools.resize(_memory_properties.memoryTypeCount * static_cast<uint32_t>(ResourceKind::Count));
+
+		// small heaps (e.g. host visible device local windows) get proportionally smaller blocks
+		for (uint32_t i = 0; i < _memory_properties.memoryTypeCount; ++i)
+		{
+			VkDeviceSize heap_size = _memory_properties.memoryHeaps[_memory_properties.memoryTypes[i].heapIndex].size;
+			VkDeviceSize block_size = std::min(DEFAULT_BLOCK_SIZE, heap_size / 8);
+
+			for (uint32_t kind = 0; kind < static_cast<uint32_t>(ResourceKind::Count); ++kind)
+			{
+				_pools[i * static_cast<uint32_t>(ResourceKind::Count) + kind]._memory_type_index = i;
+				_pools[i * static_cast<uint32_t>(ResourceKind::Count) + kind]._block_size = block_size;
+			}
+		}
+	}
+
+	// frees every block - all allocations must have been freed already
+	void Release()
+	{
+		for (auto& pool : _pools)
+		{
+			for (auto& block : pool._blocks)
+			{
+				if (block._memory != VK_NULL_HANDLE)
+				{
+					vkFreeMemory(_vk_logical_device, block._memory, nullptr);
+				}
+			}
+
+			pool._blocks.clear();
+		}
+
+		_statistics = AllocatorStatistics();
+	}
+
+	GpuAllocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind, bool prefer_dedicated = false)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		uint32_t memory_type_index = FindMemoryType(requirements.memoryTypeBits, properties);
+		uint32_t pool_index = PoolIndex(memory_type_index, kind);
+		MemoryPool& pool = _pools[pool_index];
+
+		++_statistics._total_allocations;
+
+		if (prefer_dedicated || requirements.size > pool._block_size / 2)
+		{
+			return AllocateDedicated(requirements.size, memory_type_index);
+		}
+
+		GpuAllocation allocation;
+		allocation._pool_index = pool_index;
+		allocation._size = requirements.size;
+
+		// first fit over existing blocks, newest blocks are the emptiest
+		for (uint32_t i = static_cast<uint32_t>(pool._blocks.size()); i-- > 0;)
+		{
+			MemoryBlock& block = pool._blocks[i];
+
+			if (block._memory != VK_NULL_HANDLE && block._ranges.Allocate(requirements.size, requirements.alignment, allocation._offset, allocation._range_handle))
+			{
+				allocation._block_index = i;
+				return FinishBlockAllocation(pool, allocation);
+			}
+		}
+
+		// no room anywhere - open a new block
+		allocation._block_index = CreateBlock(pool);
+		MemoryBlock& block = pool._blocks[allocation._block_index];
+
+		if (!block._ranges.Allocate(requirements.size, requirements.alignment, allocation._offset, allocation._range_handle))
+		{
+			throw std::runtime_error("Failed To Sub-Allocate Device Memory!");
+		}
+
+		return FinishBlockAllocation(pool, allocation);
+	}
+
+	void Free(GpuAllocation& allocation)
+	{
+		if (allocation._memory == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		--_statistics._allocation_count;
+		_statistics._used_bytes -= allocation._size;
+
+		if (allocation._pool_index == UINT32_MAX)
+		{
+			vkFreeMemory(_vk_logical_device, allocation._memory, nullptr);
+
+			--_statistics._device_allocation_count;
+			--_statistics._dedicated_count;
+			_statistics._reserved_bytes -= allocation._size;
+		}
+		else
+		{
+			MemoryPool& pool = _pools[allocation._pool_index];
+			MemoryBlock& block = pool._blocks[allocation._block_index];
+
+			block._ranges.Free(allocation._range_handle);
+
+			// keep one empty block per pool around so alloc/free cycles don't hit the driver
+			if (block._ranges.Empty() && CountEmptyBlocks(pool) > 1)
+			{
+				DestroyBlock(block);
+			}
+		}
+
+		allocation = GpuAllocation();
+	}
+
+	const AllocatorStatistics& Statistics() const
+	{
+		return _statistics;
+	}
+
+	void PrintStatistics(std::ostream& stream) const
+	{
+		stream << "Device Memory: " << _statistics._device_allocation_count << "/" << _max_allocation_count << " device allocations ("
+			<< _statistics._block_count << " blocks, " << _statistics._dedicated_count << " dedicated) | "
+			<< _statistics._allocation_count << " resources | "
+			<< _statistics._used_bytes / 1024 << " KiB used of " << _statistics._reserved_bytes / 1024 << " KiB reserved | "
+			<< _statistics._total_allocations << " allocations total" << std::endl;
+	}
+
+private:
+	struct MemoryBlock
+	{
+		VkDeviceMemory _memory = VK_NULL_HANDLE;	///< VK_NULL_HANDLE once released, the slot is reused
+		void* _p_mapped = nullptr;
+		TlsfRangeAllocator _ranges;
+	};
+
+	struct MemoryPool
+	{
+		uint32_t _memory_type_index = 0;
+		VkDeviceSize _block_size = DEFAULT_BLOCK_SIZE;
+		std::vector<MemoryBlock> _blocks;
+	};
+
+	uint32_t PoolIndex(uint32_t memory_type_index, ResourceKind kind) const
+	{
+		// with a granularity of 1 linear and optimal resources may be neighbours, so share blocks
+		if (_buffer_image_granularity <= 1)
+		{
+			kind = ResourceKind::Linear;
+		}
+
+		return memory_type_index * static_cast<uint32_t>(ResourceKind::Count) + static_cast<uint32_t>(kind);
+	}
+
+	uint32_t FindMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties) const
+	{
+		for (uint32_t i = 0; i < _memory_properties.memoryTypeCount; ++i)
+		{
+			if (type_filter & (1 << i) && (_memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+			{
+				return i;
+			}
+		}
+
+		throw std::runtime_error("Failed To Find Suitable Memory Type!");
+	}
+
+	bool IsHostVisible(uint32_t memory_type_index) const
+	{
+		return (_memory_properties.memoryTypes[memory_type_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+	}
+
+	VkDeviceMemory AllocateDeviceMemory(VkDeviceSize size, uint32_t memory_type_index, void** pp_mapped)
+	{
+		if (_statistics._device_allocation_count >= _max_allocation_count)
+		{
+			throw std::runtime_error("Device Memory Allocation Count Exhausted!");
+		}
+
+		VkMemoryAllocateInfo alloc_info = {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		alloc_info.allocationSize = size;
+		alloc_info.memoryTypeIndex = memory_type_index;
+
+		VkDeviceMemory memory;
+		if (vkAllocateMemory(_vk_logical_device, &alloc_info, nullptr, &memory) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Allocate Device Memory!");
+		}
+
+		// host visible memory stays mapped for its whole lifetime - a VkDeviceMemory can only be mapped once
+		*pp_mapped = nullptr;
+		if (IsHostVisible(memory_type_index) && vkMapMemory(_vk_logical_device, memory, 0, VK_WHOLE_SIZE, 0, pp_mapped) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Map Device Memory!");
+		}
+
+		++_statistics._device_allocation_count;
+		_statistics._reserved_bytes += size;
+
+		return memory;
+	}
+
+	GpuAllocation AllocateDedicated(VkDeviceSize size, uint32_t memory_type_index)
+	{
+		GpuAllocation allocation;
+		allocation._size = size;
+		allocation._memory = AllocateDeviceMemory(size, memory_type_index, &allocation._p_mapped);
+
+		++_statistics._dedicated_count;
+		++_statistics._allocation_count;
+		_statistics._used_bytes += size;
+
+		return allocation;
+	}
+
+	uint32_t CreateBlock(MemoryPool& pool)
+	{
+		// reuse a released slot so block indices held by live allocations stay valid
+		uint32_t index = static_cast<uint32_t>(pool._blocks.size());
+		for (uint32_t i = 0; i < pool._blocks.size(); ++i)
+		{
+			if (pool._blocks[i]._memory == VK_NULL_HANDLE)
+			{
+				index = i;
+				break;
+			}
+		}
+
+		if (index == pool._blocks.size())
+		{
+			pool._blocks.push_back(MemoryBlock());
+		}
+
+		MemoryBlock& block = pool._blocks[index];
+		block._memory = AllocateDeviceMemory(pool._block_size, pool._memory_type_index, &block._p_mapped);
+		block._ranges.Reset(pool._block_size);
+
+		++_statistics._block_count;
+
+		return index;
+	}
+
+	void DestroyBlock(MemoryBlock& block)
+	{
+		vkFreeMemory(_vk_logical_device, block._memory, nullptr);
+
+		--_statistics._device_allocation_count;
+		--_statistics._block_count;
+		_statistics._reserved_bytes -= block._ranges.Size();
+
+		block._memory = VK_NULL_HANDLE;
+		block._p_mapped = nullptr;
+		block._ranges.Reset(0);
+	}
+
+	uint32_t CountEmptyBlocks(const MemoryPool& pool) const
+	{
+		uint32_t count = 0;
+		for (const auto& block : pool._blocks)
+		{
+			if (block._memory != VK_NULL_HANDLE && block._ranges.Empty())
+			{
+				++count;
+			}
+		}
+		return count;
+	}
+
+	GpuAllocation& FinishBlockAllocation(MemoryPool& pool, GpuAllocation& allocation)
+	{
+		MemoryBlock& block = pool._blocks[allocation._block_index];
+
+		allocation._memory = block._memory;
+		allocation._p_mapped = block._p_mapped != nullptr ? static_cast<char*>(block._p_mapped) + allocation._offset : nullptr;
+
+		++_statistics._allocation_count;
+		_statistics._used_bytes += allocation._size;
+
+		return allocation;
+	}
+
+	// BEGIN PRIVATE MEMBERS
+	VkDevice _vk_logical_device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties _memory_properties = {};
+	VkDeviceSize _buffer_image_granularity = 1;
+	uint32_t _max_allocation_count = 4096;
+
+	std::vector<MemoryPool> _pools;	///< [memory type * ResourceKind::Count + kind]
+	AllocatorStatistics _statistics;
+	std::mutex _mutex;
+	// END PRIVATE MEMBERS
+};
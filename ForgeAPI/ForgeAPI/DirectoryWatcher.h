@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// reports which of a fixed set of files in one directory were rewritten, without ever blocking
+// inotify on linux, a change notification plus modification times on windows, unsupported elsewhere
+class DirectoryWatcher
+{
+public:
+	DirectoryWatcher() = default;
+
+	~DirectoryWatcher()
+	{
+		Close();
+	}
+
+	DirectoryWatcher(const DirectoryWatcher&) = delete;
+	DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+	// names are relative to directory, false when the directory cannot be watched
+	bool Open(const std::string& directory, const std::vector<std::string>& names)
+	{
+		Close();
+
+		_directory = directory;
+		_names = names;
+
+#ifdef _WIN32
+		_last_write_times.resize(_names.size());
+		for (size_t i = 0; i < _names.size(); ++i)
+		{
+			_last_write_times[i] = LastWriteTime(i);
+		}
+
+		_handle = FindFirstChangeNotificationA(directory.c_str(), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+		if (_handle == INVALID_HANDLE_VALUE)
+		{
+			_handle = nullptr;
+			return false;
+		}
+#elif defined(__linux__)
+		_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (_descriptor < 0)
+		{
+			return false;
+		}
+
+		// close after writing covers editors that write in place, moved to the ones that save through a rename
+		if (inotify_add_watch(_descriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+		{
+			Close();
+			return false;
+		}
+#else
+		return false;
+#endif
+
+		return true;
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		if (_handle != nullptr)
+		{
+			FindCloseChangeNotification(_handle);
+		}
+		_handle = nullptr;
+#elif defined(__linux__)
+		if (_descriptor >= 0)
+		{
+			close(_descriptor);
+		}
+		_descriptor = -1;
+#endif
+	}
+
+	bool IsOpen() const
+	{
+#ifdef _WIN32
+		return _handle != nullptr;
+#elif defined(__linux__)
+		return _descriptor >= 0;
+#else
+		return false;
+#endif
+	}
+
+	// appends the watched names changed since the last call, each at most once
+	void Poll(std::vector<std::string>& changed)
+	{
+		std::vector<bool> seen(_names.size(), false);
+
+#ifdef _WIN32
+		if (_handle == nullptr || WaitForSingleObject(_handle, 0) != WAIT_OBJECT_0)
+		{
+			return;
+		}
+
+		// rearm before comparing, a write landing in between is caught by the next call
+		FindNextChangeNotification(_handle);
+
+		for (size_t i = 0; i < _names.size(); ++i)
+		{
+			uint64_t last_write_time = LastWriteTime(i);
+			seen[i] = last_write_time != _last_write_times[i];
+			_last_write_times[i] = last_write_time;
+		}
+#elif defined(__linux__)
+		if (_descriptor < 0)
+		{
+			return;
+		}
+
+		alignas(inotify_event) char buffer[4096];
+
+		for (;;)
+		{
+			ssize_t length = read(_descriptor, buffer, sizeof(buffer));
+			if (length <= 0)
+			{
+				break;
+			}
+
+			for (ssize_t offset = 0; offset < length; )
+			{
+				const inotify_event* p_event = reinterpret_cast<const inotify_event*>(buffer + offset);
+				offset += sizeof(inotify_event) + p_event->len;
+
+				for (size_t i = 0; p_event->len > 0 && i < _names.size(); ++i)
+				{
+					seen[i] = seen[i] || _names[i] == p_event->name;
+				}
+			}
+		}
+#endif
+
+		for (size_t i = 0; i < _names.size(); ++i)
+		{
+			if (seen[i])
+			{
+				changed.push_back(_names[i]);
+			}
+		}
+	}
+
+private:
+#ifdef _WIN32
+	// 0 when the file does not exist
+	uint64_t LastWriteTime(size_t name_index) const
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (!GetFileAttributesExA((_directory + "/" + _names[name_index]).c_str(), GetFileExInfoStandard, &attributes))
+		{
+			return 0;
+		}
+
+		return (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+	}
+#endif
+
+	// BEGIN PRIVATE MEMBERS
+	std::string _directory;
+	std::vector<std::string> _names;
+#ifdef _WIN32
+	HANDLE _handle = nullptr;
+	std::vector<uint64_t> _last_write_times;
+#elif defined(__linux__)
+	int _descriptor = -1;
+#endif
+	// END PRIVATE MEMBERS
+};
@@ -0,0 +1,355 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// cpu stages timed inside a frame, in the order they run
+enum class ProfileStage : uint32_t
+{
+	FrameWait,
+	Acquire,
+	UniformUpdate,
+	Cull,
+	Record,
+	Submit,
+	Present,
+	Count
+};
+
+static const char* const PROFILE_STAGE_NAMES[] = { "FrameWait", "Acquire", "UniformUpdate", "Cull", "Record", "Submit", "Present" };
+
+struct FrameSample
+{
+	uint64_t _frame_number = 0;
+	uint64_t _frame_begin_ns = 0;	///< cpu timeline, relative to profiler creation
+	uint64_t _frame_end_ns = 0;
+	std::array<uint64_t, static_cast<size_t>(ProfileStage::Count)> _stage_begin_ns = {};
+	std::array<uint64_t, static_cast<size_t>(ProfileStage::Count)> _stage_duration_ns = {};
+	uint64_t _gpu_begin_ns = 0;		///< gpu timeline, relative to the first gpu timestamp seen
+	uint64_t _gpu_duration_ns = 0;	///< render pass, 0 when timestamps are unavailable
+};
+
+// single producer single consumer ring - the render thread pushes, the writer thread pops
+template<typename T, size_t CAPACITY>
+class SampleRing
+{
+public:
+	bool Push(const T& value)
+	{
+		size_t head = _head.load(std::memory_order_relaxed);
+		size_t next = (head + 1) % CAPACITY;
+
+		if (next == _tail.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		_slots[head] = value;
+		_head.store(next, std::memory_order_release);
+		return true;
+	}
+
+	bool Pop(T& value)
+	{
+		size_t tail = _tail.load(std::memory_order_relaxed);
+
+		if (tail == _head.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		value = _slots[tail];
+		_tail.store((tail + 1) % CAPACITY, std::memory_order_release);
+		return true;
+	}
+
+private:
+	std::vector<T> _slots = std::vector<T>(CAPACITY);	///< heap backed, the profiler lives inside the application object
+	std::atomic<size_t> _head = { 0 };
+	std::atomic<size_t> _tail = { 0 };
+};
+
+// per stage cpu timers and gpu render pass times, streamed to chrome trace json or csv by a writer thread
+// cpu samples wait in a per frame slot until the gpu timestamps of that slot are resolved
+class FrameProfiler
+{
+public:
+	~FrameProfiler()
+	{
+		Close();
+	}
+
+	// starts streaming to path - .json writes a chrome trace (chrome://tracing), anything else csv
+	void Open(const std::string& path, uint32_t frame_slots)
+	{
+		_file.open(path, std::ios::out | std::ios::trunc);
+		if (!_file.is_open())
+		{
+			throw std::runtime_error("Failed To Open Profile Output!");
+		}
+
+		_file << std::fixed << std::setprecision(3);
+
+		_chrome_trace = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+		_pending.assign(frame_slots, FrameSample());
+		_pending_valid.assign(frame_slots, false);
+		_start_time = std::chrono::high_resolution_clock::now();
+		_gpu_origin_ticks = 0;
+		_gpu_origin_set = false;
+
+		WriteHeader();
+
+		_enabled = true;
+		_writer_running = true;
+		_writer = std::thread(&FrameProfiler::WriterLoop, this);
+	}
+
+	// drains every queued sample and finishes the file
+	void Close()
+	{
+		if (!_enabled)
+		{
+			return;
+		}
+
+		_enabled = false;
+		_writer_running = false;
+		_writer.join();
+
+		WriteFooter();
+		_file.close();
+
+		if (_dropped_samples > 0)
+		{
+			fprintf(stderr, "Profiler: %llu samples dropped, ring buffer full\n", static_cast<unsigned long long>(_dropped_samples));
+		}
+	}
+
+	bool Enabled() const
+	{
+		return _enabled;
+	}
+
+	uint64_t NowNs() const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - _start_time).count();
+	}
+
+	void BeginFrame(uint64_t frame_number)
+	{
+		_current = FrameSample();
+		_current._frame_number = frame_number;
+		_current._frame_begin_ns = NowNs();
+	}
+
+	void RecordStage(ProfileStage stage, uint64_t begin_ns, uint64_t end_ns)
+	{
+		_current._stage_begin_ns[static_cast<size_t>(stage)] = begin_ns;
+		_current._stage_duration_ns[static_cast<size_t>(stage)] = end_ns - begin_ns;
+	}
+
+	// parks the cpu half of the frame until the gpu half for frame_slot is known
+	void EndFrame(uint32_t frame_slot, bool has_gpu_timing)
+	{
+		_current._frame_end_ns = NowNs();
+
+		if (has_gpu_timing)
+		{
+			_pending[frame_slot] = _current;
+			_pending_valid[frame_slot] = true;
+		}
+		else
+		{
+			Publish(_current);
+		}
+	}
+
+	bool HasPending(uint32_t frame_slot) const
+	{
+		return _pending_valid[frame_slot];
+	}
+
+	// gpu timestamps are in ticks - timestamp_period converts them to ns
+	void ResolveGpu(uint32_t frame_slot, uint64_t begin_ticks, uint64_t end_ticks, float timestamp_period)
+	{
+		if (!_pending_valid[frame_slot])
+		{
+			return;
+		}
+
+		if (!_gpu_origin_set)
+		{
+			_gpu_origin_ticks = begin_ticks;
+			_gpu_origin_set = true;
+		}
+
+		FrameSample& sample = _pending[frame_slot];
+		sample._gpu_begin_ns = static_cast<uint64_t>((begin_ticks - _gpu_origin_ticks) * static_cast<double>(timestamp_period));
+		sample._gpu_duration_ns = static_cast<uint64_t>((end_ticks - begin_ticks) * static_cast<double>(timestamp_period));
+
+		Publish(sample);
+		_pending_valid[frame_slot] = false;
+	}
+
+private:
+	void Publish(const FrameSample& sample)
+	{
+		if (!_samples.Push(sample))
+		{
+			++_dropped_samples;
+		}
+	}
+
+	void WriterLoop()
+	{
+		FrameSample sample;
+
+		for (;;)
+		{
+			bool running = _writer_running.load();
+			bool wrote = false;
+
+			while (_samples.Pop(sample))
+			{
+				WriteSample(sample);
+				wrote = true;
+			}
+
+			if (!running)
+			{
+				break;
+			}
+
+			if (!wrote)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			}
+		}
+	}
+
+	void WriteHeader()
+	{
+		if (_chrome_trace)
+		{
+			_file << "{\"traceEvents\":[\n";
+			_file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+			_file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+		}
+		else
+		{
+			_file << "frame,frame_begin_us,cpu_frame_us";
+			for (const char* name : PROFILE_STAGE_NAMES)
+			{
+				_file << "," << name << "_us";
+			}
+			_file << ",gpu_render_pass_us\n";
+		}
+	}
+
+	void WriteFooter()
+	{
+		if (_chrome_trace)
+		{
+			_file << "\n]}\n";
+		}
+	}
+
+	void WriteSample(const FrameSample& sample)
+	{
+		if (_chrome_trace)
+		{
+			WriteTraceEvent("Frame", 1, sample._frame_number, sample._frame_begin_ns, sample._frame_end_ns - sample._frame_begin_ns);
+
+			for (size_t i = 0; i < static_cast<size_t>(ProfileStage::Count); ++i)
+			{
+				if (sample._stage_duration_ns[i] > 0)
+				{
+					WriteTraceEvent(PROFILE_STAGE_NAMES[i], 1, sample._frame_number, sample._stage_begin_ns[i], sample._stage_duration_ns[i]);
+				}
+			}
+
+			// the gpu clock is unrelated to the cpu clock, its track starts where the first submit ended
+			if (sample._gpu_duration_ns > 0)
+			{
+				if (!_gpu_track_offset_set)
+				{
+					size_t submit = static_cast<size_t>(ProfileStage::Submit);
+					_gpu_track_offset_ns = sample._stage_begin_ns[submit] + sample._stage_duration_ns[submit];
+					_gpu_track_offset_set = true;
+				}
+
+				WriteTraceEvent("RenderPass", 2, sample._frame_number, _gpu_track_offset_ns + sample._gpu_begin_ns, sample._gpu_duration_ns);
+			}
+		}
+		else
+		{
+			_file << sample._frame_number << "," << sample._frame_begin_ns / 1000.0 << "," << (sample._frame_end_ns - sample._frame_begin_ns) / 1000.0;
+			for (uint64_t duration : sample._stage_duration_ns)
+			{
+				_file << "," << duration / 1000.0;
+			}
+			_file << "," << sample._gpu_duration_ns / 1000.0 << "\n";
+		}
+	}
+
+	void WriteTraceEvent(const char* name, uint32_t thread, uint64_t frame_number, uint64_t begin_ns, uint64_t duration_ns)
+	{
+		char event[256];
+		snprintf(event, sizeof(event), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+			name, thread, begin_ns / 1000.0, duration_ns / 1000.0, static_cast<unsigned long long>(frame_number));
+		_file << event;
+	}
+
+	// BEGIN PRIVATE MEMBERS
+	bool _enabled = false;
+	bool _chrome_trace = false;
+	std::ofstream _file;
+	std::chrono::high_resolution_clock::time_point _start_time;
+
+	FrameSample _current;
+	std::vector<FrameSample> _pending;	///< cpu halves waiting on gpu timestamps, indexed by frame slot
+	std::vector<bool> _pending_valid;
+
+	uint64_t _gpu_origin_ticks = 0;
+	bool _gpu_origin_set = false;
+	uint64_t _gpu_track_offset_ns = 0;	///< writer thread only
+	bool _gpu_track_offset_set = false;	///< writer thread only
+
+	SampleRing<FrameSample, 4096> _samples;
+	uint64_t _dropped_samples = 0;
+	std::atomic<bool> _writer_running = { false };
+	std::thread _writer;
+	// END PRIVATE MEMBERS
+};
+
+// times one cpu stage of the current frame - a single branch when the profiler is disabled
+class ScopedCpuTimer
+{
+public:
+	ScopedCpuTimer(FrameProfiler& profiler, ProfileStage stage)
+		: _profiler(profiler), _stage(stage), _begin_ns(profiler.Enabled() ? profiler.NowNs() : 0)
+	{
+	}
+
+	~ScopedCpuTimer()
+	{
+		if (_profiler.Enabled())
+		{
+			_profiler.RecordStage(_stage, _begin_ns, _profiler.NowNs());
+		}
+	}
+
+private:
+	FrameProfiler& _profiler;
+	ProfileStage _stage;
+	uint64_t _begin_ns;
+};
@@ -0,0 +1,444 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLER_SSE2 1
+#endif
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_CULLER_AVX 1
+#endif
+
+// axis aligned box as center and half extent, the form the plane test wants
+struct BoundingBox
+{
+	float _center[3];
+	float _extent[3];
+
+	static BoundingBox FromMinMax(const float* p_min, const float* p_max)
+	{
+		BoundingBox box;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			box._center[axis] = 0.5f * (p_min[axis] + p_max[axis]);
+			box._extent[axis] = 0.5f * (p_max[axis] - p_min[axis]);
+		}
+		return box;
+	}
+
+	// box around the transformed box (Arvo 1990), p_matrix is column major like glm
+	BoundingBox Transformed(const float* p_matrix) const
+	{
+		BoundingBox box;
+		for (int row = 0; row < 3; ++row)
+		{
+			box._center[row] = p_matrix[12 + row];
+			box._extent[row] = 0.0f;
+			for (int column = 0; column < 3; ++column)
+			{
+				box._center[row] += p_matrix[4 * column + row] * _center[column];
+				box._extent[row] += std::fabs(p_matrix[4 * column + row]) * _extent[column];
+			}
+		}
+		return box;
+	}
+};
+
+// six planes facing into the frustum, a point p is inside when dot(n, p) + w >= 0 for all of them
+struct Frustum
+{
+	float _planes[6][4];
+
+	// gribb/hartmann extraction from a column major clip matrix with a zero to one depth range - the planes
+	// come out in the space the matrix maps from, so passing proj * view * model culls model space boxes
+	static Frustum FromMatrix(const float* p_matrix)
+	{
+		auto Row = [p_matrix](int row, int column)
+		{
+			return p_matrix[4 * column + row];
+		};
+
+		Frustum frustum;
+		for (int column = 0; column < 4; ++column)
+		{
+			frustum._planes[0][column] = Row(3, column) + Row(0, column);	// left
+			frustum._planes[1][column] = Row(3, column) - Row(0, column);	// right
+			frustum._planes[2][column] = Row(3, column) + Row(1, column);	// bottom, top when y is flipped
+			frustum._planes[3][column] = Row(3, column) - Row(1, column);
+			frustum._planes[4][column] = Row(2, column);					// near
+			frustum._planes[5][column] = Row(3, column) - Row(2, column);	// far
+		}
+		return frustum;
+	}
+
+	// conservative - a box crossing two planes outside a corner of the frustum still counts as visible
+	bool Intersects(const BoundingBox& box) const
+	{
+		for (const float* p_plane : _planes)
+		{
+			float distance = p_plane[0] * box._center[0] + p_plane[1] * box._center[1] + p_plane[2] * box._center[2] + p_plane[3];
+			float radius = std::fabs(p_plane[0]) * box._extent[0] + std::fabs(p_plane[1]) * box._extent[1] + std::fabs(p_plane[2]) * box._extent[2];
+			if (distance + radius < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+// boxes as structure of arrays, the layout the simd tests load lanes from
+struct BoundingBoxArray
+{
+	std::vector<float> _center_x;
+	std::vector<float> _center_y;
+	std::vector<float> _center_z;
+	std::vector<float> _extent_x;
+	std::vector<float> _extent_y;
+	std::vector<float> _extent_z;
+
+	void Assign(const BoundingBox* p_boxes, size_t count)
+	{
+		std::vector<float>* p_arrays[] = { &_center_x, &_center_y, &_center_z, &_extent_x, &_extent_y, &_extent_z };
+		for (int array = 0; array < 6; ++array)
+		{
+			p_arrays[array]->resize(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				(*p_arrays[array])[i] = array < 3 ? p_boxes[i]._center[array] : p_boxes[i]._extent[array - 3];
+			}
+		}
+	}
+
+	size_t Size() const
+	{
+		return _center_x.size();
+	}
+};
+
+// frustum tests that check four boxes per instruction with sse2, eight with avx - without either
+// they fall back to Frustum::Intersects one box at a time
+class FrustumCuller
+{
+public:
+	// brute force over every box, appends the indices of the visible ones
+	static void Cull(const Frustum& frustum, const BoundingBoxArray& boxes, std::vector<uint32_t>& visible)
+	{
+		const size_t count = boxes.Size();
+		size_t i = 0;
+
+#if defined(FRUSTUM_CULLER_AVX)
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 outside = _mm256_setzero_ps();
+			__m256 center_x = _mm256_loadu_ps(&boxes._center_x[i]);
+			__m256 center_y = _mm256_loadu_ps(&boxes._center_y[i]);
+			__m256 center_z = _mm256_loadu_ps(&boxes._center_z[i]);
+			__m256 extent_x = _mm256_loadu_ps(&boxes._extent_x[i]);
+			__m256 extent_y = _mm256_loadu_ps(&boxes._extent_y[i]);
+			__m256 extent_z = _mm256_loadu_ps(&boxes._extent_z[i]);
+
+			for (const float* p_plane : frustum._planes)
+			{
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p_plane[0]), center_x), _mm256_mul_ps(_mm256_set1_ps(p_plane[1]), center_y)),
+					_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p_plane[2]), center_z), _mm256_set1_ps(p_plane[3])));
+				__m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::fabs(p_plane[0])), extent_x), _mm256_mul_ps(_mm256_set1_ps(std::fabs(p_plane[1])), extent_y)),
+					_mm256_mul_ps(_mm256_set1_ps(std::fabs(p_plane[2])), extent_z));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+			}
+
+			AppendLanes(~_mm256_movemask_ps(outside) & 0xFF, static_cast<uint32_t>(i), visible);
+		}
+#endif
+
+#if defined(FRUSTUM_CULLER_SSE2)
+		for (; i + 4 <= count; i += 4)
+		{
+			uint32_t inside_mask;
+			uint32_t visible_mask = TestPacket(frustum, &boxes._center_x[i], &boxes._center_y[i], &boxes._center_z[i],
+				&boxes._extent_x[i], &boxes._extent_y[i], &boxes._extent_z[i], inside_mask);
+			AppendLanes(visible_mask, static_cast<uint32_t>(i), visible);
+		}
+#endif
+
+		for (; i < count; ++i)
+		{
+			BoundingBox box = { { boxes._center_x[i], boxes._center_y[i], boxes._center_z[i] }, { boxes._extent_x[i], boxes._extent_y[i], boxes._extent_z[i] } };
+			if (frustum.Intersects(box))
+			{
+				visible.push_back(static_cast<uint32_t>(i));
+			}
+		}
+	}
+
+	// four boxes at once - bit n of the result is set when box n touches the frustum, bit n of inside_mask
+	// when it lies entirely inside so nothing below it needs testing
+	static uint32_t TestPacket(const Frustum& frustum, const float* p_center_x, const float* p_center_y, const float* p_center_z,
+		const float* p_extent_x, const float* p_extent_y, const float* p_extent_z, uint32_t& inside_mask)
+	{
+#if defined(FRUSTUM_CULLER_SSE2)
+		__m128 outside = _mm_setzero_ps();
+		__m128 crossing = _mm_setzero_ps();
+		__m128 center_x = _mm_loadu_ps(p_center_x);
+		__m128 center_y = _mm_loadu_ps(p_center_y);
+		__m128 center_z = _mm_loadu_ps(p_center_z);
+		__m128 extent_x = _mm_loadu_ps(p_extent_x);
+		__m128 extent_y = _mm_loadu_ps(p_extent_y);
+		__m128 extent_z = _mm_loadu_ps(p_extent_z);
+
+		for (const float* p_plane : frustum._planes)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p_plane[0]), center_x), _mm_mul_ps(_mm_set1_ps(p_plane[1]), center_y)),
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p_plane[2]), center_z), _mm_set1_ps(p_plane[3])));
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(p_plane[0])), extent_x), _mm_mul_ps(_mm_set1_ps(std::fabs(p_plane[1])), extent_y)),
+				_mm_mul_ps(_mm_set1_ps(std::fabs(p_plane[2])), extent_z));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+			crossing = _mm_or_ps(crossing, _mm_cmplt_ps(distance, radius));
+		}
+
+		uint32_t visible_mask = ~_mm_movemask_ps(outside) & 0xF;
+		inside_mask = visible_mask & ~_mm_movemask_ps(crossing) & 0xF;
+		return visible_mask;
+#else
+		uint32_t visible_mask = 0;
+		inside_mask = 0;
+		for (uint32_t lane = 0; lane < 4; ++lane)
+		{
+			bool outside = false;
+			bool crossing = false;
+			for (const float* p_plane : frustum._planes)
+			{
+				float distance = p_plane[0] * p_center_x[lane] + p_plane[1] * p_center_y[lane] + p_plane[2] * p_center_z[lane] + p_plane[3];
+				float radius = std::fabs(p_plane[0]) * p_extent_x[lane] + std::fabs(p_plane[1]) * p_extent_y[lane] + std::fabs(p_plane[2]) * p_extent_z[lane];
+				outside = outside || distance + radius < 0.0f;
+				crossing = crossing || distance < radius;
+			}
+			visible_mask |= outside ? 0 : 1u << lane;
+			inside_mask |= outside || crossing ? 0 : 1u << lane;
+		}
+		return visible_mask;
+#endif
+	}
+
+private:
+	static void AppendLanes(uint32_t mask, uint32_t first, std::vector<uint32_t>& visible)
+	{
+		for (uint32_t lane = 0; mask != 0; ++lane, mask >>= 1)
+		{
+			if (mask & 1)
+			{
+				visible.push_back(first + lane);
+			}
+		}
+	}
+};
+
+// static 4-wide bvh - every node stores its four child boxes as structure of arrays, so one
+// FrustumCuller::TestPacket decides all of them, and a child entirely inside the frustum emits
+// its whole subtree without testing anything below it
+class BoundingVolumeHierarchy
+{
+public:
+	// median splits on the longest centroid axis - balanced, so the depth stays at log4 of the count
+	void Build(const BoundingBox* p_boxes, uint32_t count)
+	{
+		_nodes.clear();
+		_primitives.resize(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			_primitives[i] = i;
+		}
+
+		if (count == 0)
+		{
+			return;
+		}
+
+		_nodes.reserve(count / 3 + 1);
+		BuildNode(p_boxes, 0, count);
+	}
+
+	// appends the index of every box that touches the frustum
+	void Cull(const Frustum& frustum, std::vector<uint32_t>& visible) const
+	{
+		if (_nodes.empty())
+		{
+			return;
+		}
+
+		uint32_t stack[MAX_STACK_SIZE];
+		uint32_t stack_size = 0;
+		stack[stack_size++] = 0;
+
+		while (stack_size > 0)
+		{
+			const Node& node = _nodes[stack[--stack_size]];
+
+			uint32_t inside_mask;
+			uint32_t visible_mask = FrustumCuller::TestPacket(frustum, node._center_x, node._center_y, node._center_z,
+				node._extent_x, node._extent_y, node._extent_z, inside_mask) & node._used_mask;
+
+			for (uint32_t child = 0; visible_mask != 0; ++child, visible_mask >>= 1, inside_mask >>= 1)
+			{
+				if (!(visible_mask & 1))
+				{
+					continue;
+				}
+
+				if (node._child[child] >= 0 && !(inside_mask & 1))
+				{
+					stack[stack_size++] = static_cast<uint32_t>(node._child[child]);
+					continue;
+				}
+
+				visible.insert(visible.end(), _primitives.begin() + node._first[child], _primitives.begin() + node._first[child] + node._count[child]);
+			}
+		}
+	}
+
+	size_t NodeCount() const
+	{
+		return _nodes.size();
+	}
+
+private:
+	struct Node
+	{
+		float _center_x[4];
+		float _center_y[4];
+		float _center_z[4];
+		float _extent_x[4];
+		float _extent_y[4];
+		float _extent_z[4];
+		int32_t _child[4];		///< node index, -1 for a leaf holding a single box
+		uint32_t _first[4];		///< the child's boxes are _primitives[_first, _first + _count)
+		uint32_t _count[4];
+		uint32_t _used_mask;	///< nodes near the bottom may have fewer than four children
+	};
+
+	// a balanced tree over 2^32 boxes is 16 levels deep, each level leaves at most three siblings on the stack
+	static const uint32_t MAX_STACK_SIZE = 64;
+
+	uint32_t BuildNode(const BoundingBox* p_boxes, uint32_t first, uint32_t count)
+	{
+		uint32_t node_index = static_cast<uint32_t>(_nodes.size());
+		_nodes.push_back(Node());
+
+		// up to four children - single boxes at the bottom, otherwise two levels of median splits
+		uint32_t child_first[4];
+		uint32_t child_count[4];
+		uint32_t child_num = 0;
+
+		if (count <= 4)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				child_first[child_num] = first + i;
+				child_count[child_num++] = 1;
+			}
+		}
+		else
+		{
+			uint32_t half = count / 2;
+			uint32_t middle = SplitMedian(p_boxes, first, count, half);
+			uint32_t quarter = SplitMedian(p_boxes, first, half, half / 2);
+			uint32_t three_quarters = SplitMedian(p_boxes, middle, count - half, (count - half) / 2);
+
+			child_first[0] = first;
+			child_count[0] = quarter - first;
+			child_first[1] = quarter;
+			child_count[1] = middle - quarter;
+			child_first[2] = middle;
+			child_count[2] = three_quarters - middle;
+			child_first[3] = three_quarters;
+			child_count[3] = first + count - three_quarters;
+			child_num = 4;
+		}
+
+		Node node = {};
+		for (uint32_t child = 0; child < child_num; ++child)
+		{
+			float bounds_min[3];
+			float bounds_max[3];
+			Bounds(p_boxes, child_first[child], child_count[child], bounds_min, bounds_max);
+
+			node._center_x[child] = 0.5f * (bounds_min[0] + bounds_max[0]);
+			node._center_y[child] = 0.5f * (bounds_min[1] + bounds_max[1]);
+			node._center_z[child] = 0.5f * (bounds_min[2] + bounds_max[2]);
+			node._extent_x[child] = 0.5f * (bounds_max[0] - bounds_min[0]);
+			node._extent_y[child] = 0.5f * (bounds_max[1] - bounds_min[1]);
+			node._extent_z[child] = 0.5f * (bounds_max[2] - bounds_min[2]);
+			node._first[child] = child_first[child];
+			node._count[child] = child_count[child];
+			node._child[child] = child_count[child] > 1 ? static_cast<int32_t>(BuildNode(p_boxes, child_first[child], child_count[child])) : -1;
+			node._used_mask |= 1u << child;
+		}
+
+		// children were appended after this node, so the slot is written last
+		_nodes[node_index] = node;
+		return node_index;
+	}
+
+	// partitions _primitives[first, first + count) around the median center on the longest axis, returns first + rank
+	uint32_t SplitMedian(const BoundingBox* p_boxes, uint32_t first, uint32_t count, uint32_t rank)
+	{
+		float centroid_min[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+		float centroid_max[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+		for (uint32_t i = first; i < first + count; ++i)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				centroid_min[axis] = std::min(centroid_min[axis], p_boxes[_primitives[i]]._center[axis]);
+				centroid_max[axis] = std::max(centroid_max[axis], p_boxes[_primitives[i]]._center[axis]);
+			}
+		}
+
+		int axis = 0;
+		for (int candidate = 1; candidate < 3; ++candidate)
+		{
+			if (centroid_max[candidate] - centroid_min[candidate] > centroid_max[axis] - centroid_min[axis])
+			{
+				axis = candidate;
+			}
+		}
+
+		std::nth_element(_primitives.begin() + first, _primitives.begin() + first + rank, _primitives.begin() + first + count,
+			[p_boxes, axis](uint32_t a, uint32_t b)
+		{
+			return p_boxes[a]._center[axis] < p_boxes[b]._center[axis];
+		});
+
+		return first + rank;
+	}
+
+	void Bounds(const BoundingBox* p_boxes, uint32_t first, uint32_t count, float* p_min, float* p_max) const
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			p_min[axis] = std::numeric_limits<float>::max();
+			p_max[axis] = -std::numeric_limits<float>::max();
+		}
+
+		for (uint32_t i = first; i < first + count; ++i)
+		{
+			const BoundingBox& box = p_boxes[_primitives[i]];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				p_min[axis] = std::min(p_min[axis], box._center[axis] - box._extent[axis]);
+				p_max[axis] = std::max(p_max[axis], box._center[axis] + box._extent[axis]);
+			}
+		}
+	}
+
+	// BEGIN PRIVATE MEMBERS
+	std::vector<Node> _nodes;
+	std::vector<uint32_t> _primitives;	///< box indices ordered so every subtree covers a contiguous range
+	// END PRIVATE MEMBERS
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// xxhash64 - fast non cryptographic 64 bit hash, good enough to key caches on file and blob contents
+class Hash
+{
+public:
+	static uint64_t Bytes(const void* p_data, size_t size, uint64_t seed = 0)
+	{
+		const uint8_t* p = static_cast<const uint8_t*>(p_data);
+		const uint8_t* p_end = p + size;
+		uint64_t hash;
+
+		if (size >= 32)
+		{
+			// four independent lanes keep the multipliers busy
+			uint64_t lane_1 = seed + PRIME_1 + PRIME_2;
+			uint64_t lane_2 = seed + PRIME_2;
+			uint64_t lane_3 = seed;
+			uint64_t lane_4 = seed - PRIME_1;
+
+			do
+			{
+				lane_1 = Round(lane_1, Read64(p));
+				lane_2 = Round(lane_2, Read64(p + 8));
+				lane_3 = Round(lane_3, Read64(p + 16));
+				lane_4 = Round(lane_4, Read64(p + 24));
+				p += 32;
+			} while (p_end - p >= 32);
+
+			hash = RotateLeft(lane_1, 1) + RotateLeft(lane_2, 7) + RotateLeft(lane_3, 12) + RotateLeft(lane_4, 18);
+			hash = MergeRound(hash, lane_1);
+			hash = MergeRound(hash, lane_2);
+			hash = MergeRound(hash, lane_3);
+			hash = MergeRound(hash, lane_4);
+		}
+		else
+		{
+			hash = seed + PRIME_5;
+		}
+
+		hash += static_cast<uint64_t>(size);
+
+		while (p_end - p >= 8)
+		{
+			hash ^= Round(0, Read64(p));
+			hash = RotateLeft(hash, 27) * PRIME_1 + PRIME_4;
+			p += 8;
+		}
+
+		if (p_end - p >= 4)
+		{
+			hash ^= static_cast<uint64_t>(Read32(p)) * PRIME_1;
+			hash = RotateLeft(hash, 23) * PRIME_2 + PRIME_3;
+			p += 4;
+		}
+
+		while (p < p_end)
+		{
+			hash ^= static_cast<uint64_t>(*p) * PRIME_5;
+			hash = RotateLeft(hash, 11) * PRIME_1;
+			++p;
+		}
+
+		return Avalanche(hash);
+	}
+
+	template<typename T>
+	static uint64_t Value(const T& value, uint64_t seed = 0)
+	{
+		return Bytes(&value, sizeof(T), seed);
+	}
+
+private:
+	static const uint64_t PRIME_1 = 11400714785074694791ull;
+	static const uint64_t PRIME_2 = 14029467366897019727ull;
+	static const uint64_t PRIME_3 = 1609587929392839161ull;
+	static const uint64_t PRIME_4 = 9650029242287828579ull;
+	static const uint64_t PRIME_5 = 2870177450012600261ull;
+
+	static uint64_t RotateLeft(uint64_t value, uint32_t bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	static uint64_t Read64(const uint8_t* p)
+	{
+		uint64_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	static uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	static uint64_t Round(uint64_t accumulator, uint64_t input)
+	{
+		accumulator += input * PRIME_2;
+		accumulator = RotateLeft(accumulator, 31);
+		return accumulator * PRIME_1;
+	}
+
+	static uint64_t MergeRound(uint64_t accumulator, uint64_t lane)
+	{
+		accumulator ^= Round(0, lane);
+		return accumulator * PRIME_1 + PRIME_4;
+	}
+
+	static uint64_t Avalanche(uint64_t hash)
+	{
+		hash ^= hash >> 33;
+		hash *= PRIME_2;
+		hash ^= hash >> 29;
+		hash *= PRIME_3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// read only view of a whole file, mapped instead of streamed so parsers can work on it in place
+class MappedFile
+{
+public:
+	MappedFile() = default;
+
+	explicit MappedFile(const std::string& path)
+	{
+		Open(path);
+	}
+
+	~MappedFile()
+	{
+		Close();
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// returns false when the file does not exist or cannot be mapped
+	bool Open(const std::string& path)
+	{
+		Close();
+
+#ifdef _WIN32
+		_file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (_file_handle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER file_size;
+		GetFileSizeEx(_file_handle, &file_size);
+		_size = static_cast<size_t>(file_size.QuadPart);
+
+		if (_size > 0)
+		{
+			_mapping_handle = CreateFileMappingA(_file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (_mapping_handle == nullptr)
+			{
+				Close();
+				return false;
+			}
+
+			_p_data = static_cast<const char*>(MapViewOfFile(_mapping_handle, FILE_MAP_READ, 0, 0, 0));
+		}
+#else
+		_file_descriptor = open(path.c_str(), O_RDONLY);
+		if (_file_descriptor < 0)
+		{
+			return false;
+		}
+
+		struct stat file_stat;
+		fstat(_file_descriptor, &file_stat);
+		_size = static_cast<size_t>(file_stat.st_size);
+
+		if (_size > 0)
+		{
+			void* p_mapping = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _file_descriptor, 0);
+			_p_data = p_mapping != MAP_FAILED ? static_cast<const char*>(p_mapping) : nullptr;
+
+			if (_p_data != nullptr)
+			{
+				madvise(p_mapping, _size, MADV_SEQUENTIAL);
+			}
+		}
+#endif
+
+		if (_size > 0 && _p_data == nullptr)
+		{
+			Close();
+			return false;
+		}
+
+		_open = true;
+		return true;
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		if (_p_data != nullptr)
+		{
+			UnmapViewOfFile(_p_data);
+		}
+		if (_mapping_handle != nullptr)
+		{
+			CloseHandle(_mapping_handle);
+			_mapping_handle = nullptr;
+		}
+		if (_file_handle != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(_file_handle);
+			_file_handle = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (_p_data != nullptr)
+		{
+			munmap(const_cast<char*>(_p_data), _size);
+		}
+		if (_file_descriptor >= 0)
+		{
+			close(_file_descriptor);
+			_file_descriptor = -1;
+		}
+#endif
+
+		_p_data = nullptr;
+		_size = 0;
+		_open = false;
+	}
+
+	bool IsOpen() const
+	{
+		return _open;
+	}
+
+	const char* Data() const
+	{
+		return _p_data;
+	}
+
+	size_t Size() const
+	{
+		return _size;
+	}
+
+private:
+	// BEGIN PRIVATE MEMBERS
+	const char* _p_data = nullptr;
+	size_t _size = 0;
+	bool _open = false;
+
+#ifdef _WIN32
+	HANDLE _file_handle = INVALID_HANDLE_VALUE;
+	HANDLE _mapping_handle = nullptr;
+#else
+	int _file_descriptor = -1;
+#endif
+	// END PRIVATE MEMBERS
+};
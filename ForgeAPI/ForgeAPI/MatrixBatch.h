@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MATRIX_BATCH_SSE2 1
+#endif
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define MATRIX_BATCH_AVX 1
+#endif
+
+// one 4x4 matrix times many, column major like glm - e.g. view projection times every instance's model matrix
+// a column of the product is the left matrix's columns weighted by one column of the right, so the left columns stay
+// in registers for the whole batch. avx does two columns per instruction, sse2 one, otherwise plain scalar
+class MatrixBatch
+{
+public:
+	// p_out[i] = lhs * p_rhs[i], 16 floats per matrix - p_out must not overlap p_rhs
+	static void Multiply(const float* p_lhs, const float* p_rhs, float* p_out, size_t count)
+	{
+#if defined(MATRIX_BATCH_AVX)
+		// both halves hold the same left column, the right columns j and j + 1 are broadcast into one half each
+		__m256 lhs_0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(p_lhs));
+		__m256 lhs_1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(p_lhs + 4));
+		__m256 lhs_2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(p_lhs + 8));
+		__m256 lhs_3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(p_lhs + 12));
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float* p_matrix = p_rhs + 16 * i;
+			float* p_product = p_out + 16 * i;
+
+			for (int column = 0; column < 4; column += 2)
+			{
+				__m256 rhs = _mm256_loadu_ps(p_matrix + 4 * column);
+				__m256 product = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(lhs_0, _mm256_shuffle_ps(rhs, rhs, 0x00)), _mm256_mul_ps(lhs_1, _mm256_shuffle_ps(rhs, rhs, 0x55))),
+					_mm256_add_ps(_mm256_mul_ps(lhs_2, _mm256_shuffle_ps(rhs, rhs, 0xAA)), _mm256_mul_ps(lhs_3, _mm256_shuffle_ps(rhs, rhs, 0xFF))));
+				_mm256_storeu_ps(p_product + 4 * column, product);
+			}
+		}
+#elif defined(MATRIX_BATCH_SSE2)
+		__m128 lhs_0 = _mm_loadu_ps(p_lhs);
+		__m128 lhs_1 = _mm_loadu_ps(p_lhs + 4);
+		__m128 lhs_2 = _mm_loadu_ps(p_lhs + 8);
+		__m128 lhs_3 = _mm_loadu_ps(p_lhs + 12);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float* p_matrix = p_rhs + 16 * i;
+			float* p_product = p_out + 16 * i;
+
+			for (int column = 0; column < 4; ++column)
+			{
+				__m128 rhs = _mm_loadu_ps(p_matrix + 4 * column);
+				__m128 product = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(lhs_0, _mm_shuffle_ps(rhs, rhs, 0x00)), _mm_mul_ps(lhs_1, _mm_shuffle_ps(rhs, rhs, 0x55))),
+					_mm_add_ps(_mm_mul_ps(lhs_2, _mm_shuffle_ps(rhs, rhs, 0xAA)), _mm_mul_ps(lhs_3, _mm_shuffle_ps(rhs, rhs, 0xFF))));
+				_mm_storeu_ps(p_product + 4 * column, product);
+			}
+		}
+#else
+		MultiplyScalar(p_lhs, p_rhs, p_out, count);
+#endif
+	}
+
+	// the reference the simd paths are measured against
+	static void MultiplyScalar(const float* p_lhs, const float* p_rhs, float* p_out, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float* p_matrix = p_rhs + 16 * i;
+			float* p_product = p_out + 16 * i;
+
+			for (int column = 0; column < 4; ++column)
+			{
+				for (int row = 0; row < 4; ++row)
+				{
+					p_product[4 * column + row] = p_lhs[row] * p_matrix[4 * column] + p_lhs[4 + row] * p_matrix[4 * column + 1] +
+						p_lhs[8 + row] * p_matrix[4 * column + 2] + p_lhs[12 + row] * p_matrix[4 * column + 3];
+				}
+			}
+		}
+	}
+
+	// which path Multiply takes in this build
+	static const char* PathName()
+	{
+#if defined(MATRIX_BATCH_AVX)
+		return "avx";
+#elif defined(MATRIX_BATCH_SSE2)
+		return "sse2";
+#else
+		return "scalar";
+#endif
+	}
+};
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "AtomicFile.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "SourceFile.h"
+
+const uint32_t COOKED_MESH_MAGIC = 0x48534D46;	///< "FMSH"
+const uint32_t COOKED_MESH_VERSION = 3;
+
+// fixed size header at the start of a cooked mesh, blobs follow at 16 byte aligned offsets
+struct CookedMeshHeader
+{
+	uint32_t _magic;
+	uint32_t _version;
+	uint32_t _vertex_format;		///< caller defined layout id, a layout change invalidates old caches
+	uint32_t _vertex_stride;
+	uint32_t _vertex_count;
+	uint32_t _index_count;			///< 16 bit indices, relative to their submesh's base vertex
+	uint32_t _submesh_count;
+	uint32_t _padding;
+	uint64_t _vertex_offset;
+	uint64_t _index_offset;
+	uint64_t _submesh_offset;
+	uint64_t _source_size;
+	uint64_t _source_modified_time;	///< matching size and time skip hashing the source
+	uint64_t _source_hash;			///< hash of the source asset the mesh was cooked from
+	uint64_t _content_hash;			///< hash of the vertex and index blobs, catches truncated or corrupt files
+	float _bounds_min[3];
+	float _bounds_max[3];
+};
+
+// read side of the cooked mesh cache - the file stays mapped so vertex and index data can be
+// copied straight into staging memory without any parsing
+class CookedMesh
+{
+public:
+	// false when the cache is missing, stale (source changed, other version or layout) or damaged
+	bool Open(const std::string& path, SourceFile& source, uint32_t vertex_format, uint32_t vertex_stride)
+	{
+		Close();
+
+		if (!_file.Open(path) || _file.Size() < sizeof(CookedMeshHeader))
+		{
+			Close();
+			return false;
+		}
+
+		memcpy(&_header, _file.Data(), sizeof(_header));
+
+		bool valid = _header._magic == COOKED_MESH_MAGIC && _header._version == COOKED_MESH_VERSION &&
+			_header._vertex_format == vertex_format && _header._vertex_stride == vertex_stride &&
+			_header._source_size == source.Size();
+
+		uint64_t vertex_bytes = static_cast<uint64_t>(_header._vertex_count) * _header._vertex_stride;
+		uint64_t index_bytes = static_cast<uint64_t>(_header._index_count) * sizeof(uint16_t);
+		uint64_t submesh_bytes = static_cast<uint64_t>(_header._submesh_count) * sizeof(Submesh);
+
+		valid = valid && _header._vertex_offset + vertex_bytes <= _file.Size() && _header._index_offset + index_bytes <= _file.Size() &&
+			_header._submesh_offset + submesh_bytes <= _file.Size();
+
+		if (valid)
+		{
+			uint64_t content_hash = Hash::Bytes(_file.Data() + _header._vertex_offset, static_cast<size_t>(vertex_bytes));
+			content_hash = Hash::Bytes(_file.Data() + _header._index_offset, static_cast<size_t>(index_bytes), content_hash);
+			content_hash = Hash::Bytes(_file.Data() + _header._submesh_offset, static_cast<size_t>(submesh_bytes), content_hash);
+			valid = content_hash == _header._content_hash;
+		}
+
+		// the source is only read when its time changed, a matching hash keeps the cache
+		if (valid && _header._source_modified_time != source.ModifiedTime())
+		{
+			valid = _header._source_hash == source.ContentHash();
+		}
+
+		if (!valid)
+		{
+			Close();
+		}
+
+		return valid;
+	}
+
+	void Close()
+	{
+		_file.Close();
+		_header = CookedMeshHeader();
+	}
+
+	bool IsOpen() const
+	{
+		return _file.IsOpen();
+	}
+
+	const CookedMeshHeader& Header() const
+	{
+		return _header;
+	}
+
+	const void* VertexData() const
+	{
+		return _file.Data() + _header._vertex_offset;
+	}
+
+	const uint16_t* IndexData() const
+	{
+		return reinterpret_cast<const uint16_t*>(_file.Data() + _header._index_offset);
+	}
+
+	const Submesh* Submeshes() const
+	{
+		return reinterpret_cast<const Submesh*>(_file.Data() + _header._submesh_offset);
+	}
+
+	// through AtomicFile - false leaves the previous cache, if any, as it was
+	static bool Write(const std::string& path, SourceFile& source, uint32_t vertex_format,
+		const void* p_vertices, uint32_t vertex_stride, uint32_t vertex_count, const uint16_t* p_indices, uint32_t index_count,
+		const Submesh* p_submeshes, uint32_t submesh_count, const float bounds_min[3], const float bounds_max[3])
+	{
+		CookedMeshHeader header = {};
+		header._magic = COOKED_MESH_MAGIC;
+		header._version = COOKED_MESH_VERSION;
+		header._vertex_format = vertex_format;
+		header._vertex_stride = vertex_stride;
+		header._vertex_count = vertex_count;
+		header._index_count = index_count;
+		header._submesh_count = submesh_count;
+		header._source_size = source.Size();
+		header._source_modified_time = source.ModifiedTime();
+		header._source_hash = source.ContentHash();
+		memcpy(header._bounds_min, bounds_min, sizeof(header._bounds_min));
+		memcpy(header._bounds_max, bounds_max, sizeof(header._bounds_max));
+
+		size_t vertex_bytes = static_cast<size_t>(vertex_count) * vertex_stride;
+		size_t index_bytes = static_cast<size_t>(index_count) * sizeof(uint16_t);
+		size_t submesh_bytes = static_cast<size_t>(submesh_count) * sizeof(Submesh);
+
+		header._vertex_offset = AlignUp(sizeof(CookedMeshHeader));
+		header._index_offset = AlignUp(header._vertex_offset + vertex_bytes);
+		header._submesh_offset = AlignUp(header._index_offset + index_bytes);
+		header._content_hash = Hash::Bytes(p_submeshes, submesh_bytes, Hash::Bytes(p_indices, index_bytes, Hash::Bytes(p_vertices, vertex_bytes)));
+
+		AtomicFile file(path);
+		file.Write(&header, sizeof(header));
+		file.PadTo(header._vertex_offset);
+		file.Write(p_vertices, vertex_bytes);
+		file.PadTo(header._index_offset);
+		file.Write(p_indices, index_bytes);
+		file.PadTo(header._submesh_offset);
+		file.Write(p_submeshes, submesh_bytes);
+
+		return file.Commit();
+	}
+
+private:
+	static const uint64_t BLOB_ALIGNMENT = 16;
+
+	static uint64_t AlignUp(uint64_t value)
+	{
+		return (value + BLOB_ALIGNMENT - 1) / BLOB_ALIGNMENT * BLOB_ALIGNMENT;
+	}
+
+	// BEGIN PRIVATE MEMBERS
+	MappedFile _file;
+	CookedMeshHeader _header = {};
+	// END PRIVATE MEMBERS
+};
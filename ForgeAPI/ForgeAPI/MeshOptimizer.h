@@ -0,0 +1,449 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// contiguous index range drawn with one vkCmdDrawIndexed, its 16 bit indices are relative to _vertex_offset
+struct Submesh
+{
+	uint32_t _first_index;
+	uint32_t _index_count;
+	int32_t _vertex_offset;	///< base vertex
+	uint32_t _vertex_count;
+};
+
+// post-transform cache statistics of an index buffer, simulated with a fifo cache
+struct VertexCacheStatistics
+{
+	float _acmr = 0.0f;	///< average cache miss ratio - shaded vertices per triangle, 0.5 is ideal for a regular grid
+	float _atvr = 0.0f;	///< average transformed vertex ratio - shaded vertices per unique vertex, 1.0 is ideal
+};
+
+// offline passes that reorder an indexed triangle list for the gpu without changing what it renders
+// run in order: OptimizeVertexCache, optionally OptimizeOverdraw, OptimizeVertexFetch, then SplitSubmeshes
+class MeshOptimizer
+{
+public:
+	static const uint32_t DEFAULT_CACHE_SIZE = 16;
+	static const uint32_t MAX_SUBMESH_VERTICES = 65536;	///< everything a 16 bit index can address
+
+	static VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size = DEFAULT_CACHE_SIZE)
+	{
+		std::vector<uint32_t> cache_timestamps(vertex_count, 0);
+		uint32_t timestamp = cache_size + 1;
+		size_t misses = 0;
+
+		for (uint32_t index : indices)
+		{
+			if (timestamp - cache_timestamps[index] > cache_size)
+			{
+				cache_timestamps[index] = timestamp++;
+				++misses;
+			}
+		}
+
+		VertexCacheStatistics statistics;
+		statistics._acmr = indices.empty() ? 0.0f : static_cast<float>(misses) / (indices.size() / 3);
+		statistics._atvr = vertex_count == 0 ? 0.0f : static_cast<float>(misses) / vertex_count;
+		return statistics;
+	}
+
+	// tipsify (Sander et al. 2007) - fans around the most recently cached vertex that stays cached the longest,
+	// linear time. p_clusters receives the first triangle of each run that started from a dead end, the
+	// hard boundaries OptimizeOverdraw may reorder without hurting the cache
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size = DEFAULT_CACHE_SIZE, std::vector<uint32_t>* p_clusters = nullptr)
+	{
+		const size_t triangle_count = indices.size() / 3;
+
+		// vertex to triangle adjacency as offsets into one flat array
+		std::vector<uint32_t> live_triangles(vertex_count, 0);
+		for (uint32_t index : indices)
+		{
+			++live_triangles[index];
+		}
+
+		std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+		for (size_t vertex = 0; vertex < vertex_count; ++vertex)
+		{
+			adjacency_offsets[vertex + 1] = adjacency_offsets[vertex] + live_triangles[vertex];
+		}
+
+		std::vector<uint32_t> adjacency(indices.size());
+		{
+			std::vector<uint32_t> fill = adjacency_offsets;
+			for (size_t triangle = 0; triangle < triangle_count; ++triangle)
+			{
+				for (uint32_t corner = 0; corner < 3; ++corner)
+				{
+					adjacency[fill[indices[3 * triangle + corner]]++] = static_cast<uint32_t>(triangle);
+				}
+			}
+		}
+
+		std::vector<uint32_t> cache_timestamps(vertex_count, 0);
+		std::vector<uint8_t> emitted(triangle_count, 0);
+		std::vector<uint32_t> dead_ends;
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+
+		if (p_clusters != nullptr)
+		{
+			p_clusters->clear();
+		}
+
+		uint32_t timestamp = cache_size + 1;
+		size_t cursor = 0;
+		int64_t fanning_vertex = vertex_count > 0 ? 0 : -1;
+		bool dead_end = true;
+
+		while (fanning_vertex >= 0)
+		{
+			uint32_t output_triangle = static_cast<uint32_t>(output.size() / 3);
+			if (dead_end && p_clusters != nullptr && output_triangle < triangle_count && (p_clusters->empty() || p_clusters->back() != output_triangle))
+			{
+				p_clusters->push_back(output_triangle);
+			}
+
+			candidates.clear();
+
+			for (uint32_t i = adjacency_offsets[fanning_vertex]; i < adjacency_offsets[fanning_vertex + 1]; ++i)
+			{
+				uint32_t triangle = adjacency[i];
+				if (emitted[triangle])
+				{
+					continue;
+				}
+
+				for (uint32_t corner = 0; corner < 3; ++corner)
+				{
+					uint32_t vertex = indices[3 * triangle + corner];
+
+					output.push_back(vertex);
+					dead_ends.push_back(vertex);
+					candidates.push_back(vertex);
+					--live_triangles[vertex];
+
+					if (timestamp - cache_timestamps[vertex] > cache_size)
+					{
+						cache_timestamps[vertex] = timestamp++;
+					}
+				}
+
+				emitted[triangle] = 1;
+			}
+
+			// prefer the candidate that will still be cached once all its remaining triangles are emitted
+			fanning_vertex = -1;
+			int64_t best_priority = -1;
+
+			for (uint32_t vertex : candidates)
+			{
+				if (live_triangles[vertex] == 0)
+				{
+					continue;
+				}
+
+				int64_t priority = 0;
+				if (timestamp - cache_timestamps[vertex] + 2 * live_triangles[vertex] <= cache_size)
+				{
+					priority = timestamp - cache_timestamps[vertex];
+				}
+
+				if (priority > best_priority)
+				{
+					best_priority = priority;
+					fanning_vertex = vertex;
+				}
+			}
+
+			dead_end = fanning_vertex < 0;
+
+			if (dead_end)
+			{
+				fanning_vertex = SkipDeadEnd(live_triangles, dead_ends, cursor);
+			}
+		}
+
+		indices.swap(output);
+	}
+
+	// sorts clusters so outward facing ones come first and occlude the rest (Sander et al. 2007)
+	// hard clusters are split into soft ones wherever the local acmr stays within threshold times the
+	// cluster's own, so threshold trades cache efficiency for overdraw - 1.05 costs about 5%
+	static void OptimizeOverdraw(std::vector<uint32_t>& indices, const float* p_positions, size_t position_stride, size_t vertex_count,
+		const std::vector<uint32_t>& hard_clusters, float threshold = 1.05f, uint32_t cache_size = DEFAULT_CACHE_SIZE)
+	{
+		const size_t triangle_count = indices.size() / 3;
+		if (triangle_count == 0 || hard_clusters.empty())
+		{
+			return;
+		}
+
+		auto Position = [p_positions, position_stride](uint32_t vertex)
+		{
+			return reinterpret_cast<const float*>(reinterpret_cast<const char*>(p_positions) + vertex * position_stride);
+		};
+
+		// soft boundaries - restart the simulated cache at each and split once the local acmr is good enough
+		std::vector<uint32_t> clusters;
+		std::vector<uint32_t> cache_timestamps(vertex_count, 0);
+		uint32_t timestamp = cache_size + 1;
+
+		for (size_t hard = 0; hard < hard_clusters.size(); ++hard)
+		{
+			size_t begin = hard_clusters[hard];
+			size_t end = hard + 1 < hard_clusters.size() ? hard_clusters[hard + 1] : triangle_count;
+
+			timestamp += cache_size + 1;
+			size_t hard_misses = 0;
+			for (size_t triangle = begin; triangle < end; ++triangle)
+			{
+				hard_misses += CacheMisses(indices.data() + 3 * triangle, cache_timestamps, timestamp, cache_size);
+			}
+
+			float cluster_threshold = threshold * static_cast<float>(hard_misses) / (end - begin);
+
+			clusters.push_back(static_cast<uint32_t>(begin));
+			timestamp += cache_size + 1;
+			size_t misses = 0;
+			size_t size = 0;
+
+			for (size_t triangle = begin; triangle < end; ++triangle)
+			{
+				misses += CacheMisses(indices.data() + 3 * triangle, cache_timestamps, timestamp, cache_size);
+				++size;
+
+				if (triangle + 1 < end && static_cast<float>(misses) / size <= cluster_threshold)
+				{
+					clusters.push_back(static_cast<uint32_t>(triangle + 1));
+					timestamp += cache_size + 1;
+					misses = 0;
+					size = 0;
+				}
+			}
+		}
+
+		// area weighted centroid of the mesh and of every cluster, plus each cluster's summed normal
+		float mesh_centroid[3] = {};
+		float mesh_area = 0.0f;
+		std::vector<float> cluster_sort_keys(clusters.size());
+		std::vector<float> cluster_data(clusters.size() * 7, 0.0f);	///< centroid xyz * area, normal xyz, area
+
+		for (size_t cluster = 0; cluster < clusters.size(); ++cluster)
+		{
+			size_t begin = clusters[cluster];
+			size_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangle_count;
+			float* p_data = &cluster_data[cluster * 7];
+
+			for (size_t triangle = begin; triangle < end; ++triangle)
+			{
+				const float* p_a = Position(indices[3 * triangle + 0]);
+				const float* p_b = Position(indices[3 * triangle + 1]);
+				const float* p_c = Position(indices[3 * triangle + 2]);
+
+				float ab[3] = { p_b[0] - p_a[0], p_b[1] - p_a[1], p_b[2] - p_a[2] };
+				float ac[3] = { p_c[0] - p_a[0], p_c[1] - p_a[1], p_c[2] - p_a[2] };
+				float normal[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+				float area = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+				for (uint32_t axis = 0; axis < 3; ++axis)
+				{
+					p_data[axis] += (p_a[axis] + p_b[axis] + p_c[axis]) / 3.0f * area;
+					p_data[3 + axis] += normal[axis];
+				}
+				p_data[6] += area;
+			}
+
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				mesh_centroid[axis] += p_data[axis];
+			}
+			mesh_area += p_data[6];
+		}
+
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			mesh_centroid[axis] = mesh_area > 0.0f ? mesh_centroid[axis] / mesh_area : 0.0f;
+		}
+
+		for (size_t cluster = 0; cluster < clusters.size(); ++cluster)
+		{
+			const float* p_data = &cluster_data[cluster * 7];
+			float area = p_data[6] > 0.0f ? p_data[6] : 1.0f;
+			float normal_length = sqrtf(p_data[3] * p_data[3] + p_data[4] * p_data[4] + p_data[5] * p_data[5]);
+			float inverse_length = normal_length > 0.0f ? 1.0f / normal_length : 0.0f;
+
+			float sort_key = 0.0f;
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				sort_key += (p_data[axis] / area - mesh_centroid[axis]) * p_data[3 + axis] * inverse_length;
+			}
+			cluster_sort_keys[cluster] = sort_key;
+		}
+
+		std::vector<uint32_t> order(clusters.size());
+		for (uint32_t cluster = 0; cluster < order.size(); ++cluster)
+		{
+			order[cluster] = cluster;
+		}
+
+		std::stable_sort(order.begin(), order.end(), [&cluster_sort_keys](uint32_t a, uint32_t b)
+		{
+			return cluster_sort_keys[a] > cluster_sort_keys[b];
+		});
+
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+
+		for (uint32_t cluster : order)
+		{
+			size_t begin = clusters[cluster];
+			size_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangle_count;
+			output.insert(output.end(), indices.begin() + 3 * begin, indices.begin() + 3 * end);
+		}
+
+		indices.swap(output);
+	}
+
+	// renumbers vertices in order of first use so the vertex fetch walks the buffer forwards, drops unused vertices
+	template<typename VertexType>
+	static void OptimizeVertexFetch(std::vector<VertexType>& vertices, std::vector<uint32_t>& indices)
+	{
+		const uint32_t UNUSED = ~0u;
+
+		std::vector<uint32_t> remap(vertices.size(), UNUSED);
+		std::vector<VertexType> output;
+		output.reserve(vertices.size());
+
+		for (uint32_t& index : indices)
+		{
+			if (remap[index] == UNUSED)
+			{
+				remap[index] = static_cast<uint32_t>(output.size());
+				output.push_back(vertices[index]);
+			}
+
+			index = remap[index];
+		}
+
+		vertices.swap(output);
+	}
+
+	// converts to 16 bit indices - a mesh that fits stays one submesh and keeps its vertices untouched, larger ones
+	// are cut in triangle order into submeshes of at most MAX_SUBMESH_VERTICES with their vertices laid out
+	// contiguously, vertices used on both sides of a cut are duplicated
+	template<typename VertexType>
+	static void SplitSubmeshes(std::vector<VertexType>& vertices, const std::vector<uint32_t>& indices, std::vector<uint16_t>& output_indices, std::vector<Submesh>& submeshes)
+	{
+		submeshes.clear();
+		output_indices.resize(indices.size());
+
+		if (indices.empty())
+		{
+			return;
+		}
+
+		if (vertices.size() <= MAX_SUBMESH_VERTICES)
+		{
+			for (size_t i = 0; i < indices.size(); ++i)
+			{
+				output_indices[i] = static_cast<uint16_t>(indices[i]);
+			}
+
+			submeshes.push_back({ 0, static_cast<uint32_t>(indices.size()), 0, static_cast<uint32_t>(vertices.size()) });
+			return;
+		}
+
+		const uint32_t NONE = ~0u;
+
+		std::vector<uint32_t> owner(vertices.size(), NONE);	///< last submesh that gave the vertex a local index
+		std::vector<uint16_t> local_index(vertices.size(), 0);
+		std::vector<VertexType> output_vertices;
+		output_vertices.reserve(vertices.size() + vertices.size() / 16);
+
+		Submesh submesh = { 0, 0, 0, 0 };
+		uint32_t submesh_id = 0;
+
+		for (size_t triangle = 0; triangle < indices.size() / 3; ++triangle)
+		{
+			const uint32_t* p_triangle = &indices[3 * triangle];
+
+			uint32_t new_vertices = 0;
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				bool repeated = (corner > 0 && p_triangle[corner] == p_triangle[0]) || (corner > 1 && p_triangle[corner] == p_triangle[1]);
+				new_vertices += owner[p_triangle[corner]] != submesh_id && !repeated ? 1 : 0;
+			}
+
+			if (submesh._vertex_count + new_vertices > MAX_SUBMESH_VERTICES)
+			{
+				submeshes.push_back(submesh);
+				submesh = { static_cast<uint32_t>(3 * triangle), 0, static_cast<int32_t>(output_vertices.size()), 0 };
+				++submesh_id;
+			}
+
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				uint32_t vertex = p_triangle[corner];
+
+				if (owner[vertex] != submesh_id)
+				{
+					owner[vertex] = submesh_id;
+					local_index[vertex] = static_cast<uint16_t>(submesh._vertex_count++);
+					output_vertices.push_back(vertices[vertex]);
+				}
+
+				output_indices[3 * triangle + corner] = local_index[vertex];
+			}
+
+			submesh._index_count += 3;
+		}
+
+		submeshes.push_back(submesh);
+		vertices.swap(output_vertices);
+	}
+
+private:
+	static int64_t SkipDeadEnd(const std::vector<uint32_t>& live_triangles, std::vector<uint32_t>& dead_ends, size_t& cursor)
+	{
+		while (!dead_ends.empty())
+		{
+			uint32_t vertex = dead_ends.back();
+			dead_ends.pop_back();
+
+			if (live_triangles[vertex] > 0)
+			{
+				return vertex;
+			}
+		}
+
+		for (; cursor < live_triangles.size(); ++cursor)
+		{
+			if (live_triangles[cursor] > 0)
+			{
+				return static_cast<int64_t>(cursor);
+			}
+		}
+
+		return -1;
+	}
+
+	static uint32_t CacheMisses(const uint32_t* p_triangle, std::vector<uint32_t>& cache_timestamps, uint32_t& timestamp, uint32_t cache_size)
+	{
+		uint32_t misses = 0;
+
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			if (timestamp - cache_timestamps[p_triangle[corner]] > cache_size)
+			{
+				cache_timestamps[p_triangle[corner]] = timestamp++;
+				++misses;
+			}
+		}
+
+		return misses;
+	}
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_CHAIN_SSE2 1
+#endif
+
+// one mip level inside a tightly packed image blob
+struct ImageLevel
+{
+	uint32_t _width;
+	uint32_t _height;
+	uint64_t _offset;	///< bytes from the start of the blob
+	uint64_t _size;
+};
+
+// cpu mip generation for RGBA8 images, the fallback for formats the gpu cannot blit with linear filtering
+class MipChain
+{
+public:
+	// full chain down to 1x1
+	static uint32_t LevelCount(uint32_t width, uint32_t height)
+	{
+		uint32_t levels = 1;
+		for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+		{
+			++levels;
+		}
+		return levels;
+	}
+
+	// returns all levels back to back starting with a copy of level 0, levels receives where each one lives
+	static std::vector<uint8_t> Build(const uint8_t* p_level_0, uint32_t width, uint32_t height, std::vector<ImageLevel>& levels)
+	{
+		uint32_t level_count = LevelCount(width, height);
+		levels.resize(level_count);
+
+		uint64_t total_size = 0;
+		for (uint32_t level = 0; level < level_count; ++level)
+		{
+			levels[level]._width = std::max(1u, width >> level);
+			levels[level]._height = std::max(1u, height >> level);
+			levels[level]._offset = total_size;
+			levels[level]._size = static_cast<uint64_t>(levels[level]._width) * levels[level]._height * TEXEL_SIZE;
+
+			// 16 byte aligned levels keep every copy region's buffer offset legal
+			total_size += (levels[level]._size + 15) / 16 * 16;
+		}
+
+		std::vector<uint8_t> data(static_cast<size_t>(total_size));
+		memcpy(data.data(), p_level_0, static_cast<size_t>(levels[0]._size));
+
+		for (uint32_t level = 1; level < level_count; ++level)
+		{
+			const ImageLevel& source = levels[level - 1];
+			Downsample(data.data() + source._offset, source._width, source._height, data.data() + levels[level]._offset);
+		}
+
+		return data;
+	}
+
+	// 2x2 box filter into a max(1, width / 2) x max(1, height / 2) image, odd edges clamp to the last texel
+	static void Downsample(const uint8_t* p_source, uint32_t width, uint32_t height, uint8_t* p_destination)
+	{
+		uint32_t destination_width = std::max(1u, width / 2);
+		uint32_t destination_height = std::max(1u, height / 2);
+
+		for (uint32_t y = 0; y < destination_height; ++y)
+		{
+			const uint8_t* p_row_0 = p_source + static_cast<size_t>(std::min(2 * y, height - 1)) * width * TEXEL_SIZE;
+			const uint8_t* p_row_1 = p_source + static_cast<size_t>(std::min(2 * y + 1, height - 1)) * width * TEXEL_SIZE;
+			uint8_t* p_output = p_destination + static_cast<size_t>(y) * destination_width * TEXEL_SIZE;
+
+			uint32_t x = 0;
+
+#ifdef MIP_CHAIN_SSE2
+			// two output texels from four input columns of both rows per iteration
+			if (width >= 2)
+			{
+				const __m128i ROUNDING = _mm_set1_epi16(2);
+				const __m128i ZERO = _mm_setzero_si128();
+
+				for (; x + 2 <= destination_width && 2 * x + 4 <= width; x += 2)
+				{
+					__m128i row_0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_row_0 + 2 * x * TEXEL_SIZE));
+					__m128i row_1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_row_1 + 2 * x * TEXEL_SIZE));
+
+					// vertical sums of texels 0,1 and 2,3 as 16 bit channels
+					__m128i low = _mm_add_epi16(_mm_unpacklo_epi8(row_0, ZERO), _mm_unpacklo_epi8(row_1, ZERO));
+					__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(row_0, ZERO), _mm_unpackhi_epi8(row_1, ZERO));
+
+					// horizontal pair sums land in the low 64 bits of each
+					low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+					high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+
+					__m128i sums = _mm_unpacklo_epi64(low, high);
+					__m128i averages = _mm_srli_epi16(_mm_add_epi16(sums, ROUNDING), 2);
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(p_output + x * TEXEL_SIZE), _mm_packus_epi16(averages, averages));
+				}
+			}
+#endif
+
+			for (; x < destination_width; ++x)
+			{
+				uint32_t x_0 = std::min(2 * x, width - 1);
+				uint32_t x_1 = std::min(2 * x + 1, width - 1);
+
+				for (uint32_t channel = 0; channel < TEXEL_SIZE; ++channel)
+				{
+					uint32_t sum = p_row_0[x_0 * TEXEL_SIZE + channel] + p_row_0[x_1 * TEXEL_SIZE + channel] +
+						p_row_1[x_0 * TEXEL_SIZE + channel] + p_row_1[x_1 * TEXEL_SIZE + channel];
+					p_output[x * TEXEL_SIZE + channel] = static_cast<uint8_t>((sum + 2) / 4);
+				}
+			}
+		}
+	}
+
+private:
+	static const uint32_t TEXEL_SIZE = 4;
+};
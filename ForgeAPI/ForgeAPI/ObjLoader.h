@@ -0,0 +1,427 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+// one triangle corner, 0 based into the ObjMesh attribute arrays - -1 when the face omits the attribute
+struct ObjIndex
+{
+	int32_t _position = -1;
+	int32_t _texcoord = -1;
+	int32_t _normal = -1;
+};
+
+struct ObjMesh
+{
+	std::vector<float> _positions;	///< xyz
+	std::vector<float> _texcoords;	///< uv
+	std::vector<float> _normals;	///< xyz
+	std::vector<ObjIndex> _indices;	///< three per triangle, polygons are fan triangulated
+};
+
+// parses v/vt/vn/f records of a wavefront obj - everything else (groups, materials, lines) is skipped
+// the file is memory mapped and split into line aligned chunks parsed on the thread pool, chunks are then
+// concatenated in file order so the result is identical for any thread count
+class ObjLoader
+{
+public:
+	static ObjMesh Load(const std::string& path, ThreadPool& thread_pool)
+	{
+		MappedFile file;
+		if (!file.Open(path))
+		{
+			throw std::runtime_error("Failed To Open OBJ File!");
+		}
+
+		const char* p_begin = file.Data();
+		const char* p_end = p_begin + file.Size();
+
+		// several chunks per thread so an uneven mix of record types still balances
+		size_t chunk_count = std::max<size_t>(1, std::min<size_t>(file.Size() / MIN_CHUNK_SIZE, thread_pool.ThreadCount() * 8));
+
+		std::vector<const char*> boundaries(chunk_count + 1, p_end);
+		boundaries[0] = p_begin;
+
+		for (size_t i = 1; i < chunk_count; ++i)
+		{
+			const char* p = std::max(boundaries[i - 1], p_begin + file.Size() * i / chunk_count);
+			p = static_cast<const char*>(memchr(p, '\n', p_end - p));
+			boundaries[i] = p != nullptr ? p + 1 : p_end;
+		}
+
+		std::vector<ObjChunk> chunks(chunk_count);
+
+		thread_pool.ParallelFor(static_cast<uint32_t>(chunk_count), [&](uint32_t i)
+		{
+			ParseChunk(boundaries[i], boundaries[i + 1], chunks[i]);
+		});
+
+		return Merge(chunks, thread_pool);
+	}
+
+	// decimal or scientific notation, p is advanced past the number
+	static float ParseFloat(const char*& p, const char* p_end)
+	{
+		static const double POW10[] =
+		{
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		bool negative = false;
+		if (p < p_end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			++p;
+		}
+
+		uint64_t mantissa = 0;
+		int32_t significant_digits = 0;
+		int32_t exponent = 0;
+
+		ParseDigits(p, p_end, mantissa, significant_digits, exponent, false);
+
+		if (p < p_end && *p == '.')
+		{
+			++p;
+			ParseDigits(p, p_end, mantissa, significant_digits, exponent, true);
+		}
+
+		if (p < p_end && (*p == 'e' || *p == 'E'))
+		{
+			++p;
+			exponent += ParseInt(p, p_end);
+		}
+
+		double value = static_cast<double>(mantissa);
+
+		if (exponent < 0)
+		{
+			value = -exponent <= 22 ? value / POW10[-exponent] : value * std::pow(10.0, exponent);
+		}
+		else if (exponent > 0)
+		{
+			value = exponent <= 22 ? value * POW10[exponent] : value * std::pow(10.0, exponent);
+		}
+
+		return static_cast<float>(negative ? -value : value);
+	}
+
+private:
+	static const size_t MIN_CHUNK_SIZE = 256 * 1024;
+	static const int32_t MAX_SIGNIFICANT_DIGITS = 19;	///< what fits a uint64_t mantissa, more digits cannot change a float
+
+	// face indices are 1 based, negative ones count back from the newest attribute - those are stored relative
+	// to the chunk start and fixed up once the attribute counts of all earlier chunks are known
+	struct RelativeIndex
+	{
+		uint32_t _slot;		///< position in ObjChunk::_indices
+		uint8_t _mask;		///< 1 position, 2 texcoord, 4 normal
+	};
+
+	struct ObjChunk
+	{
+		std::vector<float> _positions;
+		std::vector<float> _texcoords;
+		std::vector<float> _normals;
+		std::vector<ObjIndex> _indices;
+		std::vector<RelativeIndex> _relative_indices;
+		bool _invalid_index = false;
+	};
+
+	static bool IsDigit(char c)
+	{
+		return static_cast<unsigned char>(c - '0') < 10;
+	}
+
+	static bool IsBlank(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	static void SkipBlanks(const char*& p, const char* p_end)
+	{
+		while (p < p_end && IsBlank(*p))
+		{
+			++p;
+		}
+	}
+
+	// swar check that all 8 bytes are '0'..'9'
+	static bool IsEightDigits(uint64_t chunk)
+	{
+		return ((chunk & 0xF0F0F0F0F0F0F0F0ull) | (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+	}
+
+	// converts 8 ascii digits (first digit in the lowest byte) with three multiplies instead of eight
+	static uint32_t ParseEightDigits(uint64_t chunk)
+	{
+		chunk -= 0x3030303030303030ull;
+		chunk = (chunk * 10) + (chunk >> 8);
+		chunk = (((chunk & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) + (((chunk >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+		return static_cast<uint32_t>(chunk);
+	}
+
+	// fraction digits lower the exponent, integer digits beyond what the mantissa holds raise it
+	static void ParseDigits(const char*& p, const char* p_end, uint64_t& mantissa, int32_t& significant_digits, int32_t& exponent, bool fraction)
+	{
+		while (p_end - p >= 8 && significant_digits + 8 <= MAX_SIGNIFICANT_DIGITS)
+		{
+			uint64_t chunk;
+			memcpy(&chunk, p, sizeof(chunk));
+
+			if (!IsEightDigits(chunk))
+			{
+				break;
+			}
+
+			mantissa = mantissa * 100000000ull + ParseEightDigits(chunk);
+			significant_digits += 8;
+			exponent -= fraction ? 8 : 0;
+			p += 8;
+		}
+
+		while (p < p_end && IsDigit(*p))
+		{
+			if (significant_digits < MAX_SIGNIFICANT_DIGITS)
+			{
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+				significant_digits += mantissa != 0 ? 1 : 0;
+				exponent -= fraction ? 1 : 0;
+			}
+			else if (!fraction)
+			{
+				++exponent;
+			}
+
+			++p;
+		}
+	}
+
+	static int32_t ParseInt(const char*& p, const char* p_end)
+	{
+		bool negative = false;
+		if (p < p_end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			++p;
+		}
+
+		int32_t value = 0;
+		while (p < p_end && IsDigit(*p))
+		{
+			value = value * 10 + (*p - '0');
+			++p;
+		}
+
+		return negative ? -value : value;
+	}
+
+	static void ParseFloats(const char*& p, const char* p_end, std::vector<float>& output, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			SkipBlanks(p, p_end);
+			output.push_back(ParseFloat(p, p_end));
+		}
+	}
+
+	// turns one face index into a chunk local value - returns true when it is relative to the chunk start
+	static bool ResolveIndex(int32_t raw, size_t local_count, int32_t& index)
+	{
+		if (raw > 0)
+		{
+			index = raw - 1;
+			return false;
+		}
+
+		index = raw < 0 ? static_cast<int32_t>(local_count) + raw : -1;
+		return raw < 0;
+	}
+
+	static void ParseFace(const char*& p, const char* p_end, ObjChunk& chunk, std::vector<ObjIndex>& polygon, std::vector<uint8_t>& polygon_masks)
+	{
+		polygon.clear();
+		polygon_masks.clear();
+
+		for (;;)
+		{
+			SkipBlanks(p, p_end);
+
+			if (p >= p_end || !(IsDigit(*p) || *p == '-'))
+			{
+				break;
+			}
+
+			ObjIndex corner;
+			uint8_t mask = 0;
+
+			mask |= ResolveIndex(ParseInt(p, p_end), chunk._positions.size() / 3, corner._position) ? 1 : 0;
+
+			if (p < p_end && *p == '/')
+			{
+				++p;
+
+				if (p < p_end && *p != '/')
+				{
+					mask |= ResolveIndex(ParseInt(p, p_end), chunk._texcoords.size() / 2, corner._texcoord) ? 2 : 0;
+				}
+
+				if (p < p_end && *p == '/')
+				{
+					++p;
+					mask |= ResolveIndex(ParseInt(p, p_end), chunk._normals.size() / 3, corner._normal) ? 4 : 0;
+				}
+			}
+
+			polygon.push_back(corner);
+			polygon_masks.push_back(mask);
+		}
+
+		if (polygon.size() < 3)
+		{
+			chunk._invalid_index = chunk._invalid_index || !polygon.empty();
+			return;
+		}
+
+		for (size_t i = 1; i + 1 < polygon.size(); ++i)
+		{
+			const size_t fan[] = { 0, i, i + 1 };
+
+			for (size_t corner : fan)
+			{
+				if (polygon_masks[corner] != 0)
+				{
+					chunk._relative_indices.push_back({ static_cast<uint32_t>(chunk._indices.size()), polygon_masks[corner] });
+				}
+
+				chunk._indices.push_back(polygon[corner]);
+			}
+		}
+	}
+
+	static void ParseChunk(const char* p, const char* p_end, ObjChunk& chunk)
+	{
+		std::vector<ObjIndex> polygon;
+		std::vector<uint8_t> polygon_masks;
+
+		while (p < p_end)
+		{
+			SkipBlanks(p, p_end);
+
+			if (p_end - p >= 2 && p[0] == 'v')
+			{
+				if (IsBlank(p[1]))
+				{
+					p += 2;
+					ParseFloats(p, p_end, chunk._positions, 3);
+				}
+				else if (p[1] == 't' && p_end - p >= 3 && IsBlank(p[2]))
+				{
+					p += 3;
+					ParseFloats(p, p_end, chunk._texcoords, 2);
+				}
+				else if (p[1] == 'n' && p_end - p >= 3 && IsBlank(p[2]))
+				{
+					p += 3;
+					ParseFloats(p, p_end, chunk._normals, 3);
+				}
+			}
+			else if (p_end - p >= 2 && p[0] == 'f' && IsBlank(p[1]))
+			{
+				p += 2;
+				ParseFace(p, p_end, chunk, polygon, polygon_masks);
+			}
+
+			// rest of the record (w components, vertex colors, comments) is ignored
+			const char* p_line_end = static_cast<const char*>(memchr(p, '\n', p_end - p));
+			p = p_line_end != nullptr ? p_line_end + 1 : p_end;
+		}
+	}
+
+	static ObjMesh Merge(std::vector<ObjChunk>& chunks, ThreadPool& thread_pool)
+	{
+		struct ChunkBase
+		{
+			size_t _positions = 0;
+			size_t _texcoords = 0;
+			size_t _normals = 0;
+			size_t _indices = 0;
+		};
+
+		std::vector<ChunkBase> bases(chunks.size() + 1);
+
+		for (size_t i = 0; i < chunks.size(); ++i)
+		{
+			bases[i + 1]._positions = bases[i]._positions + chunks[i]._positions.size();
+			bases[i + 1]._texcoords = bases[i]._texcoords + chunks[i]._texcoords.size();
+			bases[i + 1]._normals = bases[i]._normals + chunks[i]._normals.size();
+			bases[i + 1]._indices = bases[i]._indices + chunks[i]._indices.size();
+		}
+
+		const ChunkBase& totals = bases.back();
+
+		ObjMesh mesh;
+		mesh._positions.resize(totals._positions);
+		mesh._texcoords.resize(totals._texcoords);
+		mesh._normals.resize(totals._normals);
+		mesh._indices.resize(totals._indices);
+
+		const int32_t position_count = static_cast<int32_t>(totals._positions / 3);
+		const int32_t texcoord_count = static_cast<int32_t>(totals._texcoords / 2);
+		const int32_t normal_count = static_cast<int32_t>(totals._normals / 3);
+
+		std::atomic<bool> invalid_index = { false };
+
+		thread_pool.ParallelFor(static_cast<uint32_t>(chunks.size()), [&](uint32_t i)
+		{
+			ObjChunk& chunk = chunks[i];
+			const ChunkBase& base = bases[i];
+
+			std::copy(chunk._positions.begin(), chunk._positions.end(), mesh._positions.begin() + base._positions);
+			std::copy(chunk._texcoords.begin(), chunk._texcoords.end(), mesh._texcoords.begin() + base._texcoords);
+			std::copy(chunk._normals.begin(), chunk._normals.end(), mesh._normals.begin() + base._normals);
+
+			for (const RelativeIndex& relative : chunk._relative_indices)
+			{
+				ObjIndex& index = chunk._indices[relative._slot];
+				index._position += (relative._mask & 1) ? static_cast<int32_t>(base._positions / 3) : 0;
+				index._texcoord += (relative._mask & 2) ? static_cast<int32_t>(base._texcoords / 2) : 0;
+				index._normal += (relative._mask & 4) ? static_cast<int32_t>(base._normals / 3) : 0;
+			}
+
+			bool invalid = chunk._invalid_index;
+
+			for (const ObjIndex& index : chunk._indices)
+			{
+				invalid = invalid || index._position < 0 || index._position >= position_count ||
+					index._texcoord < -1 || index._texcoord >= texcoord_count || index._normal < -1 || index._normal >= normal_count;
+			}
+
+			std::copy(chunk._indices.begin(), chunk._indices.end(), mesh._indices.begin() + base._indices);
+
+			if (invalid)
+			{
+				invalid_index = true;
+			}
+
+			chunk = ObjChunk();
+		});
+
+		if (invalid_index)
+		{
+			throw std::runtime_error("Invalid OBJ Face Index!");
+		}
+
+		return mesh;
+	}
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "AtomicFile.h"
+#include "Hash.h"
+#include "MappedFile.h"
+
+const uint32_t PIPELINE_CACHE_MAGIC = 0x43504646;	///< "FFPC"
+const uint32_t PIPELINE_CACHE_VERSION = 1;
+
+// our own header in front of the driver blob - drivers are not required to survive truncated or corrupt data
+struct PipelineCacheFileHeader
+{
+	uint32_t _magic;
+	uint32_t _version;
+	uint64_t _data_size;
+	uint64_t _data_hash;
+};
+
+// one VkPipelineCache shared by every pipeline the application creates, seeded from disk at startup
+// and written back on release so the next run (and every swapchain recreation) skips shader compilation
+class PipelineCache
+{
+public:
+	void Initialize(VkPhysicalDevice physical_device, VkDevice device, const std::string& path)
+	{
+		_vk_device = device;
+		_path = path;
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+		MappedFile file(path);
+		const char* p_data = nullptr;
+		size_t data_size = 0;
+
+		if (file.IsOpen() && file.Size() >= sizeof(PipelineCacheFileHeader))
+		{
+			PipelineCacheFileHeader header;
+			memcpy(&header, file.Data(), sizeof(header));
+
+			p_data = file.Data() + sizeof(header);
+			data_size = file.Size() - sizeof(header);
+
+			bool valid = header._magic == PIPELINE_CACHE_MAGIC && header._version == PIPELINE_CACHE_VERSION &&
+				header._data_size == data_size && header._data_hash == Hash::Bytes(p_data, data_size) &&
+				MatchesDevice(p_data, data_size, properties);
+
+			if (!valid)
+			{
+				p_data = nullptr;
+				data_size = 0;
+			}
+		}
+
+		VkPipelineCacheCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		create_info.initialDataSize = data_size;
+		create_info.pInitialData = p_data;
+
+		if (vkCreatePipelineCache(device, &create_info, nullptr, &_vk_pipeline_cache) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Pipeline Cache!");
+		}
+
+		_loaded_from_disk = data_size > 0;
+	}
+
+	// saves the cache, a failed write only costs the next startup its warm pipelines
+	void Release()
+	{
+		if (_vk_pipeline_cache == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		if (!Save())
+		{
+			fprintf(stderr, "Failed to write pipeline cache %s\n", _path.c_str());
+		}
+
+		vkDestroyPipelineCache(_vk_device, _vk_pipeline_cache, nullptr);
+		_vk_pipeline_cache = VK_NULL_HANDLE;
+	}
+
+	// false when the driver blob could not be read or the file not be replaced
+	bool Save() const
+	{
+		size_t data_size = 0;
+		if (vkGetPipelineCacheData(_vk_device, _vk_pipeline_cache, &data_size, nullptr) != VK_SUCCESS)
+		{
+			return false;
+		}
+
+		std::vector<char> data(data_size);
+		if (data_size > 0 && vkGetPipelineCacheData(_vk_device, _vk_pipeline_cache, &data_size, data.data()) != VK_SUCCESS)
+		{
+			return false;
+		}
+
+		PipelineCacheFileHeader header = {};
+		header._magic = PIPELINE_CACHE_MAGIC;
+		header._version = PIPELINE_CACHE_VERSION;
+		header._data_size = data_size;
+		header._data_hash = Hash::Bytes(data.data(), data_size);
+
+		// the last good cache stays on disk until the new one is complete
+		AtomicFile file(_path);
+		file.Write(&header, sizeof(header));
+		file.Write(data.data(), data_size);
+
+		return file.Commit();
+	}
+
+	VkPipelineCache Handle() const
+	{
+		return _vk_pipeline_cache;
+	}
+
+	// true when the cache was seeded from a file written by this device and driver
+	bool LoadedFromDisk() const
+	{
+		return _loaded_from_disk;
+	}
+
+private:
+	// the blob starts with the VK_PIPELINE_CACHE_HEADER_VERSION_ONE header - a driver update changes the uuid
+	static bool MatchesDevice(const char* p_data, size_t data_size, const VkPhysicalDeviceProperties& properties)
+	{
+		const size_t HEADER_SIZE = 16 + VK_UUID_SIZE;
+
+		if (data_size < HEADER_SIZE)
+		{
+			return false;
+		}
+
+		uint32_t header_size;
+		uint32_t header_version;
+		uint32_t vendor_id;
+		uint32_t device_id;
+		memcpy(&header_size, p_data, sizeof(uint32_t));
+		memcpy(&header_version, p_data + 4, sizeof(uint32_t));
+		memcpy(&vendor_id, p_data + 8, sizeof(uint32_t));
+		memcpy(&device_id, p_data + 12, sizeof(uint32_t));
+
+		return header_size >= HEADER_SIZE && header_size <= data_size && header_version == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			vendor_id == properties.vendorID && device_id == properties.deviceID &&
+			memcmp(p_data + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+
+	// BEGIN PRIVATE MEMBERS
+	VkDevice _vk_device = VK_NULL_HANDLE;
+	VkPipelineCache _vk_pipeline_cache = VK_NULL_HANDLE;
+	std::string _path;
+	bool _loaded_from_disk = false;
+	// END PRIVATE MEMBERS
+};
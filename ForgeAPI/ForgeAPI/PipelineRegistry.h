@@ -0,0 +1,351 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Hash.h"
+#include "ThreadPool.h"
+
+enum class BlendMode : uint8_t
+{
+	Opaque,
+	Alpha,		///< src alpha, one minus src alpha
+	Additive,	///< one, one
+};
+
+// everything that makes two pipelines differ, packed without padding so it is hashed and compared as bytes
+// handles do not belong in here - shaders are identified by their spir-v hash, the render pass by what its
+// compatibility depends on, so equal states stay equal across shader reloads and swapchain rebuilds
+struct PipelineState
+{
+	uint64_t _vertex_shader = 0;		///< PipelineRegistry::AddShader hashes, 0 for unused stages
+	uint64_t _fragment_shader = 0;
+	uint64_t _compute_shader = 0;		///< set for compute pipelines, which only use this and _layout
+	uint64_t _vertex_layout = 0;		///< hash of the vertex input bindings and attributes
+	uint64_t _render_pass = 0;			///< hash of the attachment formats and sample counts
+	uint32_t _layout = 0;				///< application defined pipeline layout id
+	uint32_t _sample_count = VK_SAMPLE_COUNT_1_BIT;
+	uint8_t _topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	uint8_t _polygon_mode = VK_POLYGON_MODE_FILL;
+	uint8_t _cull_mode = VK_CULL_MODE_BACK_BIT;
+	uint8_t _front_face = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	uint8_t _blend_mode = static_cast<uint8_t>(BlendMode::Opaque);
+	uint8_t _depth_test = 1;
+	uint8_t _depth_write = 1;
+	uint8_t _depth_compare = VK_COMPARE_OP_LESS;
+};
+
+static_assert(sizeof(PipelineState) == 56, "PipelineState Must Not Contain Padding!");
+
+typedef uint32_t PipelineHandle;
+
+const PipelineHandle INVALID_PIPELINE = UINT32_MAX;
+
+// runs on a compile worker - creates the pipeline state describes against the render pass it was requested with,
+// throws on failure
+typedef std::function<VkPipeline(const PipelineState& state, VkRenderPass render_pass)> PipelineFactory;
+
+// every pipeline the renderer uses, deduplicated by state - requesting a new state returns a handle straight away and
+// compiles the pipeline on worker threads, Get returns VK_NULL_HANDLE until it is ready so draws can keep using
+// another variant or skip. pipelines and shader modules live until Release, or until the caller destroys what Evict
+// took out when their render pass goes away
+class PipelineRegistry
+{
+public:
+	void Initialize(VkDevice device, PipelineFactory factory, uint32_t compile_threads)
+	{
+		_vk_device = device;
+		_factory = std::move(factory);
+		_pending_compiles = 0;
+
+		// the pool counts its caller as a thread, Submit only ever reaches the workers
+		_p_compile_pool.reset(new ThreadPool(compile_threads + 1));
+	}
+
+	// waits for every compile, then destroys all pipelines and shader modules
+	void Release()
+	{
+		_p_compile_pool.reset();
+
+		for (std::unique_ptr<Entry>& p_entry : _entries)
+		{
+			if (p_entry->_vk_pipeline != VK_NULL_HANDLE)
+			{
+				vkDestroyPipeline(_vk_device, p_entry->_vk_pipeline, nullptr);
+			}
+		}
+		_entries.clear();
+		_handles.clear();
+
+		for (auto& shader : _shaders)
+		{
+			vkDestroyShaderModule(_vk_device, shader.second, nullptr);
+		}
+		_shaders.clear();
+	}
+
+	// main thread - returns the spir-v hash that goes into PipelineState, the module is created once per content
+	uint64_t AddShader(const std::vector<char>& spirv)
+	{
+		uint64_t hash = Hash::Bytes(spirv.data(), spirv.size());
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (_shaders.find(hash) != _shaders.end())
+		{
+			return hash;
+		}
+
+		VkShaderModuleCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		create_info.codeSize = spirv.size();
+		create_info.pCode = reinterpret_cast<const uint32_t*>(spirv.data());
+
+		VkShaderModule shader_module;
+		if (vkCreateShaderModule(_vk_device, &create_info, nullptr, &shader_module) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Shader Module!");
+		}
+
+		_shaders[hash] = shader_module;
+
+		return hash;
+	}
+
+	// any thread, VK_NULL_HANDLE for unknown hashes
+	VkShaderModule Shader(uint64_t hash) const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto shader = _shaders.find(hash);
+		return shader != _shaders.end() ? shader->second : VK_NULL_HANDLE;
+	}
+
+	// main thread - the existing handle for a known state, otherwise a new one whose pipeline is queued for compiling
+	// render_pass is handed to the factory as it was at request time, VK_NULL_HANDLE for compute pipelines
+	PipelineHandle Request(const PipelineState& state, VkRenderPass render_pass = VK_NULL_HANDLE)
+	{
+		++_request_count;
+
+		auto handle = _handles.find(state);
+		if (handle != _handles.end())
+		{
+			return handle->second;
+		}
+
+		PipelineHandle new_handle = static_cast<PipelineHandle>(_entries.size());
+
+		_entries.emplace_back(new Entry());
+		Entry* p_entry = _entries.back().get();
+		p_entry->_state = state;
+		p_entry->_vk_render_pass = render_pass;
+		_handles[state] = new_handle;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			++_pending_compiles;
+		}
+
+		_p_compile_pool->Submit([this, p_entry]()
+		{
+			Compile(*p_entry);
+		});
+
+		return new_handle;
+	}
+
+	// VK_NULL_HANDLE while compiling or after a failure
+	VkPipeline Get(PipelineHandle handle) const
+	{
+		const Entry& entry = *_entries[handle];
+		return entry._status.load(std::memory_order_acquire) == Status::Ready ? entry._vk_pipeline : VK_NULL_HANDLE;
+	}
+
+	bool IsFailed(PipelineHandle handle) const
+	{
+		return _entries[handle]->_status.load(std::memory_order_acquire) == Status::Failed;
+	}
+
+	// true while a worker still compiles the pipeline, and so still reads its render pass
+	bool IsPending(PipelineHandle handle) const
+	{
+		return _entries[handle]->_status.load(std::memory_order_acquire) == Status::Pending;
+	}
+
+	// what the factory threw, only valid once IsFailed
+	const std::string& Error(PipelineHandle handle) const
+	{
+		return _entries[handle]->_error;
+	}
+
+	// seconds the factory took, only valid once the pipeline is ready
+	double CompileSeconds(PipelineHandle handle) const
+	{
+		return _entries[handle]->_compile_seconds;
+	}
+
+	// blocks until the pipeline is ready and throws when it failed - only for pipelines nothing can stand in for
+	VkPipeline Wait(PipelineHandle handle)
+	{
+		Entry& entry = *_entries[handle];
+
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_compiled.wait(lock, [&entry]() { return entry._status.load(std::memory_order_acquire) != Status::Pending; });
+		}
+
+		if (entry._status == Status::Failed)
+		{
+			throw std::runtime_error(entry._error);
+		}
+
+		return entry._vk_pipeline;
+	}
+
+	// blocks until nothing is compiling - call before destroying anything the factory reads, e.g. the pipeline layouts
+	void WaitIdle()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_compiled.wait(lock, [this]() { return _pending_compiles == 0; });
+	}
+
+	// main thread - takes every pipeline requested with render_pass out of the registry, so a later request for the
+	// same state compiles a new one. the caller passes the handles to Destroy once they are neither pending nor used
+	// by a submit in flight
+	std::vector<PipelineHandle> Evict(VkRenderPass render_pass)
+	{
+		std::vector<PipelineHandle> evicted;
+
+		for (auto handle = _handles.begin(); handle != _handles.end();)
+		{
+			if (_entries[handle->second]->_vk_render_pass == render_pass)
+			{
+				evicted.push_back(handle->second);
+				handle = _handles.erase(handle);
+			}
+			else
+			{
+				++handle;
+			}
+		}
+
+		return evicted;
+	}
+
+	// main thread - only for evicted handles that are no longer pending, Get returns VK_NULL_HANDLE afterwards
+	void Destroy(PipelineHandle handle)
+	{
+		Entry& entry = *_entries[handle];
+
+		if (entry._vk_pipeline != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(_vk_device, entry._vk_pipeline, nullptr);
+			entry._vk_pipeline = VK_NULL_HANDLE;
+		}
+	}
+
+	// distinct pipelines
+	uint32_t Size() const
+	{
+		return static_cast<uint32_t>(_entries.size());
+	}
+
+	// requests including the deduplicated ones
+	uint64_t RequestCount() const
+	{
+		return _request_count;
+	}
+
+	// the compact key the registry is indexed with
+	static uint64_t Key(const PipelineState& state)
+	{
+		return Hash::Bytes(&state, sizeof(state));
+	}
+
+private:
+	enum class Status : uint32_t
+	{
+		Pending,
+		Ready,
+		Failed,
+	};
+
+	struct Entry
+	{
+		PipelineState _state;
+		VkRenderPass _vk_render_pass = VK_NULL_HANDLE;
+		std::atomic<Status> _status = { Status::Pending };	///< published with release once the fields below are written
+		VkPipeline _vk_pipeline = VK_NULL_HANDLE;
+		std::string _error;
+		double _compile_seconds = 0.0;
+	};
+
+	struct StateHash
+	{
+		size_t operator()(const PipelineState& state) const
+		{
+			return static_cast<size_t>(Key(state));
+		}
+	};
+
+	// a matching key alone could be a collision, equal bytes are not
+	struct StateEqual
+	{
+		bool operator()(const PipelineState& a, const PipelineState& b) const
+		{
+			return memcmp(&a, &b, sizeof(PipelineState)) == 0;
+		}
+	};
+
+	// compile worker
+	void Compile(Entry& entry)
+	{
+		auto start_time = std::chrono::high_resolution_clock::now();
+
+		try
+		{
+			entry._vk_pipeline = _factory(entry._state, entry._vk_render_pass);
+			entry._compile_seconds = std::chrono::duration<double, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - start_time).count();
+			entry._status.store(Status::Ready, std::memory_order_release);
+		}
+		catch (const std::exception& e)
+		{
+			entry._error = e.what();
+			entry._status.store(Status::Failed, std::memory_order_release);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			--_pending_compiles;
+		}
+		_compiled.notify_all();
+	}
+
+	// BEGIN PRIVATE MEMBERS
+	VkDevice _vk_device = VK_NULL_HANDLE;
+	PipelineFactory _factory;
+	std::unique_ptr<ThreadPool> _p_compile_pool;
+
+	std::vector<std::unique_ptr<Entry>> _entries;	///< indexed by handle, main thread only - workers hold their entry
+	std::unordered_map<PipelineState, PipelineHandle, StateHash, StateEqual> _handles;
+	uint64_t _request_count = 0;
+
+	mutable std::mutex _mutex;
+	std::condition_variable _compiled;
+	std::unordered_map<uint64_t, VkShaderModule> _shaders;	///< guarded by _mutex, workers look modules up while new ones are added
+	uint32_t _pending_compiles = 0;	///< guarded by _mutex
+	// END PRIVATE MEMBERS
+};
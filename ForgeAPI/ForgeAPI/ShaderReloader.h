@@ -0,0 +1,277 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "DirectoryWatcher.h"
+#include "ThreadPool.h"
+
+// one glsl source compiled into one spir-v file, the same as a line of Shaders/compileSPIRV.bat
+struct ShaderCompileRule
+{
+	std::string _source;	///< relative to the watched directory
+	std::string _output;
+	std::string _arguments;	///< extra compiler arguments, e.g. defines
+};
+
+// what one rebuild produced
+struct ShaderReload
+{
+	std::vector<std::string> _changed;	///< watched files that triggered it
+	std::vector<std::string> _outputs;	///< spir-v files that changed, compiled by the rebuild or by hand
+	std::vector<std::vector<char>> _spirv;	///< contents of _outputs, read on the worker
+	std::string _error;					///< non empty when anything failed, no spir-v is handed over then
+	std::chrono::high_resolution_clock::time_point _change_time;	///< first change the rebuild covers
+	double _compile_seconds = 0.0;		///< glsl to spir-v
+};
+
+// shader hot reload - watches the shader directory and recompiles changed glsl on a worker thread. the frame loop
+// polls Update at the frame boundary and hands the new spir-v to the pipeline registry, which rebuilds the pipelines
+// using it asynchronously as well. one rebuild runs at a time, changes arriving meanwhile are batched into the next one
+class ShaderReloader
+{
+public:
+	// rule outputs are watched as well, so spir-v compiled by hand is picked up - false when the directory cannot be
+	// watched on this platform
+	bool Initialize(const std::string& directory, const std::string& compiler, std::vector<ShaderCompileRule> rules)
+	{
+		_directory = directory;
+		_compiler = compiler;
+		_rules = std::move(rules);
+
+		std::vector<std::string> names;
+		for (const ShaderCompileRule& rule : _rules)
+		{
+			AddUnique(names, rule._source);
+			AddUnique(names, rule._output);
+		}
+
+		if (!_watcher.Open(directory, names))
+		{
+			return false;
+		}
+
+		// the pool counts its caller as a thread, Submit only ever reaches the worker
+		_p_worker.reset(new ThreadPool(2));
+
+		return true;
+	}
+
+	// waits for a running rebuild
+	void Release()
+	{
+		_p_worker.reset();
+		_watcher.Close();
+		_p_finished.reset();
+		_running = false;
+		_pending.clear();
+	}
+
+	bool IsWatching() const
+	{
+		return _watcher.IsOpen();
+	}
+
+	// main thread, once per frame at the frame boundary - never waits for the worker. returns true and fills finished
+	// when a rebuild completed since the last call, starts the next one when files changed meanwhile
+	bool Update(ShaderReload& finished)
+	{
+		bool has_result = false;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (_p_finished)
+			{
+				finished = std::move(*_p_finished);
+				_p_finished.reset();
+				has_result = true;
+			}
+		}
+
+		// polled after taking the result, so the events of the spir-v files the rebuild wrote are already queued
+		std::vector<std::string> changed;
+		_watcher.Poll(changed);
+
+		if (has_result)
+		{
+			_running = false;
+
+			for (const std::string& output : _written_outputs)
+			{
+				changed.erase(std::remove(changed.begin(), changed.end(), output), changed.end());
+				_pending.erase(std::remove(_pending.begin(), _pending.end(), output), _pending.end());
+			}
+			_written_outputs.clear();
+		}
+
+		if (!changed.empty() && _pending.empty())
+		{
+			_pending_time = std::chrono::high_resolution_clock::now();
+		}
+
+		for (const std::string& name : changed)
+		{
+			AddUnique(_pending, name);
+		}
+
+		if (!_running && !_pending.empty())
+		{
+			StartRebuild();
+		}
+
+		return has_result;
+	}
+
+	// glslangValidator from the vulkan sdk when VULKAN_SDK is set, otherwise whichever is on the path
+	static std::string DefaultCompiler()
+	{
+		const char* p_sdk = getenv("VULKAN_SDK");
+		if (p_sdk == nullptr || *p_sdk == '\0')
+		{
+			return "glslangValidator";
+		}
+
+#ifdef _WIN32
+		return std::string(p_sdk) + "\\Bin\\glslangValidator.exe";
+#else
+		return std::string(p_sdk) + "/bin/glslangValidator";
+#endif
+	}
+
+private:
+	static void AddUnique(std::vector<std::string>& names, const std::string& name)
+	{
+		if (std::find(names.begin(), names.end(), name) == names.end())
+		{
+			names.push_back(name);
+		}
+	}
+
+	static bool Contains(const std::vector<std::string>& names, const std::string& name)
+	{
+		return std::find(names.begin(), names.end(), name) != names.end();
+	}
+
+	// a changed source recompiles its outputs, a changed output - compiled by hand - is only read back
+	void StartRebuild()
+	{
+		std::vector<std::string> changed;
+		changed.swap(_pending);
+
+		std::vector<uint32_t> rules;
+		std::vector<std::string> outputs;
+
+		for (uint32_t i = 0; i < _rules.size(); ++i)
+		{
+			if (Contains(changed, _rules[i]._source))
+			{
+				rules.push_back(i);
+				AddUnique(_written_outputs, _rules[i]._output);
+			}
+
+			if (Contains(changed, _rules[i]._source) || Contains(changed, _rules[i]._output))
+			{
+				AddUnique(outputs, _rules[i]._output);
+			}
+		}
+
+		_running = true;
+
+		std::chrono::high_resolution_clock::time_point change_time = _pending_time;
+
+		_p_worker->Submit([this, changed, rules, outputs, change_time]()
+		{
+			ShaderReload reload;
+			reload._changed = changed;
+			reload._outputs = outputs;
+			reload._change_time = change_time;
+
+			Rebuild(rules, reload);
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			_p_finished.reset(new ShaderReload(std::move(reload)));
+		});
+	}
+
+	// worker thread - everything it reads was fixed at Initialize
+	void Rebuild(const std::vector<uint32_t>& rules, ShaderReload& reload)
+	{
+		try
+		{
+			auto compile_start = std::chrono::high_resolution_clock::now();
+
+			for (uint32_t rule : rules)
+			{
+				Compile(_rules[rule]);
+			}
+
+			reload._compile_seconds = std::chrono::duration<double, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - compile_start).count();
+
+			for (const std::string& output : reload._outputs)
+			{
+				reload._spirv.push_back(ReadSpirv(_directory + "/" + output));
+			}
+		}
+		catch (const std::exception& e)
+		{
+			reload._error = e.what();
+			reload._spirv.clear();
+		}
+	}
+
+	static std::vector<char> ReadSpirv(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::ate | std::ios::binary);
+
+		if (!file.is_open())
+		{
+			throw std::runtime_error("Failed To Open " + path + "!");
+		}
+
+		std::vector<char> spirv(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(spirv.data(), spirv.size());
+
+		return spirv;
+	}
+
+	void Compile(const ShaderCompileRule& rule) const
+	{
+		std::string command = "\"" + _compiler + "\" -V " + rule._arguments + " \"" + _directory + "/" + rule._source + "\" -o \"" + _directory + "/" + rule._output + "\"";
+
+#ifdef _WIN32
+		// cmd strips the outer quotes of a command that starts with one
+		command = "\"" + command + "\"";
+#endif
+
+		if (std::system(command.c_str()) != 0)
+		{
+			throw std::runtime_error("Failed To Compile " + rule._source + "!");
+		}
+	}
+
+	// BEGIN PRIVATE MEMBERS
+	std::string _directory;
+	std::string _compiler;
+	std::vector<ShaderCompileRule> _rules;
+	DirectoryWatcher _watcher;
+	std::unique_ptr<ThreadPool> _p_worker;
+
+	std::vector<std::string> _pending;	///< changed since the running rebuild started
+	std::chrono::high_resolution_clock::time_point _pending_time;
+	std::vector<std::string> _written_outputs;	///< spir-v the running rebuild compiles, its own writes are not changes
+	bool _running = false;	///< main thread view, cleared once Update took the result
+
+	std::mutex _mutex;
+	std::unique_ptr<ShaderReload> _p_finished;	///< guarded by _mutex
+	// END PRIVATE MEMBERS
+};
@@ -1,3 +1,17 @@
-C:\VulkanSDK\1.0.65.1\Bin32\glslangValidator.exe -V shader.vert
-C:\VulkanSDK\1.0.65.1\Bin32\glslangValidator.exe -V shader.frag
-pause
\ No newline at end of file
+@echo off
+rem every shader variant the application loads - needs a Vulkan SDK recent enough for GL_EXT_nonuniform_qualifier
+rem the build runs this with nopause, a failed compile fails the build
+cd /d "%~dp0"
+set GLSLANG="%VULKAN_SDK%\Bin\glslangValidator.exe"
+if not exist %GLSLANG% (
+	echo glslangValidator not found, install the Vulkan SDK and set VULKAN_SDK
+	exit /b 1
+)
+
+%GLSLANG% -V shader.vert -o vert.spv || exit /b 1
+%GLSLANG% -V -DVERTEX_COLOR shader.vert -o vert_color.spv || exit /b 1
+%GLSLANG% -V shader.frag -o frag.spv || exit /b 1
+%GLSLANG% -V -DNON_UNIFORM_INDEXING shader.frag -o frag_nonuniform.spv || exit /b 1
+%GLSLANG% -V cull.comp -o cull.spv || exit /b 1
+
+if not "%1"=="nopause" pause
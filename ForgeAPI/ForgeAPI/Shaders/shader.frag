@@ -1,14 +1,24 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#ifdef NON_UNIFORM_INDEXING
+#extension GL_EXT_nonuniform_qualifier : require
+#define TEXTURE_INDEX(index) nonuniformEXT(index)
+#else
+// every instance of a draw has to sample the same texture
+#define TEXTURE_INDEX(index) (index)
+#endif
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragTexture;
 
-layout(binding = 1) uniform sampler2D texSampler;
+// the texture table, sized by the application
+layout(constant_id = 0) const uint TEXTURE_TABLE_CAPACITY = 1;
+layout(set = 1, binding = 0) uniform sampler2D textures[TEXTURE_TABLE_CAPACITY];
 
 layout(location = 0) out vec4 outColor;
 
 void main()
 {
-	outColor = texture(texSampler, fragTexCoord);
+	outColor = texture(textures[TEXTURE_INDEX(fragTexture)], fragTexCoord) * vec4(fragColor, 1.0);
 }
\ No newline at end of file
@@ -6,14 +6,52 @@ layout(binding = 0) uniform UniformBufferObject
 	mat4 model;
 	mat4 view;
 	mat4 proj;
+	vec4 frustum_planes[6];		// read by cull.comp, model space
 } ubo;
 
+layout(push_constant) uniform DrawConstants
+{
+	vec4 position_scale;		// undoes the vertex layout's quantization - stored * scale + offset
+	vec4 position_offset;
+	vec4 texcoord_transform;	// xy scale, zw offset
+} draw;
+
+// true when the cpu multiplied every instance's mvp into transforms, false chains the matrices per vertex
+layout(constant_id = 0) const bool CPU_TRANSFORMS = true;
+
+struct InstanceData
+{
+	mat4 model;		// applied before ubo.model
+	vec3 color;		// tint
+	uint texture_slot;	// slot in the texture table
+};
+
+layout(std430, binding = 1) readonly buffer InstanceBuffer
+{
+	InstanceData instances[];
+};
+
+// identity unless the gpu culls - then cull.comp compacts each submesh's visible instances here
+layout(std430, binding = 2) readonly buffer InstanceIndexBuffer
+{
+	uint instance_indices[];
+};
+
+// proj * view * ubo.model * instance model, indexed like instances - only read with CPU_TRANSFORMS
+layout(std430, binding = 3) readonly buffer TransformBuffer
+{
+	mat4 transforms[];
+};
+
 layout(location = 0) in vec3 inPosition;
+#ifdef VERTEX_COLOR
 layout(location = 1) in vec3 inColor;
+#endif
 layout(location = 2) in vec2 inTexCoord;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragTexture;
 
 out gl_PerVertex
 {
@@ -22,7 +60,24 @@ out gl_PerVertex
 
 void main()
 {
-	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-	fragColor = inColor;
-	fragTexCoord = inTexCoord;
+	vec3 position = inPosition * draw.position_scale.xyz + draw.position_offset.xyz;
+
+	uint instance_index = instance_indices[gl_InstanceIndex];
+	InstanceData instance = instances[instance_index];
+
+	if (CPU_TRANSFORMS)
+	{
+		gl_Position = transforms[instance_index] * vec4(position, 1.0);
+	}
+	else
+	{
+		gl_Position = ubo.proj * ubo.view * ubo.model * instance.model * vec4(position, 1.0);
+	}
+#ifdef VERTEX_COLOR
+	fragColor = inColor * instance.color.rgb;
+#else
+	fragColor = instance.color.rgb;
+#endif
+	fragTexCoord = inTexCoord * draw.texcoord_transform.xy + draw.texcoord_transform.zw;
+	fragTexture = instance.texture_slot;
 }
\ No newline at end of file
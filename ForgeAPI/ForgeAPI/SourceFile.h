@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include "Hash.h"
+#include "MappedFile.h"
+
+// the source asset a cache was cooked from - size and last write time are compared first, the contents
+// are only mapped and hashed when those differ, e.g. after a checkout touched the file without changing it
+class SourceFile
+{
+public:
+	// returns false when the file does not exist
+	bool Open(const std::string& path)
+	{
+		_path = path;
+		_hashed = false;
+
+#ifdef _WIN32
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes))
+		{
+			return false;
+		}
+
+		_size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+		_modified_time = (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+#else
+		struct stat file_stat;
+		if (stat(path.c_str(), &file_stat) != 0)
+		{
+			return false;
+		}
+
+		_size = static_cast<uint64_t>(file_stat.st_size);
+#ifdef __APPLE__
+		_modified_time = static_cast<uint64_t>(file_stat.st_mtimespec.tv_sec) * 1000000000 + file_stat.st_mtimespec.tv_nsec;
+#else
+		_modified_time = static_cast<uint64_t>(file_stat.st_mtim.tv_sec) * 1000000000 + file_stat.st_mtim.tv_nsec;
+#endif
+#endif
+
+		return true;
+	}
+
+	uint64_t Size() const
+	{
+		return _size;
+	}
+
+	// platform file time, only ever compared for equality
+	uint64_t ModifiedTime() const
+	{
+		return _modified_time;
+	}
+
+	// hashes the whole file on the first call only
+	uint64_t ContentHash()
+	{
+		if (!_hashed)
+		{
+			MappedFile source(_path);
+			if (!source.IsOpen())
+			{
+				throw std::runtime_error("Failed To Map Source File!");
+			}
+
+			_content_hash = Hash::Bytes(source.Data(), source.Size());
+			_hashed = true;
+		}
+
+		return _content_hash;
+	}
+
+private:
+	// BEGIN PRIVATE MEMBERS
+	std::string _path;
+	uint64_t _size = 0;
+	uint64_t _modified_time = 0;
+	uint64_t _content_hash = 0;
+	bool _hashed = false;
+	// END PRIVATE MEMBERS
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "AtomicFile.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "MipChain.h"
+#include "SourceFile.h"
+
+const uint32_t COOKED_TEXTURE_MAGIC = 0x58455446;	///< "FTEX"
+const uint32_t COOKED_TEXTURE_VERSION = 2;
+
+// fixed size header at the start of a cooked texture, ktx style - a level table follows,
+// then every mip level's blocks back to back at 16 byte aligned offsets
+struct CookedTextureHeader
+{
+	uint32_t _magic;
+	uint32_t _version;
+	uint32_t _format;				///< VkFormat of the level data
+	uint32_t _width;
+	uint32_t _height;
+	uint32_t _level_count;
+	uint64_t _level_offset;			///< where the ImageLevel table starts
+	uint64_t _data_offset;			///< level offsets are relative to this
+	uint64_t _data_size;
+	uint64_t _source_size;
+	uint64_t _source_modified_time;	///< matching size and time skip hashing the source
+	uint64_t _source_hash;			///< hash of the source image the texture was cooked from
+	uint64_t _content_hash;			///< hash of the level table and data, catches truncated or corrupt files
+};
+
+// read side of the cooked texture cache - the file stays mapped so every level can be copied
+// straight into staging memory without decoding or compressing anything at startup
+class CookedTexture
+{
+public:
+	// false when the cache is missing, stale (source changed, other version or format) or damaged
+	bool Open(const std::string& path, SourceFile& source, uint32_t format)
+	{
+		Close();
+
+		if (!_file.Open(path) || _file.Size() < sizeof(CookedTextureHeader))
+		{
+			Close();
+			return false;
+		}
+
+		memcpy(&_header, _file.Data(), sizeof(_header));
+
+		bool valid = _header._magic == COOKED_TEXTURE_MAGIC && _header._version == COOKED_TEXTURE_VERSION &&
+			_header._format == format && _header._source_size == source.Size() &&
+			_header._level_count > 0;
+
+		uint64_t level_bytes = static_cast<uint64_t>(_header._level_count) * sizeof(ImageLevel);
+
+		valid = valid && _header._level_offset + level_bytes <= _file.Size() && _header._data_offset + _header._data_size <= _file.Size();
+
+		if (valid)
+		{
+			uint64_t content_hash = Hash::Bytes(_file.Data() + _header._level_offset, static_cast<size_t>(level_bytes));
+			content_hash = Hash::Bytes(_file.Data() + _header._data_offset, static_cast<size_t>(_header._data_size), content_hash);
+			valid = content_hash == _header._content_hash;
+		}
+
+		// every level must lie inside the data blob before anything is uploaded from it
+		for (uint32_t level = 0; valid && level < _header._level_count; ++level)
+		{
+			valid = Levels()[level]._offset + Levels()[level]._size <= _header._data_size;
+		}
+
+		// the source is only read when its time changed, a matching hash keeps the cache
+		if (valid && _header._source_modified_time != source.ModifiedTime())
+		{
+			valid = _header._source_hash == source.ContentHash();
+		}
+
+		if (!valid)
+		{
+			Close();
+		}
+
+		return valid;
+	}
+
+	void Close()
+	{
+		_file.Close();
+		_header = CookedTextureHeader();
+	}
+
+	bool IsOpen() const
+	{
+		return _file.IsOpen();
+	}
+
+	const CookedTextureHeader& Header() const
+	{
+		return _header;
+	}
+
+	const ImageLevel* Levels() const
+	{
+		return reinterpret_cast<const ImageLevel*>(_file.Data() + _header._level_offset);
+	}
+
+	const void* Data() const
+	{
+		return _file.Data() + _header._data_offset;
+	}
+
+	// false when the cache could not be written, an older one at path is then kept
+	static bool Write(const std::string& path, SourceFile& source, uint32_t format, uint32_t width, uint32_t height,
+		const ImageLevel* p_levels, uint32_t level_count, const void* p_data, uint64_t data_size)
+	{
+		CookedTextureHeader header = {};
+		header._magic = COOKED_TEXTURE_MAGIC;
+		header._version = COOKED_TEXTURE_VERSION;
+		header._format = format;
+		header._width = width;
+		header._height = height;
+		header._level_count = level_count;
+		header._data_size = data_size;
+		header._source_size = source.Size();
+		header._source_modified_time = source.ModifiedTime();
+		header._source_hash = source.ContentHash();
+
+		size_t level_bytes = static_cast<size_t>(level_count) * sizeof(ImageLevel);
+
+		header._level_offset = AlignUp(sizeof(CookedTextureHeader));
+		header._data_offset = AlignUp(header._level_offset + level_bytes);
+		header._content_hash = Hash::Bytes(p_data, static_cast<size_t>(data_size), Hash::Bytes(p_levels, level_bytes));
+
+		AtomicFile file(path);
+		file.Write(&header, sizeof(header));
+		file.PadTo(header._level_offset);
+		file.Write(p_levels, level_bytes);
+		file.PadTo(header._data_offset);
+		file.Write(p_data, static_cast<size_t>(data_size));
+
+		return file.Commit();
+	}
+
+private:
+	static const uint64_t BLOB_ALIGNMENT = 16;
+
+	static uint64_t AlignUp(uint64_t value)
+	{
+		return (value + BLOB_ALIGNMENT - 1) / BLOB_ALIGNMENT * BLOB_ALIGNMENT;
+	}
+
+	// BEGIN PRIVATE MEMBERS
+	MappedFile _file;
+	CookedTextureHeader _header = {};
+	// END PRIVATE MEMBERS
+};
@@ -0,0 +1,469 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "DeviceMemoryAllocator.h"
+#include "MipChain.h"
+#include "ThreadPool.h"
+#include "TlsfRangeAllocator.h"
+#include "UploadManager.h"
+
+typedef uint32_t TextureHandle;
+
+// what a decoder produced - its level data already sits in the staging memory it was handed
+struct DecodedTexture
+{
+	VkFormat _format = VK_FORMAT_UNDEFINED;
+	uint32_t _width = 0;
+	uint32_t _height = 0;
+	uint32_t _mip_levels = 1;
+	bool _generate_mips = false;		///< only level 0 was staged, the gpu blits the rest - the format must support linear blits
+	std::vector<ImageLevel> _levels;	///< staged levels, offsets relative to the returned staging pointer
+};
+
+// reserves size bytes of mapped staging memory, blocks while the staging buffer is full
+typedef std::function<uint8_t*(uint64_t size)> TextureStager;
+
+// runs on a decode worker - describes the texture in decoded and writes its levels through stage, called at most once
+// throwing leaves the placeholder bound for good
+typedef std::function<void(const std::string& path, DecodedTexture& decoded, const TextureStager& stage)> TextureDecoder;
+
+// asynchronous texture loading - files are decoded on dedicated workers straight into a persistently mapped
+// staging buffer, the main thread only creates images and records copies from it, everything decoded since the
+// last Update goes to the gpu in one upload batch. until a texture is resident View returns a placeholder
+class TextureStreamer
+{
+public:
+	void Initialize(VkDevice device, DeviceMemoryAllocator& allocator, UploadManager& upload_manager, TextureDecoder decoder, uint32_t decode_threads, VkDeviceSize staging_size)
+	{
+		_vk_device = device;
+		_p_allocator = &allocator;
+		_p_upload_manager = &upload_manager;
+		_decoder = std::move(decoder);
+		_staging_size = staging_size;
+		_cancelled = false;
+
+		CreateStagingBuffer();
+		_staging_ranges.Reset(staging_size);
+
+		// the pool counts its caller as a thread, Submit only ever reaches the workers
+		_p_decode_pool.reset(new ThreadPool(decode_threads + 1));
+
+		CreatePlaceholder();
+	}
+
+	// abandons decodes that have not started, waits for every upload, then destroys all textures
+	void Release()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_cancelled = true;
+		}
+		_staging_available.notify_all();
+
+		// joins the workers - queued decodes see the cancellation and return straight away
+		_p_decode_pool.reset();
+
+		_p_upload_manager->Wait(_p_upload_manager->Flush());
+
+		for (std::unique_ptr<StreamedTexture>& p_texture : _textures)
+		{
+			DestroyImage(p_texture->_vk_image, p_texture->_allocation, p_texture->_vk_image_view);
+		}
+		_textures.clear();
+		_decoded.clear();
+		_uploading.clear();
+
+		DestroyImage(_vk_placeholder_image, _placeholder_allocation, _vk_placeholder_view);
+
+		vkDestroyBuffer(_vk_device, _vk_staging_buffer, nullptr);
+		_p_allocator->Free(_staging_allocation);
+		_vk_staging_buffer = VK_NULL_HANDLE;
+	}
+
+	// queues path for decoding and returns immediately
+	TextureHandle Request(const std::string& path)
+	{
+		TextureHandle handle = static_cast<TextureHandle>(_textures.size());
+
+		_textures.emplace_back(new StreamedTexture());
+		StreamedTexture* p_texture = _textures.back().get();
+		p_texture->_path = path;
+		p_texture->_request_time = std::chrono::high_resolution_clock::now();
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			++_pending_decodes;
+		}
+
+		_p_decode_pool->Submit([this, p_texture]()
+		{
+			Decode(*p_texture);
+		});
+
+		return handle;
+	}
+
+	// main thread, once per frame - records uploads for everything decoded since the last call, submits them as one
+	// batch and makes textures whose upload landed resident. returns true when any View changed
+	bool Update()
+	{
+		std::vector<StreamedTexture*> decoded;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			decoded.swap(_decoded);
+		}
+
+		for (StreamedTexture* p_texture : decoded)
+		{
+			if (!p_texture->_error.empty())
+			{
+				std::cerr << "Failed to stream texture " << p_texture->_path << ": " << p_texture->_error << std::endl;
+				FreeStaging(*p_texture);
+				p_texture->_state = TextureState::Failed;
+				continue;
+			}
+
+			UploadDecoded(*p_texture);
+			_uploading.push_back(p_texture);
+		}
+
+		if (!decoded.empty())
+		{
+			_p_upload_manager->Flush();
+		}
+
+		bool changed = false;
+
+		for (size_t i = 0; i < _uploading.size();)
+		{
+			StreamedTexture& texture = *_uploading[i];
+
+			if (!_p_upload_manager->IsComplete(texture._token))
+			{
+				++i;
+				continue;
+			}
+
+			FreeStaging(texture);
+			texture._state = TextureState::Resident;
+			texture._latency_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - texture._request_time).count();
+			changed = true;
+
+			_uploading[i] = _uploading.back();
+			_uploading.pop_back();
+		}
+
+		return changed;
+	}
+
+	// blocks until every requested texture is resident or has failed
+	void Finish()
+	{
+		for (;;)
+		{
+			Update();
+
+			if (!_uploading.empty())
+			{
+				_p_upload_manager->Wait(_p_upload_manager->Flush());
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(_mutex);
+			if (_pending_decodes == 0 && _decoded.empty())
+			{
+				return;
+			}
+
+			_decode_finished.wait(lock, [this]() { return _pending_decodes == 0 || !_decoded.empty(); });
+		}
+	}
+
+	// the texture once resident, the placeholder before that or when decoding failed
+	VkImageView View(TextureHandle handle) const
+	{
+		const StreamedTexture& texture = *_textures[handle];
+		return texture._state == TextureState::Resident ? texture._vk_image_view : _vk_placeholder_view;
+	}
+
+	bool IsResident(TextureHandle handle) const
+	{
+		return _textures[handle]->_state == TextureState::Resident;
+	}
+
+	// seconds from Request until the texture became resident
+	double ResidentLatency(TextureHandle handle) const
+	{
+		return _textures[handle]->_latency_seconds;
+	}
+
+	const std::string& Path(TextureHandle handle) const
+	{
+		return _textures[handle]->_path;
+	}
+
+private:
+	static const VkDeviceSize STAGING_ALIGNMENT = 16;	///< covers texel and block size and the 4 byte copy offset rule
+
+	enum class TextureState : uint32_t
+	{
+		Decoding,
+		Uploading,
+		Resident,
+		Failed
+	};
+
+	struct StreamedTexture
+	{
+		std::string _path;
+		std::chrono::high_resolution_clock::time_point _request_time;
+
+		// written by the worker, only read on the main thread after the texture was queued as decoded
+		DecodedTexture _decoded;
+		std::string _error;
+		bool _staged = false;
+		uint64_t _staging_offset = 0;
+		uint32_t _staging_handle = TlsfRangeAllocator::INVALID_HANDLE;
+
+		// main thread only
+		TextureState _state = TextureState::Decoding;
+		UploadToken _token = 0;
+		VkImage _vk_image = VK_NULL_HANDLE;
+		GpuAllocation _allocation;
+		VkImageView _vk_image_view = VK_NULL_HANDLE;
+		double _latency_seconds = 0.0;
+	};
+
+	// decode worker
+	void Decode(StreamedTexture& texture)
+	{
+		bool cancelled;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			cancelled = _cancelled;
+		}
+
+		if (cancelled)
+		{
+			texture._error = "Texture Streaming Cancelled!";
+		}
+		else
+		{
+			try
+			{
+				_decoder(texture._path, texture._decoded, [this, &texture](uint64_t size)
+				{
+					return Stage(texture, size);
+				});
+			}
+			catch (const std::exception& error)
+			{
+				texture._error = error.what();
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_decoded.push_back(&texture);
+			--_pending_decodes;
+		}
+		_decode_finished.notify_all();
+	}
+
+	// decode worker - space is given back on the main thread once the upload reading it has completed
+	uint8_t* Stage(StreamedTexture& texture, uint64_t size)
+	{
+		if (texture._staged)
+		{
+			throw std::runtime_error("Texture Staged Twice!");
+		}
+
+		if (size > _staging_size)
+		{
+			throw std::runtime_error("Texture Exceeds Streaming Staging Buffer!");
+		}
+
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		while (!_staging_ranges.Allocate(size, STAGING_ALIGNMENT, texture._staging_offset, texture._staging_handle))
+		{
+			if (_cancelled)
+			{
+				throw std::runtime_error("Texture Streaming Cancelled!");
+			}
+
+			_staging_available.wait(lock);
+		}
+
+		texture._staged = true;
+		return static_cast<uint8_t*>(_staging_allocation._p_mapped) + texture._staging_offset;
+	}
+
+	void FreeStaging(StreamedTexture& texture)
+	{
+		if (!texture._staged)
+		{
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_staging_ranges.Free(texture._staging_handle);
+		}
+		_staging_available.notify_all();
+
+		texture._staged = false;
+	}
+
+	void UploadDecoded(StreamedTexture& texture)
+	{
+		const DecodedTexture& decoded = texture._decoded;
+
+		// the blit cascade reads the levels it writes
+		VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | (decoded._generate_mips ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
+		CreateImage(decoded._format, decoded._width, decoded._height, decoded._mip_levels, usage, texture._vk_image, texture._allocation, texture._vk_image_view);
+
+		if (decoded._generate_mips)
+		{
+			texture._token = _p_upload_manager->UploadStagedImageGenerateMips(texture._vk_image, decoded._width, decoded._height, decoded._mip_levels,
+				_vk_staging_buffer, texture._staging_offset, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+		}
+		else
+		{
+			texture._token = _p_upload_manager->UploadStagedImage(texture._vk_image, _vk_staging_buffer, texture._staging_offset,
+				decoded._levels.data(), static_cast<uint32_t>(decoded._levels.size()), VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+		}
+
+		texture._state = TextureState::Uploading;
+	}
+
+	// neutral grey, uploaded with the next flush like any other startup upload
+	void CreatePlaceholder()
+	{
+		const uint8_t TEXEL[4] = { 128, 128, 128, 255 };
+
+		CreateImage(VK_FORMAT_R8G8B8A8_UNORM, 1, 1, 1, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, _vk_placeholder_image, _placeholder_allocation, _vk_placeholder_view);
+		_p_upload_manager->UploadImage(_vk_placeholder_image, 1, 1, TEXEL, sizeof(TEXEL), VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	}
+
+	void CreateStagingBuffer()
+	{
+		VkBufferCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		create_info.size = _staging_size;
+		create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateBuffer(_vk_device, &create_info, nullptr, &_vk_staging_buffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Texture Staging Buffer!");
+		}
+
+		VkMemoryRequirements memory_requirements;
+		vkGetBufferMemoryRequirements(_vk_device, _vk_staging_buffer, &memory_requirements);
+
+		_staging_allocation = _p_allocator->Allocate(memory_requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, ResourceKind::Linear, true);
+
+		vkBindBufferMemory(_vk_device, _vk_staging_buffer, _staging_allocation._memory, _staging_allocation._offset);
+	}
+
+	void CreateImage(VkFormat format, uint32_t width, uint32_t height, uint32_t mip_levels, VkImageUsageFlags usage, VkImage& image, GpuAllocation& allocation, VkImageView& image_view)
+	{
+		VkImageCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		create_info.imageType = VK_IMAGE_TYPE_2D;
+		create_info.extent.width = width;
+		create_info.extent.height = height;
+		create_info.extent.depth = 1;
+		create_info.mipLevels = mip_levels;
+		create_info.arrayLayers = 1;
+		create_info.format = format;
+		create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+		create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		create_info.usage = usage;
+		create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+
+		if (vkCreateImage(_vk_device, &create_info, nullptr, &image) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Streamed Texture Image!");
+		}
+
+		VkMemoryRequirements memory_requirements;
+		vkGetImageMemoryRequirements(_vk_device, image, &memory_requirements);
+
+		allocation = _p_allocator->Allocate(memory_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ResourceKind::Optimal);
+		vkBindImageMemory(_vk_device, image, allocation._memory, allocation._offset);
+
+		VkImageViewCreateInfo view_create_info = {};
+		view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		view_create_info.image = image;
+		view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		view_create_info.format = format;
+		view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		view_create_info.subresourceRange.baseMipLevel = 0;
+		view_create_info.subresourceRange.levelCount = mip_levels;
+		view_create_info.subresourceRange.baseArrayLayer = 0;
+		view_create_info.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(_vk_device, &view_create_info, nullptr, &image_view) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Streamed Texture Image View!");
+		}
+	}
+
+	void DestroyImage(VkImage& image, GpuAllocation& allocation, VkImageView& image_view)
+	{
+		if (image == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		vkDestroyImageView(_vk_device, image_view, nullptr);
+		vkDestroyImage(_vk_device, image, nullptr);
+		_p_allocator->Free(allocation);
+
+		image_view = VK_NULL_HANDLE;
+		image = VK_NULL_HANDLE;
+	}
+
+	// BEGIN PRIVATE MEMBERS
+	VkDevice _vk_device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* _p_allocator = nullptr;
+	UploadManager* _p_upload_manager = nullptr;
+	TextureDecoder _decoder;
+	std::unique_ptr<ThreadPool> _p_decode_pool;
+
+	VkBuffer _vk_staging_buffer = VK_NULL_HANDLE;
+	GpuAllocation _staging_allocation;
+	VkDeviceSize _staging_size = 0;
+
+	VkImage _vk_placeholder_image = VK_NULL_HANDLE;
+	GpuAllocation _placeholder_allocation;
+	VkImageView _vk_placeholder_view = VK_NULL_HANDLE;
+
+	std::vector<std::unique_ptr<StreamedTexture>> _textures;	///< main thread, workers keep pointers to the elements
+	std::vector<StreamedTexture*> _uploading;					///< main thread
+
+	// guarded by _mutex, shared with the decode workers
+	std::mutex _mutex;
+	std::condition_variable _staging_available;
+	std::condition_variable _decode_finished;
+	TlsfRangeAllocator _staging_ranges;
+	std::vector<StreamedTexture*> _decoded;
+	uint32_t _pending_decodes = 0;
+	bool _cancelled = false;
+	// END PRIVATE MEMBERS
+};
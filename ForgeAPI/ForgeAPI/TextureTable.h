@@ -0,0 +1,186 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// bindless textures - one large combined image sampler array that shaders index with a per instance slot, so adding
+// a texture writes one descriptor instead of needing another set and another bind per draw
+// there is one set per frame in flight and a slot is only rewritten in the set of a frame whose fence has signaled.
+// with VK_EXT_descriptor_indexing the array is partially bound and updatable after bind, so writes leave the
+// command buffers the set is bound in valid. without it every slot has to be written and a write invalidates them
+class TextureTable
+{
+public:
+	// update_after_bind needs partially bound, update after bind and update unused while pending sampled images
+	void Initialize(VkDevice device, uint32_t capacity, uint32_t set_count, bool update_after_bind)
+	{
+		_vk_device = device;
+		_capacity = capacity;
+		_size = 0;
+		_update_after_bind = update_after_bind;
+
+		VkDescriptorSetLayoutBinding binding = {};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		binding.descriptorCount = capacity;
+		binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		VkDescriptorBindingFlagsEXT binding_flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfoEXT binding_flags_create_info = {};
+		binding_flags_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+		binding_flags_create_info.bindingCount = 1;
+		binding_flags_create_info.pBindingFlags = &binding_flags;
+
+		VkDescriptorSetLayoutCreateInfo layout_create_info = {};
+		layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layout_create_info.bindingCount = 1;
+		layout_create_info.pBindings = &binding;
+
+		if (update_after_bind)
+		{
+			layout_create_info.pNext = &binding_flags_create_info;
+			layout_create_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+		}
+
+		if (vkCreateDescriptorSetLayout(_vk_device, &layout_create_info, nullptr, &_vk_layout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Texture Table Layout!");
+		}
+
+		VkDescriptorPoolSize pool_size = {};
+		pool_size.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		pool_size.descriptorCount = capacity * set_count;
+
+		VkDescriptorPoolCreateInfo pool_create_info = {};
+		pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		pool_create_info.flags = update_after_bind ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT : 0;
+		pool_create_info.poolSizeCount = 1;
+		pool_create_info.pPoolSizes = &pool_size;
+		pool_create_info.maxSets = set_count;
+
+		if (vkCreateDescriptorPool(_vk_device, &pool_create_info, nullptr, &_vk_pool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Texture Table Pool!");
+		}
+
+		std::vector<VkDescriptorSetLayout> layouts(set_count, _vk_layout);
+		_vk_sets.resize(set_count);
+
+		VkDescriptorSetAllocateInfo alloc_info = {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		alloc_info.descriptorPool = _vk_pool;
+		alloc_info.descriptorSetCount = set_count;
+		alloc_info.pSetLayouts = layouts.data();
+
+		if (vkAllocateDescriptorSets(_vk_device, &alloc_info, _vk_sets.data()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Allocate Texture Table!");
+		}
+	}
+
+	void Release()
+	{
+		vkDestroyDescriptorPool(_vk_device, _vk_pool, nullptr);
+		vkDestroyDescriptorSetLayout(_vk_device, _vk_layout, nullptr);
+		_vk_pool = VK_NULL_HANDLE;
+		_vk_layout = VK_NULL_HANDLE;
+		_vk_sets.clear();
+	}
+
+	// a slot in every set, the texture keeps it for its lifetime - Write it before anything samples it
+	uint32_t Add()
+	{
+		if (_size == _capacity)
+		{
+			throw std::runtime_error("Texture Table Full!");
+		}
+
+		return _size++;
+	}
+
+	// only call once the fence of the set's frame has signaled - without UpdateAfterBind, command buffers the set is
+	// bound in have to be recorded again
+	void Write(uint32_t set_index, uint32_t slot, VkSampler sampler, VkImageView view)
+	{
+		WriteRange(set_index, slot, 1, sampler, view);
+	}
+
+	// without partially bound descriptors every slot a shader could index must be valid - fills the ones no texture
+	// was added to yet in every set, nothing to do with UpdateAfterBind
+	void WriteUnused(VkSampler sampler, VkImageView view)
+	{
+		if (_update_after_bind || _size == _capacity)
+		{
+			return;
+		}
+
+		for (uint32_t set_index = 0; set_index < _vk_sets.size(); ++set_index)
+		{
+			WriteRange(set_index, _size, _capacity - _size, sampler, view);
+		}
+	}
+
+	VkDescriptorSetLayout Layout() const
+	{
+		return _vk_layout;
+	}
+
+	VkDescriptorSet Set(uint32_t set_index) const
+	{
+		return _vk_sets[set_index];
+	}
+
+	uint32_t Capacity() const
+	{
+		return _capacity;
+	}
+
+	// slots handed out
+	uint32_t Size() const
+	{
+		return _size;
+	}
+
+	// writes leave the command buffers the set is bound in valid
+	bool UpdateAfterBind() const
+	{
+		return _update_after_bind;
+	}
+
+private:
+	void WriteRange(uint32_t set_index, uint32_t first_slot, uint32_t slot_count, VkSampler sampler, VkImageView view)
+	{
+		VkDescriptorImageInfo image_info = {};
+		image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		image_info.imageView = view;
+		image_info.sampler = sampler;
+
+		std::vector<VkDescriptorImageInfo> image_infos(slot_count, image_info);
+
+		VkWriteDescriptorSet write_descriptor = {};
+		write_descriptor.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write_descriptor.dstSet = _vk_sets[set_index];
+		write_descriptor.dstBinding = 0;
+		write_descriptor.dstArrayElement = first_slot;
+		write_descriptor.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write_descriptor.descriptorCount = slot_count;
+		write_descriptor.pImageInfo = image_infos.data();
+
+		vkUpdateDescriptorSets(_vk_device, 1, &write_descriptor, 0, nullptr);
+	}
+
+	// BEGIN PRIVATE MEMBERS
+	VkDevice _vk_device = VK_NULL_HANDLE;
+	VkDescriptorSetLayout _vk_layout = VK_NULL_HANDLE;
+	VkDescriptorPool _vk_pool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> _vk_sets;	///< one per frame in flight, IMPLICITLY DESTROYED BY POOL
+	uint32_t _capacity = 0;
+	uint32_t _size = 0;
+	bool _update_after_bind = false;
+	// END PRIVATE MEMBERS
+};
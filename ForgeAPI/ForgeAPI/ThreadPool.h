@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads fed from one task queue
+// ParallelFor splits an index range across the workers and the calling thread
+class ThreadPool
+{
+public:
+	// 0 uses one thread per hardware thread, the calling thread of ParallelFor counts as one of them
+	explicit ThreadPool(uint32_t thread_count = 0)
+	{
+		if (thread_count == 0)
+		{
+			thread_count = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		for (uint32_t i = 1; i < thread_count; ++i)
+		{
+			_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+		}
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+		_task_available.notify_all();
+
+		for (std::thread& worker : _workers)
+		{
+			worker.join();
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// worker threads plus the caller
+	uint32_t ThreadCount() const
+	{
+		return static_cast<uint32_t>(_workers.size()) + 1;
+	}
+
+	// fire and forget - tasks still queued when the pool is destroyed are run first
+	void Submit(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_tasks.push_back(std::move(task));
+		}
+		_task_available.notify_one();
+	}
+
+	// calls function(i) for every i in [0, count) and returns once all calls finished
+	// indices are claimed one at a time, so uneven work balances itself - never call from inside a pool task
+	void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& function)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		struct SharedState
+		{
+			std::atomic<uint32_t> _next_index = { 0 };
+			std::atomic<uint32_t> _active_helpers = { 0 };
+			std::mutex _mutex;
+			std::condition_variable _done;
+		};
+
+		std::shared_ptr<SharedState> state = std::make_shared<SharedState>();
+		const std::function<void(uint32_t)>* p_function = &function;
+
+		auto run = [state, p_function, count]()
+		{
+			for (uint32_t i = state->_next_index.fetch_add(1); i < count; i = state->_next_index.fetch_add(1))
+			{
+				(*p_function)(i);
+			}
+		};
+
+		uint32_t helper_count = std::min(static_cast<uint32_t>(_workers.size()), count - 1);
+		state->_active_helpers = helper_count;
+
+		for (uint32_t i = 0; i < helper_count; ++i)
+		{
+			Submit([state, run]()
+			{
+				run();
+
+				std::lock_guard<std::mutex> lock(state->_mutex);
+				if (--state->_active_helpers == 0)
+				{
+					state->_done.notify_one();
+				}
+			});
+		}
+
+		run();
+
+		// helpers that never got scheduled find no indices left and return straight away
+		std::unique_lock<std::mutex> lock(state->_mutex);
+		state->_done.wait(lock, [&state]() { return state->_active_helpers == 0; });
+	}
+
+private:
+	void WorkerLoop()
+	{
+		for (;;)
+		{
+			std::function<void()> task;
+
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_task_available.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+
+				if (_tasks.empty())
+				{
+					return;
+				}
+
+				task = std::move(_tasks.front());
+				_tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+
+	// BEGIN PRIVATE MEMBERS
+	std::vector<std::thread> _workers;
+	std::deque<std::function<void()>> _tasks;
+	std::mutex _mutex;
+	std::condition_variable _task_available;
+	bool _stopping = false;
+	// END PRIVATE MEMBERS
+};
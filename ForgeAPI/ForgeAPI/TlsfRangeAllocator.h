@@ -0,0 +1,388 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// two level segregated fit allocator over an abstract [0, size) range
+// O(1) allocate and free - backs the device memory blocks but never touches memory itself
+class TlsfRangeAllocator
+{
+public:
+	static const uint32_t INVALID_HANDLE = UINT32_MAX;
+
+	explicit TlsfRangeAllocator(uint64_t size = 0)
+	{
+		Reset(size);
+	}
+
+	void Reset(uint64_t size)
+	{
+		_size = size;
+		_used_bytes = 0;
+		_allocation_count = 0;
+		_chunks.clear();
+		_unused_chunks.clear();
+		_fl_bitmap = 0;
+
+		for (uint32_t fl = 0; fl < FL_COUNT; ++fl)
+		{
+			_sl_bitmaps[fl] = 0;
+
+			for (uint32_t sl = 0; sl < SL_COUNT; ++sl)
+			{
+				_free_heads[fl][sl] = INVALID_HANDLE;
+			}
+		}
+
+		if (size > 0)
+		{
+			uint32_t chunk = NewChunk();
+			_chunks[chunk]._offset = 0;
+			_chunks[chunk]._size = size;
+			InsertFree(chunk);
+		}
+	}
+
+	// returns false when no free range fits - offset is aligned, handle is needed to free it again
+	bool Allocate(uint64_t size, uint64_t alignment, uint64_t& offset, uint32_t& handle)
+	{
+		if (size == 0)
+		{
+			size = 1;
+		}
+
+		if (alignment == 0)
+		{
+			alignment = 1;
+		}
+
+		// search for the worst case so any chunk found can take the alignment padding
+		uint64_t search_size = size + (alignment > 1 ? alignment - 1 : 0);
+		uint32_t chunk = FindFree(search_size);
+
+		if (chunk == INVALID_HANDLE)
+		{
+			return false;
+		}
+
+		RemoveFree(chunk);
+
+		// split the alignment padding off the front
+		uint64_t aligned_offset = AlignUp(_chunks[chunk]._offset, alignment);
+		uint64_t padding = aligned_offset - _chunks[chunk]._offset;
+
+		if (padding > 0)
+		{
+			uint32_t front = SplitFront(chunk, padding);
+			InsertFree(front);
+		}
+
+		// return the unused tail
+		if (_chunks[chunk]._size - size >= MIN_SPLIT_SIZE)
+		{
+			uint32_t tail = SplitBack(chunk, size);
+			InsertFree(tail);
+		}
+
+		_chunks[chunk]._free = false;
+		_used_bytes += _chunks[chunk]._size;
+		++_allocation_count;
+
+		offset = _chunks[chunk]._offset;
+		handle = chunk;
+		return true;
+	}
+
+	void Free(uint32_t handle)
+	{
+		uint32_t chunk = handle;
+
+		_used_bytes -= _chunks[chunk]._size;
+		--_allocation_count;
+		_chunks[chunk]._free = true;
+
+		// coalesce with free physical neighbours
+		uint32_t prev = _chunks[chunk]._prev_physical;
+		if (prev != INVALID_HANDLE && _chunks[prev]._free)
+		{
+			RemoveFree(prev);
+			_chunks[prev]._size += _chunks[chunk]._size;
+			Unlink(chunk);
+			chunk = prev;
+		}
+
+		uint32_t next = _chunks[chunk]._next_physical;
+		if (next != INVALID_HANDLE && _chunks[next]._free)
+		{
+			RemoveFree(next);
+			_chunks[chunk]._size += _chunks[next]._size;
+			Unlink(next);
+		}
+
+		InsertFree(chunk);
+	}
+
+	uint64_t Size() const
+	{
+		return _size;
+	}
+
+	uint64_t UsedBytes() const
+	{
+		return _used_bytes;
+	}
+
+	uint32_t AllocationCount() const
+	{
+		return _allocation_count;
+	}
+
+	bool Empty() const
+	{
+		return _allocation_count == 0;
+	}
+
+private:
+	static const uint32_t SL_COUNT_LOG2 = 4;
+	static const uint32_t SL_COUNT = 1 << SL_COUNT_LOG2;
+	static const uint32_t FL_SHIFT = SL_COUNT_LOG2 + 4;
+	static const uint64_t SMALL_SIZE = 1ull << FL_SHIFT;	///< sizes below this share first level 0 in linear steps
+	static const uint32_t FL_COUNT = 64 - FL_SHIFT + 1;
+	static const uint64_t MIN_SPLIT_SIZE = 16;
+
+	struct Chunk
+	{
+		uint64_t _offset = 0;
+		uint64_t _size = 0;
+		uint32_t _prev_physical = INVALID_HANDLE;
+		uint32_t _next_physical = INVALID_HANDLE;
+		uint32_t _prev_free = INVALID_HANDLE;
+		uint32_t _next_free = INVALID_HANDLE;
+		bool _free = true;
+	};
+
+	static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	static uint32_t HighestBit(uint64_t value)
+	{
+		uint32_t bit = 0;
+		while (value >>= 1)
+		{
+			++bit;
+		}
+		return bit;
+	}
+
+	static uint32_t LowestBit(uint64_t value)
+	{
+		uint32_t bit = 0;
+		while ((value & 1) == 0)
+		{
+			value >>= 1;
+			++bit;
+		}
+		return bit;
+	}
+
+	static void Mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+	{
+		if (size < SMALL_SIZE)
+		{
+			fl = 0;
+			sl = static_cast<uint32_t>(size / (SMALL_SIZE / SL_COUNT));
+		}
+		else
+		{
+			uint32_t msb = HighestBit(size);
+			sl = static_cast<uint32_t>(size >> (msb - SL_COUNT_LOG2)) ^ SL_COUNT;
+			fl = msb - FL_SHIFT + 1;
+		}
+	}
+
+	uint32_t FindFree(uint64_t size) const
+	{
+		// round up to the next list so every chunk in it is large enough
+		if (size >= SMALL_SIZE)
+		{
+			size += (1ull << (HighestBit(size) - SL_COUNT_LOG2)) - 1;
+		}
+		else
+		{
+			size = AlignUp(size, SMALL_SIZE / SL_COUNT);
+		}
+
+		uint32_t fl, sl;
+		Mapping(size, fl, sl);
+
+		if (fl >= FL_COUNT)
+		{
+			return INVALID_HANDLE;
+		}
+
+		uint32_t sl_map = sl < SL_COUNT ? _sl_bitmaps[fl] & (~0u << sl) : 0;
+
+		if (sl_map == 0)
+		{
+			uint64_t fl_map = fl + 1 < 64 ? _fl_bitmap & (~0ull << (fl + 1)) : 0;
+
+			if (fl_map == 0)
+			{
+				return INVALID_HANDLE;
+			}
+
+			fl = LowestBit(fl_map);
+			sl_map = _sl_bitmaps[fl];
+		}
+
+		sl = LowestBit(sl_map);
+		return _free_heads[fl][sl];
+	}
+
+	void InsertFree(uint32_t chunk)
+	{
+		uint32_t fl, sl;
+		Mapping(_chunks[chunk]._size, fl, sl);
+
+		uint32_t head = _free_heads[fl][sl];
+		_chunks[chunk]._free = true;
+		_chunks[chunk]._prev_free = INVALID_HANDLE;
+		_chunks[chunk]._next_free = head;
+
+		if (head != INVALID_HANDLE)
+		{
+			_chunks[head]._prev_free = chunk;
+		}
+
+		_free_heads[fl][sl] = chunk;
+		_sl_bitmaps[fl] |= 1u << sl;
+		_fl_bitmap |= 1ull << fl;
+	}
+
+	void RemoveFree(uint32_t chunk)
+	{
+		uint32_t fl, sl;
+		Mapping(_chunks[chunk]._size, fl, sl);
+
+		uint32_t prev = _chunks[chunk]._prev_free;
+		uint32_t next = _chunks[chunk]._next_free;
+
+		if (prev != INVALID_HANDLE)
+		{
+			_chunks[prev]._next_free = next;
+		}
+		else
+		{
+			_free_heads[fl][sl] = next;
+		}
+
+		if (next != INVALID_HANDLE)
+		{
+			_chunks[next]._prev_free = prev;
+		}
+
+		if (_free_heads[fl][sl] == INVALID_HANDLE)
+		{
+			_sl_bitmaps[fl] &= ~(1u << sl);
+
+			if (_sl_bitmaps[fl] == 0)
+			{
+				_fl_bitmap &= ~(1ull << fl);
+			}
+		}
+
+		_chunks[chunk]._prev_free = INVALID_HANDLE;
+		_chunks[chunk]._next_free = INVALID_HANDLE;
+	}
+
+	// carves the first `size` bytes of chunk into a new chunk placed physically before it
+	uint32_t SplitFront(uint32_t chunk, uint64_t size)
+	{
+		uint32_t front = NewChunk();
+
+		_chunks[front]._offset = _chunks[chunk]._offset;
+		_chunks[front]._size = size;
+		_chunks[front]._prev_physical = _chunks[chunk]._prev_physical;
+		_chunks[front]._next_physical = chunk;
+
+		if (_chunks[front]._prev_physical != INVALID_HANDLE)
+		{
+			_chunks[_chunks[front]._prev_physical]._next_physical = front;
+		}
+
+		_chunks[chunk]._prev_physical = front;
+		_chunks[chunk]._offset += size;
+		_chunks[chunk]._size -= size;
+
+		return front;
+	}
+
+	// keeps the first `size` bytes in chunk and returns the remainder as a new chunk
+	uint32_t SplitBack(uint32_t chunk, uint64_t size)
+	{
+		uint32_t back = NewChunk();
+
+		_chunks[back]._offset = _chunks[chunk]._offset + size;
+		_chunks[back]._size = _chunks[chunk]._size - size;
+		_chunks[back]._prev_physical = chunk;
+		_chunks[back]._next_physical = _chunks[chunk]._next_physical;
+
+		if (_chunks[back]._next_physical != INVALID_HANDLE)
+		{
+			_chunks[_chunks[back]._next_physical]._prev_physical = back;
+		}
+
+		_chunks[chunk]._next_physical = back;
+		_chunks[chunk]._size = size;
+
+		return back;
+	}
+
+	// drops a chunk that was merged into its neighbour
+	void Unlink(uint32_t chunk)
+	{
+		uint32_t prev = _chunks[chunk]._prev_physical;
+		uint32_t next = _chunks[chunk]._next_physical;
+
+		if (prev != INVALID_HANDLE)
+		{
+			_chunks[prev]._next_physical = next;
+		}
+
+		if (next != INVALID_HANDLE)
+		{
+			_chunks[next]._prev_physical = prev;
+		}
+
+		_chunks[chunk] = Chunk();
+		_unused_chunks.push_back(chunk);
+	}
+
+	uint32_t NewChunk()
+	{
+		if (!_unused_chunks.empty())
+		{
+			uint32_t chunk = _unused_chunks.back();
+			_unused_chunks.pop_back();
+			return chunk;
+		}
+
+		_chunks.push_back(Chunk());
+		return static_cast<uint32_t>(_chunks.size() - 1);
+	}
+
+	// BEGIN PRIVATE MEMBERS
+	uint64_t _size = 0;
+	uint64_t _used_bytes = 0;
+	uint32_t _allocation_count = 0;
+
+	std::vector<Chunk> _chunks;
+	std::vector<uint32_t> _unused_chunks;
+
+	uint64_t _fl_bitmap = 0;
+	uint32_t _sl_bitmaps[FL_COUNT];
+	uint32_t _free_heads[FL_COUNT][SL_COUNT];
+	// END PRIVATE MEMBERS
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+struct UniformAllocation
+{
+	void* _p_mapped = nullptr;		///< write the data here, memory is coherent so no flush is needed
+	uint32_t _dynamic_offset = 0;	///< pass to vkCmdBindDescriptorSets for a UNIFORM_BUFFER_DYNAMIC binding
+};
+
+// per frame regions of one persistently mapped uniform buffer, every object's data of a frame is sub-allocated
+// from its region with a bump pointer - no map calls, and a region is only rewound in BeginFrame, after the fence
+// of that frame has signaled, so writes never race gpu reads
+class UniformRing
+{
+public:
+	// p_mapped covers frame_count * frame_size bytes - alignment is minUniformBufferOffsetAlignment
+	void Initialize(void* p_mapped, VkDeviceSize frame_size, uint32_t frame_count, VkDeviceSize alignment)
+	{
+		_p_mapped = static_cast<uint8_t*>(p_mapped);
+		_alignment = alignment > 0 ? alignment : 1;
+		_frame_size = frame_size / _alignment * _alignment;
+		_frame_count = frame_count;
+		_frame_base = 0;
+		_head = 0;
+	}
+
+	// only once the fence of frame_index has signaled - rewinds the frame's region
+	void BeginFrame(uint32_t frame_index)
+	{
+		if (frame_index >= _frame_count)
+		{
+			throw std::runtime_error("Uniform Ring Frame Index Out Of Range!");
+		}
+
+		_frame_base = frame_index * _frame_size;
+		_head = 0;
+	}
+
+	// the dynamic offset is aligned to minUniformBufferOffsetAlignment
+	UniformAllocation Allocate(VkDeviceSize size)
+	{
+		VkDeviceSize offset = (_head + _alignment - 1) / _alignment * _alignment;
+
+		if (offset + size > _frame_size)
+		{
+			throw std::runtime_error("Uniform Ring Frame Region Exhausted!");
+		}
+
+		_head = offset + size;
+
+		UniformAllocation allocation;
+		allocation._p_mapped = _p_mapped + _frame_base + offset;
+		allocation._dynamic_offset = static_cast<uint32_t>(_frame_base + offset);
+		return allocation;
+	}
+
+	template<typename T>
+	uint32_t Push(const T& data)
+	{
+		UniformAllocation allocation = Allocate(sizeof(T));
+		memcpy(allocation._p_mapped, &data, sizeof(T));
+		return allocation._dynamic_offset;
+	}
+
+	// offset of the first allocation made in a frame, known before anything was written so command buffers can be
+	// recorded ahead
+	uint32_t FrameOffset(uint32_t frame_index) const
+	{
+		return static_cast<uint32_t>(frame_index * _frame_size);
+	}
+
+	// bytes allocated since the last BeginFrame, including alignment padding
+	VkDeviceSize UsedBytes() const
+	{
+		return _head;
+	}
+
+private:
+	// BEGIN PRIVATE MEMBERS
+	uint8_t* _p_mapped = nullptr;
+	VkDeviceSize _alignment = 1;
+	VkDeviceSize _frame_size = 0;
+	uint32_t _frame_count = 0;
+	VkDeviceSize _frame_base = 0;
+	VkDeviceSize _head = 0;
+	// END PRIVATE MEMBERS
+};
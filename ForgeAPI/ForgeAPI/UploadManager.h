@@ -0,0 +1,672 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "DeviceMemoryAllocator.h"
+#include "MipChain.h"
+
+// identifies the batch an upload was recorded into - complete once that batch's fence has signaled
+typedef uint64_t UploadToken;
+
+// batches buffer and image uploads into one command buffer per submit instead of a queue round trip per copy
+// data is staged in a persistently mapped ring, copies run on a dedicated transfer queue when the device has one
+// and ownership is handed to the graphics queue in the same submit, so no upload ever waits on the cpu
+class UploadManager
+{
+public:
+	void Initialize(VkDevice logical_device, DeviceMemoryAllocator& allocator, uint32_t transfer_family, VkQueue transfer_queue, uint32_t graphics_family, VkQueue graphics_queue, VkDeviceSize staging_size)
+	{
+		_vk_logical_device = logical_device;
+		_p_allocator = &allocator;
+		_transfer_family = transfer_family;
+		_vk_transfer_queue = transfer_queue;
+		_graphics_family = graphics_family;
+		_vk_graphics_queue = graphics_queue;
+
+		_vk_transfer_command_pool = CreateCommandPool(_transfer_family);
+
+		if (DedicatedTransferQueue())
+		{
+			_vk_graphics_command_pool = CreateCommandPool(_graphics_family);
+		}
+
+		_ring_size = staging_size;
+		_ring_head = 0;
+		_ring_used = 0;
+		CreateStagingBuffer(_ring_size, _vk_staging_buffer, _staging_allocation);
+	}
+
+	// waits for every submitted upload, then destroys all upload resources
+	void Release()
+	{
+		Wait(Flush());
+
+		for (UploadBatch& batch : _free_batches)
+		{
+			DestroyBatch(batch);
+		}
+		_free_batches.clear();
+
+		vkDestroyBuffer(_vk_logical_device, _vk_staging_buffer, nullptr);
+		_p_allocator->Free(_staging_allocation);
+
+		vkDestroyCommandPool(_vk_logical_device, _vk_transfer_command_pool, nullptr);
+		if (_vk_graphics_command_pool != VK_NULL_HANDLE)
+		{
+			vkDestroyCommandPool(_vk_logical_device, _vk_graphics_command_pool, nullptr);
+			_vk_graphics_command_pool = VK_NULL_HANDLE;
+		}
+	}
+
+	bool DedicatedTransferQueue() const
+	{
+		return _transfer_family != _graphics_family;
+	}
+
+	// copies size bytes of data into dst - dst_stage/dst_access describe the first use on the graphics queue
+	UploadToken UploadBuffer(VkBuffer dst, const void* data, VkDeviceSize size, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access)
+	{
+		VkBuffer staging_buffer;
+		VkDeviceSize staging_offset;
+		memcpy(Stage(size, staging_buffer, staging_offset), data, static_cast<size_t>(size));
+
+		UploadBatch& batch = CurrentBatch();
+
+		VkBufferCopy copy = {};
+		copy.srcOffset = staging_offset;
+		copy.dstOffset = 0;
+		copy.size = size;
+		vkCmdCopyBuffer(batch._transfer_commands, staging_buffer, dst, 1, &copy);
+
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.buffer = dst;
+		barrier.offset = 0;
+		barrier.size = size;
+		AddBarrier(batch, barrier, dst_stage, dst_access);
+
+		return batch._token;
+	}
+
+	// uploads tightly packed texels into mip 0 of image and leaves it in SHADER_READ_ONLY_OPTIMAL
+	UploadToken UploadImage(VkImage image, uint32_t width, uint32_t height, const void* data, VkDeviceSize size, VkPipelineStageFlags dst_stage)
+	{
+		ImageLevel level = { width, height, 0, size };
+		return UploadImage(image, data, size, &level, 1, dst_stage);
+	}
+
+	// uploads level_count mip levels found at p_levels' offsets in data and leaves them in SHADER_READ_ONLY_OPTIMAL
+	// level offsets must be multiples of the texel (or block) size and of 4
+	UploadToken UploadImage(VkImage image, const void* data, VkDeviceSize size, const ImageLevel* p_levels, uint32_t level_count, VkPipelineStageFlags dst_stage)
+	{
+		VkBuffer staging_buffer;
+		VkDeviceSize staging_offset;
+		memcpy(Stage(size, staging_buffer, staging_offset), data, static_cast<size_t>(size));
+
+		return UploadStagedImage(image, staging_buffer, staging_offset, p_levels, level_count, dst_stage);
+	}
+
+	// same as UploadImage for levels the caller already wrote into its own staging buffer
+	// the caller keeps that memory untouched until the returned token completes
+	UploadToken UploadStagedImage(VkImage image, VkBuffer staging_buffer, VkDeviceSize staging_offset, const ImageLevel* p_levels, uint32_t level_count, VkPipelineStageFlags dst_stage)
+	{
+		UploadBatch& batch = CurrentBatch();
+
+		VkImageMemoryBarrier barrier = ImageBarrier(image, 0, level_count, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(batch._transfer_commands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		std::vector<VkBufferImageCopy> image_copies(level_count);
+		for (uint32_t level = 0; level < level_count; ++level)
+		{
+			VkBufferImageCopy& image_copy = image_copies[level];
+			image_copy.bufferOffset = staging_offset + p_levels[level]._offset;
+			image_copy.bufferRowLength = 0;
+			image_copy.bufferImageHeight = 0;
+			image_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			image_copy.imageSubresource.mipLevel = level;
+			image_copy.imageSubresource.baseArrayLayer = 0;
+			image_copy.imageSubresource.layerCount = 1;
+			image_copy.imageOffset = { 0, 0, 0 };
+			image_copy.imageExtent = { p_levels[level]._width, p_levels[level]._height, 1 };
+		}
+		vkCmdCopyBufferToImage(batch._transfer_commands, staging_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, level_count, image_copies.data());
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		AddBarrier(batch, barrier, dst_stage, VK_ACCESS_SHADER_READ_BIT);
+
+		return batch._token;
+	}
+
+	// uploads mip 0 and fills the other mip_levels with a linear blit cascade on the graphics queue, blits need a
+	// graphics capable queue so the cascade runs after the ownership acquire. the format must support
+	// BLIT_SRC, BLIT_DST and SAMPLED_IMAGE_FILTER_LINEAR, the image TRANSFER_SRC and TRANSFER_DST usage
+	UploadToken UploadImageGenerateMips(VkImage image, uint32_t width, uint32_t height, uint32_t mip_levels, const void* data, VkDeviceSize size, VkPipelineStageFlags dst_stage)
+	{
+		VkBuffer staging_buffer;
+		VkDeviceSize staging_offset;
+		memcpy(Stage(size, staging_buffer, staging_offset), data, static_cast<size_t>(size));
+
+		return UploadStagedImageGenerateMips(image, width, height, mip_levels, staging_buffer, staging_offset, dst_stage);
+	}
+
+	// same as UploadImageGenerateMips for a level 0 the caller already wrote into its own staging buffer
+	UploadToken UploadStagedImageGenerateMips(VkImage image, uint32_t width, uint32_t height, uint32_t mip_levels, VkBuffer staging_buffer, VkDeviceSize staging_offset, VkPipelineStageFlags dst_stage)
+	{
+		UploadBatch& batch = CurrentBatch();
+
+		VkImageMemoryBarrier barrier = ImageBarrier(image, 0, mip_levels, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(batch._transfer_commands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkBufferImageCopy image_copy = {};
+		image_copy.bufferOffset = staging_offset;
+		image_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		image_copy.imageSubresource.mipLevel = 0;
+		image_copy.imageSubresource.baseArrayLayer = 0;
+		image_copy.imageSubresource.layerCount = 1;
+		image_copy.imageOffset = { 0, 0, 0 };
+		image_copy.imageExtent = { width, height, 1 };
+		vkCmdCopyBufferToImage(batch._transfer_commands, staging_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &image_copy);
+
+		// the whole chain stays in TRANSFER_DST until the cascade walks it
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		AddBarrier(batch, barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+
+		batch._mip_generations.push_back({ image, width, height, mip_levels, dst_stage });
+
+		return batch._token;
+	}
+
+	// submits everything recorded since the last flush - returns the token of the submitted batch
+	UploadToken Flush()
+	{
+		if (!_recording)
+		{
+			return _last_submitted_token;
+		}
+
+		UploadBatch& batch = _current;
+
+		VkSubmitInfo submit_info = {};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+		if (DedicatedTransferQueue())
+		{
+			// release on the transfer queue, acquire on the graphics queue once the copies are done
+			vkCmdPipelineBarrier(batch._transfer_commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+				static_cast<uint32_t>(batch._buffer_releases.size()), batch._buffer_releases.data(),
+				static_cast<uint32_t>(batch._image_releases.size()), batch._image_releases.data());
+			vkEndCommandBuffer(batch._transfer_commands);
+
+			vkCmdPipelineBarrier(batch._graphics_commands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, batch._dst_stages, 0, 0, nullptr,
+				static_cast<uint32_t>(batch._buffer_acquires.size()), batch._buffer_acquires.data(),
+				static_cast<uint32_t>(batch._image_acquires.size()), batch._image_acquires.data());
+			RecordMipGenerations(batch._graphics_commands, batch);
+			vkEndCommandBuffer(batch._graphics_commands);
+
+			submit_info.commandBufferCount = 1;
+			submit_info.pCommandBuffers = &batch._transfer_commands;
+			submit_info.signalSemaphoreCount = 1;
+			submit_info.pSignalSemaphores = &batch._vk_transfer_done;
+
+			if (vkQueueSubmit(_vk_transfer_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed To Submit Upload Batch!");
+			}
+
+			VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+			submit_info = {};
+			submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submit_info.waitSemaphoreCount = 1;
+			submit_info.pWaitSemaphores = &batch._vk_transfer_done;
+			submit_info.pWaitDstStageMask = &wait_stage;
+			submit_info.commandBufferCount = 1;
+			submit_info.pCommandBuffers = &batch._graphics_commands;
+
+			if (vkQueueSubmit(_vk_graphics_queue, 1, &submit_info, batch._vk_fence) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed To Submit Upload Batch!");
+			}
+		}
+		else
+		{
+			vkCmdPipelineBarrier(batch._transfer_commands, VK_PIPELINE_STAGE_TRANSFER_BIT, batch._dst_stages, 0, 0, nullptr,
+				static_cast<uint32_t>(batch._buffer_acquires.size()), batch._buffer_acquires.data(),
+				static_cast<uint32_t>(batch._image_acquires.size()), batch._image_acquires.data());
+			RecordMipGenerations(batch._transfer_commands, batch);
+			vkEndCommandBuffer(batch._transfer_commands);
+
+			submit_info.commandBufferCount = 1;
+			submit_info.pCommandBuffers = &batch._transfer_commands;
+
+			if (vkQueueSubmit(_vk_graphics_queue, 1, &submit_info, batch._vk_fence) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed To Submit Upload Batch!");
+			}
+		}
+
+		_last_submitted_token = batch._token;
+		_in_flight.push_back(std::move(batch));
+		_current = UploadBatch();
+		_recording = false;
+
+		return _last_submitted_token;
+	}
+
+	// non blocking - true once every upload recorded under token has landed on the gpu
+	bool IsComplete(UploadToken token)
+	{
+		Collect();
+		return token <= _completed_token;
+	}
+
+	void Wait(UploadToken token)
+	{
+		if (_recording && token >= _current._token)
+		{
+			Flush();
+		}
+
+		while (_completed_token < token && !_in_flight.empty())
+		{
+			vkWaitForFences(_vk_logical_device, 1, &_in_flight.front()._vk_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+			Retire();
+		}
+	}
+
+	// retires finished batches and recycles their staging space - cheap enough to call every frame
+	void Collect()
+	{
+		while (!_in_flight.empty() && vkGetFenceStatus(_vk_logical_device, _in_flight.front()._vk_fence) == VK_SUCCESS)
+		{
+			Retire();
+		}
+	}
+
+private:
+	static const VkDeviceSize STAGING_ALIGNMENT = 16;	///< covers texel size and the 4 byte copy offset rule of every format we upload
+
+	// blit cascade recorded after the ownership acquire, see UploadImageGenerateMips
+	struct MipGeneration
+	{
+		VkImage _image;
+		uint32_t _width;
+		uint32_t _height;
+		uint32_t _mip_levels;
+		VkPipelineStageFlags _dst_stage;
+	};
+
+	struct UploadBatch
+	{
+		UploadToken _token = 0;
+		VkCommandBuffer _transfer_commands = VK_NULL_HANDLE;
+		VkCommandBuffer _graphics_commands = VK_NULL_HANDLE;	///< ownership acquire, dedicated transfer queue only
+		VkSemaphore _vk_transfer_done = VK_NULL_HANDLE;			///< dedicated transfer queue only
+		VkFence _vk_fence = VK_NULL_HANDLE;
+		VkDeviceSize _ring_bytes = 0;							///< staging ring space to give back on retire, padding included
+
+		VkPipelineStageFlags _dst_stages = 0;
+		std::vector<VkBufferMemoryBarrier> _buffer_releases;
+		std::vector<VkImageMemoryBarrier> _image_releases;
+		std::vector<VkBufferMemoryBarrier> _buffer_acquires;
+		std::vector<VkImageMemoryBarrier> _image_acquires;
+
+		std::vector<MipGeneration> _mip_generations;
+
+		std::vector<VkBuffer> _oversized_buffers;				///< staging for uploads larger than the ring, freed on retire
+		std::vector<GpuAllocation> _oversized_allocations;
+	};
+
+	VkCommandPool CreateCommandPool(uint32_t queue_family)
+	{
+		VkCommandPoolCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		create_info.queueFamilyIndex = queue_family;
+
+		VkCommandPool command_pool;
+		if (vkCreateCommandPool(_vk_logical_device, &create_info, nullptr, &command_pool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Upload Command Pool!");
+		}
+
+		return command_pool;
+	}
+
+	void CreateStagingBuffer(VkDeviceSize size, VkBuffer& buffer, GpuAllocation& allocation)
+	{
+		VkBufferCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		create_info.size = size;
+		create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateBuffer(_vk_logical_device, &create_info, nullptr, &buffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Staging Buffer!");
+		}
+
+		VkMemoryRequirements memory_requirements;
+		vkGetBufferMemoryRequirements(_vk_logical_device, buffer, &memory_requirements);
+
+		allocation = _p_allocator->Allocate(memory_requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, ResourceKind::Linear, true);
+
+		vkBindBufferMemory(_vk_logical_device, buffer, allocation._memory, allocation._offset);
+	}
+
+	// reserves size bytes of staging memory in the current batch, flushing and waiting only when the ring is full
+	uint8_t* Stage(VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset)
+	{
+		if (size > _ring_size)
+		{
+			UploadBatch& batch = CurrentBatch();
+
+			GpuAllocation allocation;
+			CreateStagingBuffer(size, buffer, allocation);
+			batch._oversized_buffers.push_back(buffer);
+			batch._oversized_allocations.push_back(allocation);
+
+			offset = 0;
+			return static_cast<uint8_t*>(allocation._p_mapped);
+		}
+
+		for (;;)
+		{
+			VkDeviceSize aligned_head = (_ring_head + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+			bool wrap = aligned_head + size > _ring_size;
+
+			// wrapping consumes the unused tail of the ring as well
+			offset = wrap ? 0 : aligned_head;
+			VkDeviceSize consumed = (wrap ? _ring_size - _ring_head : aligned_head - _ring_head) + size;
+
+			if (_ring_used + consumed <= _ring_size)
+			{
+				UploadBatch& batch = CurrentBatch();
+				batch._ring_bytes += consumed;
+				_ring_used += consumed;
+				_ring_head = offset + size;
+
+				buffer = _vk_staging_buffer;
+				return static_cast<uint8_t*>(_staging_allocation._p_mapped) + offset;
+			}
+
+			if (_recording)
+			{
+				Flush();
+			}
+			else
+			{
+				vkWaitForFences(_vk_logical_device, 1, &_in_flight.front()._vk_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+				Retire();
+			}
+		}
+	}
+
+	UploadBatch& CurrentBatch()
+	{
+		if (_recording)
+		{
+			return _current;
+		}
+
+		if (!_free_batches.empty())
+		{
+			_current = std::move(_free_batches.back());
+			_free_batches.pop_back();
+		}
+		else
+		{
+			_current = CreateBatch();
+		}
+
+		_current._token = _next_token++;
+		_recording = true;
+
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(_current._transfer_commands, &begin_info);
+		if (_current._graphics_commands != VK_NULL_HANDLE)
+		{
+			vkBeginCommandBuffer(_current._graphics_commands, &begin_info);
+		}
+
+		return _current;
+	}
+
+	UploadBatch CreateBatch()
+	{
+		UploadBatch batch;
+
+		VkCommandBufferAllocateInfo alloc_info = {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		alloc_info.commandBufferCount = 1;
+		alloc_info.commandPool = _vk_transfer_command_pool;
+
+		if (vkAllocateCommandBuffers(_vk_logical_device, &alloc_info, &batch._transfer_commands) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Allocate Upload Command Buffer!");
+		}
+
+		if (DedicatedTransferQueue())
+		{
+			alloc_info.commandPool = _vk_graphics_command_pool;
+
+			if (vkAllocateCommandBuffers(_vk_logical_device, &alloc_info, &batch._graphics_commands) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed To Allocate Upload Command Buffer!");
+			}
+
+			VkSemaphoreCreateInfo semaphore_create_info = {};
+			semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+			if (vkCreateSemaphore(_vk_logical_device, &semaphore_create_info, nullptr, &batch._vk_transfer_done) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed To Create Upload Semaphore!");
+			}
+		}
+
+		VkFenceCreateInfo fence_create_info = {};
+		fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		if (vkCreateFence(_vk_logical_device, &fence_create_info, nullptr, &batch._vk_fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Upload Fence!");
+		}
+
+		return batch;
+	}
+
+	void DestroyBatch(UploadBatch& batch)
+	{
+		vkFreeCommandBuffers(_vk_logical_device, _vk_transfer_command_pool, 1, &batch._transfer_commands);
+		if (batch._graphics_commands != VK_NULL_HANDLE)
+		{
+			vkFreeCommandBuffers(_vk_logical_device, _vk_graphics_command_pool, 1, &batch._graphics_commands);
+			vkDestroySemaphore(_vk_logical_device, batch._vk_transfer_done, nullptr);
+		}
+		vkDestroyFence(_vk_logical_device, batch._vk_fence, nullptr);
+	}
+
+	// first barrier per upload - a release/acquire pair across queue families, a plain barrier on a shared queue
+	template<typename Barrier>
+	void AddBarrier(UploadBatch& batch, Barrier barrier, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access)
+	{
+		batch._dst_stages |= dst_stage;
+
+		if (DedicatedTransferQueue())
+		{
+			barrier.srcQueueFamilyIndex = _transfer_family;
+			barrier.dstQueueFamilyIndex = _graphics_family;
+
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+			Releases(batch, barrier).push_back(barrier);
+
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = dst_access;
+			Acquires(batch, barrier).push_back(barrier);
+		}
+		else
+		{
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = dst_access;
+			Acquires(batch, barrier).push_back(barrier);
+		}
+	}
+
+	static VkImageMemoryBarrier ImageBarrier(VkImage image, uint32_t base_level, uint32_t level_count, VkImageLayout old_layout, VkImageLayout new_layout)
+	{
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = old_layout;
+		barrier.newLayout = new_layout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = base_level;
+		barrier.subresourceRange.levelCount = level_count;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		return barrier;
+	}
+
+	// each level is blitted from the one above once that one is complete - the source level then moves to
+	// TRANSFER_SRC for the blit and on to SHADER_READ_ONLY, the last level goes there straight from TRANSFER_DST
+	static void RecordMipGenerations(VkCommandBuffer commands, const UploadBatch& batch)
+	{
+		for (const MipGeneration& generation : batch._mip_generations)
+		{
+			int32_t width = static_cast<int32_t>(generation._width);
+			int32_t height = static_cast<int32_t>(generation._height);
+
+			for (uint32_t level = 1; level < generation._mip_levels; ++level)
+			{
+				VkImageMemoryBarrier barrier = ImageBarrier(generation._image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+				vkCmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+				int32_t next_width = std::max(1, width / 2);
+				int32_t next_height = std::max(1, height / 2);
+
+				VkImageBlit blit = {};
+				blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				blit.srcSubresource.mipLevel = level - 1;
+				blit.srcSubresource.baseArrayLayer = 0;
+				blit.srcSubresource.layerCount = 1;
+				blit.srcOffsets[1] = { width, height, 1 };
+				blit.dstSubresource = blit.srcSubresource;
+				blit.dstSubresource.mipLevel = level;
+				blit.dstOffsets[1] = { next_width, next_height, 1 };
+				vkCmdBlitImage(commands, generation._image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, generation._image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+				barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+				barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+				barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+				vkCmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, generation._dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+				width = next_width;
+				height = next_height;
+			}
+
+			VkImageMemoryBarrier barrier = ImageBarrier(generation._image, generation._mip_levels - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, generation._dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		}
+	}
+
+	static std::vector<VkBufferMemoryBarrier>& Releases(UploadBatch& batch, const VkBufferMemoryBarrier&) { return batch._buffer_releases; }
+	static std::vector<VkImageMemoryBarrier>& Releases(UploadBatch& batch, const VkImageMemoryBarrier&) { return batch._image_releases; }
+	static std::vector<VkBufferMemoryBarrier>& Acquires(UploadBatch& batch, const VkBufferMemoryBarrier&) { return batch._buffer_acquires; }
+	static std::vector<VkImageMemoryBarrier>& Acquires(UploadBatch& batch, const VkImageMemoryBarrier&) { return batch._image_acquires; }
+
+	// oldest in flight batch has signaled - batches retire in submission order, so the ring frees front to back
+	void Retire()
+	{
+		UploadBatch batch = std::move(_in_flight.front());
+		_in_flight.pop_front();
+
+		_completed_token = batch._token;
+		_ring_used -= batch._ring_bytes;
+
+		// nothing staged anywhere, restart at the front to avoid needless wrapping
+		if (_ring_used == 0)
+		{
+			_ring_head = 0;
+		}
+
+		for (size_t i = 0; i < batch._oversized_buffers.size(); ++i)
+		{
+			vkDestroyBuffer(_vk_logical_device, batch._oversized_buffers[i], nullptr);
+			_p_allocator->Free(batch._oversized_allocations[i]);
+		}
+
+		vkResetFences(_vk_logical_device, 1, &batch._vk_fence);
+		vkResetCommandBuffer(batch._transfer_commands, 0);
+		if (batch._graphics_commands != VK_NULL_HANDLE)
+		{
+			vkResetCommandBuffer(batch._graphics_commands, 0);
+		}
+
+		batch._ring_bytes = 0;
+		batch._dst_stages = 0;
+		batch._buffer_releases.clear();
+		batch._image_releases.clear();
+		batch._buffer_acquires.clear();
+		batch._image_acquires.clear();
+		batch._mip_generations.clear();
+		batch._oversized_buffers.clear();
+		batch._oversized_allocations.clear();
+
+		_free_batches.push_back(std::move(batch));
+	}
+
+	// BEGIN PRIVATE MEMBERS
+	VkDevice _vk_logical_device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* _p_allocator = nullptr;
+
+	uint32_t _transfer_family = 0;
+	uint32_t _graphics_family = 0;
+	VkQueue _vk_transfer_queue = VK_NULL_HANDLE;	///< the graphics queue when there is no dedicated transfer family
+	VkQueue _vk_graphics_queue = VK_NULL_HANDLE;
+	VkCommandPool _vk_transfer_command_pool = VK_NULL_HANDLE;
+	VkCommandPool _vk_graphics_command_pool = VK_NULL_HANDLE;	///< ownership acquires, dedicated transfer queue only
+
+	VkBuffer _vk_staging_buffer = VK_NULL_HANDLE;
+	GpuAllocation _staging_allocation;
+	VkDeviceSize _ring_size = 0;
+	VkDeviceSize _ring_head = 0;	///< next free byte
+	VkDeviceSize _ring_used = 0;	///< bytes owned by the recording and in flight batches
+
+	UploadBatch _current;
+	bool _recording = false;
+	std::deque<UploadBatch> _in_flight;
+	std::vector<UploadBatch> _free_batches;
+
+	UploadToken _next_token = 1;
+	UploadToken _last_submitted_token = 0;
+	UploadToken _completed_token = 0;
+	// END PRIVATE MEMBERS
+};
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Hash.h"
+#include "ThreadPool.h"
+
+// flat open addressing table from vertex bytes to a dense vertex id, linear probing, never rehashes
+// vertices compare bytewise, so VertexType must not contain padding (0.0 and -0.0 stay distinct)
+template<typename VertexType>
+class VertexHashTable
+{
+public:
+	// max_vertices bounds the ids ever handed out, the table keeps the load factor at or below one half
+	void Reserve(size_t max_vertices)
+	{
+		size_t capacity = 16;
+		while (capacity < max_vertices * 2)
+		{
+			capacity <<= 1;
+		}
+
+		_slots.assign(capacity, Slot());
+		_mask = capacity - 1;
+		_vertices.clear();
+	}
+
+	// returns the id of an equal vertex already in the table, or adds vertex under the next id
+	uint32_t Insert(const VertexType& vertex, uint64_t hash)
+	{
+		uint32_t tag = static_cast<uint32_t>(hash >> 32);
+
+		for (size_t slot = static_cast<size_t>(hash) & _mask;; slot = (slot + 1) & _mask)
+		{
+			Slot& entry = _slots[slot];
+
+			if (entry._id_plus_one == 0)
+			{
+				entry._tag = tag;
+				entry._id_plus_one = static_cast<uint32_t>(_vertices.size()) + 1;
+				_vertices.push_back(vertex);
+				return entry._id_plus_one - 1;
+			}
+
+			// the tag rejects almost every mismatch without touching the vertex array
+			if (entry._tag == tag && memcmp(&_vertices[entry._id_plus_one - 1], &vertex, sizeof(VertexType)) == 0)
+			{
+				return entry._id_plus_one - 1;
+			}
+		}
+	}
+
+	std::vector<VertexType>& Vertices()
+	{
+		return _vertices;
+	}
+
+	size_t MemoryBytes() const
+	{
+		return _slots.capacity() * sizeof(Slot) + _vertices.capacity() * sizeof(VertexType);
+	}
+
+private:
+	struct Slot
+	{
+		uint32_t _tag = 0;
+		uint32_t _id_plus_one = 0;	///< 0 marks an empty slot
+	};
+
+	// BEGIN PRIVATE MEMBERS
+	std::vector<Slot> _slots;
+	size_t _mask = 0;
+	std::vector<VertexType> _vertices;
+	// END PRIVATE MEMBERS
+};
+
+// builds an indexed mesh from one vertex per triangle corner - make_vertex(i) returns the vertex of corner i
+// unique vertices are numbered in order of first use, the parallel mode produces exactly the same output
+class VertexDeduplicator
+{
+public:
+	// peak_bytes reports the scratch memory high water mark (table plus unique vertices), excluding the index output
+	template<typename VertexType, typename MakeVertex>
+	static void Deduplicate(size_t corner_count, MakeVertex make_vertex, std::vector<VertexType>& unique_vertices, std::vector<uint32_t>& indices, size_t* p_peak_bytes = nullptr)
+	{
+		VertexHashTable<VertexType> table;
+		table.Reserve(corner_count);
+
+		indices.resize(corner_count);
+
+		// hashing a block ahead of the inserts lets the table's cache misses overlap, about 3x over a fused loop
+		uint64_t hashes[HASH_BLOCK_SIZE];
+
+		for (size_t block = 0; block < corner_count; block += HASH_BLOCK_SIZE)
+		{
+			size_t block_end = std::min(corner_count, block + HASH_BLOCK_SIZE);
+
+			for (size_t i = block; i < block_end; ++i)
+			{
+				hashes[i - block] = Hash::Value(make_vertex(i));
+			}
+
+			for (size_t i = block; i < block_end; ++i)
+			{
+				indices[i] = table.Insert(make_vertex(i), hashes[i - block]);
+			}
+		}
+
+		if (p_peak_bytes != nullptr)
+		{
+			*p_peak_bytes = table.MemoryBytes();
+		}
+
+		unique_vertices = std::move(table.Vertices());
+	}
+
+	// splits the work by hash into shards with their own tables so no two threads ever touch the same table
+	// worth it from roughly a million corners, below that the serial version wins
+	template<typename VertexType, typename MakeVertex>
+	static void DeduplicateParallel(size_t corner_count, MakeVertex make_vertex, ThreadPool& thread_pool, std::vector<VertexType>& unique_vertices, std::vector<uint32_t>& indices, size_t* p_peak_bytes = nullptr)
+	{
+		uint32_t shard_bits = 0;
+		while ((1u << shard_bits) < thread_pool.ThreadCount() * 2 && shard_bits < MAX_SHARD_BITS)
+		{
+			++shard_bits;
+		}
+
+		const uint32_t shard_count = 1u << shard_bits;
+		const uint32_t range_count = thread_pool.ThreadCount() * 4;
+		const size_t range_size = (corner_count + range_count - 1) / range_count;
+
+		auto ShardOf = [shard_bits](uint64_t hash)
+		{
+			return shard_bits == 0 ? 0u : static_cast<uint32_t>(hash >> (64 - shard_bits));
+		};
+
+		// 1. hash every corner and bucket corner ids by shard, per range so the buckets stay in corner order
+		std::vector<uint64_t> hashes(corner_count);
+		std::vector<std::vector<std::vector<uint32_t>>> buckets(range_count, std::vector<std::vector<uint32_t>>(shard_count));
+
+		thread_pool.ParallelFor(range_count, [&](uint32_t range)
+		{
+			size_t begin = std::min(corner_count, range * range_size);
+			size_t end = std::min(corner_count, begin + range_size);
+
+			for (size_t i = begin; i < end; ++i)
+			{
+				hashes[i] = Hash::Value(make_vertex(i));
+				buckets[range][ShardOf(hashes[i])].push_back(static_cast<uint32_t>(i));
+			}
+		});
+
+		// 2. every shard dedups its corners in corner order, the first corner of each vertex is remembered
+		std::vector<uint32_t> local_ids(corner_count);
+		std::vector<uint8_t> first_use(corner_count, 0);
+		std::vector<VertexHashTable<VertexType>> tables(shard_count);
+
+		thread_pool.ParallelFor(shard_count, [&](uint32_t shard)
+		{
+			size_t shard_corners = 0;
+			for (uint32_t range = 0; range < range_count; ++range)
+			{
+				shard_corners += buckets[range][shard].size();
+			}
+
+			VertexHashTable<VertexType>& table = tables[shard];
+			table.Reserve(shard_corners);
+
+			for (uint32_t range = 0; range < range_count; ++range)
+			{
+				for (uint32_t corner : buckets[range][shard])
+				{
+					size_t vertex_count = table.Vertices().size();
+					local_ids[corner] = table.Insert(make_vertex(corner), hashes[corner]);
+					first_use[corner] = table.Vertices().size() != vertex_count ? 1 : 0;
+				}
+
+				buckets[range][shard] = std::vector<uint32_t>();
+			}
+		});
+
+		size_t peak_bytes = hashes.capacity() * sizeof(uint64_t) + local_ids.capacity() * sizeof(uint32_t) + first_use.capacity() + corner_count * sizeof(uint32_t);
+		for (const VertexHashTable<VertexType>& table : tables)
+		{
+			peak_bytes += table.MemoryBytes();
+		}
+
+		// 3. global ids follow first use order - a prefix sum of first uses over the corner ranges
+		std::vector<uint32_t> range_bases(range_count + 1, 0);
+
+		thread_pool.ParallelFor(range_count, [&](uint32_t range)
+		{
+			size_t begin = std::min(corner_count, range * range_size);
+			size_t end = std::min(corner_count, begin + range_size);
+
+			uint32_t count = 0;
+			for (size_t i = begin; i < end; ++i)
+			{
+				count += first_use[i];
+			}
+			range_bases[range + 1] = count;
+		});
+
+		for (uint32_t range = 0; range < range_count; ++range)
+		{
+			range_bases[range + 1] += range_bases[range];
+		}
+
+		std::vector<std::vector<uint32_t>> global_ids(shard_count);
+		for (uint32_t shard = 0; shard < shard_count; ++shard)
+		{
+			global_ids[shard].resize(tables[shard].Vertices().size());
+		}
+
+		unique_vertices.resize(range_bases[range_count]);
+		indices.resize(corner_count);
+
+		thread_pool.ParallelFor(range_count, [&](uint32_t range)
+		{
+			size_t begin = std::min(corner_count, range * range_size);
+			size_t end = std::min(corner_count, begin + range_size);
+
+			uint32_t next_id = range_bases[range];
+			for (size_t i = begin; i < end; ++i)
+			{
+				if (first_use[i])
+				{
+					uint32_t shard = ShardOf(hashes[i]);
+					global_ids[shard][local_ids[i]] = next_id;
+					unique_vertices[next_id] = tables[shard].Vertices()[local_ids[i]];
+					++next_id;
+				}
+			}
+		});
+
+		// 4. remap every corner, first uses of other ranges are all assigned by now
+		thread_pool.ParallelFor(range_count, [&](uint32_t range)
+		{
+			size_t begin = std::min(corner_count, range * range_size);
+			size_t end = std::min(corner_count, begin + range_size);
+
+			for (size_t i = begin; i < end; ++i)
+			{
+				indices[i] = global_ids[ShardOf(hashes[i])][local_ids[i]];
+			}
+		});
+
+		if (p_peak_bytes != nullptr)
+		{
+			*p_peak_bytes = peak_bytes;
+		}
+	}
+
+private:
+	static const uint32_t MAX_SHARD_BITS = 6;
+	static const size_t HASH_BLOCK_SIZE = 256;
+};
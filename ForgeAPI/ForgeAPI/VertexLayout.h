@@ -0,0 +1,325 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// how one vertex attribute is stored in the gpu vertex buffer
+enum class AttributeEncoding : uint32_t
+{
+	Float32,	///< full precision, no quantization
+	Unorm16,	///< 16 bit normalized against the attribute's bounds, dequantized in the vertex shader
+	Half		///< 16 bit float, positions are stored relative to the bounds center to keep precision
+};
+
+// affine transform the vertex shader applies to undo the quantization - stored * scale + offset
+struct VertexDequantization
+{
+	float _position_scale[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+	float _position_offset[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float _texcoord_transform[4] = { 1.0f, 1.0f, 0.0f, 0.0f };	///< xy scale, zw offset
+};
+
+// gpu vertex layout built from per attribute encodings - packs float vertices into it and
+// generates the matching vertex input descriptions. locations: 0 position, 1 color (optional), 2 texcoord
+class VertexLayout
+{
+public:
+	VertexLayout(AttributeEncoding position_encoding = AttributeEncoding::Float32, AttributeEncoding texcoord_encoding = AttributeEncoding::Float32, bool color = false)
+		: _position_encoding(position_encoding), _texcoord_encoding(texcoord_encoding), _color(color)
+	{
+		_position_offset = 0;
+		_color_offset = _position_offset + PositionSize();
+		_texcoord_offset = _color_offset + (_color ? COLOR_SIZE : 0);
+		_stride = _texcoord_offset + TexcoordSize();
+	}
+
+	AttributeEncoding PositionEncoding() const
+	{
+		return _position_encoding;
+	}
+
+	AttributeEncoding TexcoordEncoding() const
+	{
+		return _texcoord_encoding;
+	}
+
+	bool HasColor() const
+	{
+		return _color;
+	}
+
+	uint32_t Stride() const
+	{
+		return _stride;
+	}
+
+	VkFormat PositionFormat() const
+	{
+		switch (_position_encoding)
+		{
+		case AttributeEncoding::Unorm16: return VK_FORMAT_R16G16B16A16_UNORM;
+		case AttributeEncoding::Half: return VK_FORMAT_R16G16B16A16_SFLOAT;
+		default: return VK_FORMAT_R32G32B32_SFLOAT;
+		}
+	}
+
+	VkFormat TexcoordFormat() const
+	{
+		switch (_texcoord_encoding)
+		{
+		case AttributeEncoding::Unorm16: return VK_FORMAT_R16G16_UNORM;
+		case AttributeEncoding::Half: return VK_FORMAT_R16G16_SFLOAT;
+		default: return VK_FORMAT_R32G32_SFLOAT;
+		}
+	}
+
+	VkVertexInputBindingDescription GetBindingDescription() const
+	{
+		VkVertexInputBindingDescription bind_description = {};
+
+		bind_description.binding = 0;
+		bind_description.stride = _stride;
+		bind_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return bind_description;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions() const
+	{
+		std::vector<VkVertexInputAttributeDescription> attribute_descriptions;
+
+		VkVertexInputAttributeDescription position = {};
+		position.binding = 0;
+		position.location = 0;
+		position.format = PositionFormat();
+		position.offset = _position_offset;
+		attribute_descriptions.push_back(position);
+
+		if (_color)
+		{
+			VkVertexInputAttributeDescription color = {};
+			color.binding = 0;
+			color.location = 1;
+			color.format = VK_FORMAT_R8G8B8A8_UNORM;
+			color.offset = _color_offset;
+			attribute_descriptions.push_back(color);
+		}
+
+		VkVertexInputAttributeDescription texcoord = {};
+		texcoord.binding = 0;
+		texcoord.location = 2;
+		texcoord.format = TexcoordFormat();
+		texcoord.offset = _texcoord_offset;
+		attribute_descriptions.push_back(texcoord);
+
+		return attribute_descriptions;
+	}
+
+	// packs count float vertices read at source_stride byte steps - p_colors may be null when the layout has no color
+	// returns the transform the vertex shader needs to restore positions and texcoords
+	VertexDequantization Pack(const float* p_positions, const float* p_texcoords, const float* p_colors, size_t source_stride, size_t count, std::vector<uint8_t>& output) const
+	{
+		auto Attribute = [source_stride](const float* p_base, size_t vertex)
+		{
+			return reinterpret_cast<const float*>(reinterpret_cast<const char*>(p_base) + vertex * source_stride);
+		};
+
+		float position_min[3] = { 0.0f, 0.0f, 0.0f };
+		float position_max[3] = { 0.0f, 0.0f, 0.0f };
+		float texcoord_min[2] = { 0.0f, 0.0f };
+		float texcoord_max[2] = { 0.0f, 0.0f };
+
+		for (size_t vertex = 0; vertex < count; ++vertex)
+		{
+			const float* p_position = Attribute(p_positions, vertex);
+			const float* p_texcoord = Attribute(p_texcoords, vertex);
+
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				position_min[axis] = vertex == 0 ? p_position[axis] : std::min(position_min[axis], p_position[axis]);
+				position_max[axis] = vertex == 0 ? p_position[axis] : std::max(position_max[axis], p_position[axis]);
+			}
+
+			for (uint32_t axis = 0; axis < 2; ++axis)
+			{
+				texcoord_min[axis] = vertex == 0 ? p_texcoord[axis] : std::min(texcoord_min[axis], p_texcoord[axis]);
+				texcoord_max[axis] = vertex == 0 ? p_texcoord[axis] : std::max(texcoord_max[axis], p_texcoord[axis]);
+			}
+		}
+
+		VertexDequantization dequantization;
+
+		float position_scale[3];
+		float position_offset[3];
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			switch (_position_encoding)
+			{
+			case AttributeEncoding::Unorm16:
+				position_offset[axis] = position_min[axis];
+				position_scale[axis] = position_max[axis] - position_min[axis];
+				break;
+			case AttributeEncoding::Half:
+				position_offset[axis] = 0.5f * (position_min[axis] + position_max[axis]);
+				position_scale[axis] = 1.0f;
+				break;
+			default:
+				position_offset[axis] = 0.0f;
+				position_scale[axis] = 1.0f;
+				break;
+			}
+
+			dequantization._position_scale[axis] = position_scale[axis];
+			dequantization._position_offset[axis] = position_offset[axis];
+		}
+
+		float texcoord_scale[2] = { 1.0f, 1.0f };
+		float texcoord_offset[2] = { 0.0f, 0.0f };
+		if (_texcoord_encoding == AttributeEncoding::Unorm16)
+		{
+			// uvs may tile outside [0, 1]
+			for (uint32_t axis = 0; axis < 2; ++axis)
+			{
+				texcoord_offset[axis] = texcoord_min[axis];
+				texcoord_scale[axis] = texcoord_max[axis] - texcoord_min[axis];
+			}
+		}
+
+		dequantization._texcoord_transform[0] = texcoord_scale[0];
+		dequantization._texcoord_transform[1] = texcoord_scale[1];
+		dequantization._texcoord_transform[2] = texcoord_offset[0];
+		dequantization._texcoord_transform[3] = texcoord_offset[1];
+
+		output.assign(count * _stride, 0);
+
+		for (size_t vertex = 0; vertex < count; ++vertex)
+		{
+			uint8_t* p_vertex = output.data() + vertex * _stride;
+			const float* p_position = Attribute(p_positions, vertex);
+			const float* p_texcoord = Attribute(p_texcoords, vertex);
+
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				float value = (p_position[axis] - position_offset[axis]) / (position_scale[axis] != 0.0f ? position_scale[axis] : 1.0f);
+				EncodeComponent(_position_encoding, value, p_vertex + _position_offset, axis);
+			}
+
+			for (uint32_t axis = 0; axis < 2; ++axis)
+			{
+				float value = (p_texcoord[axis] - texcoord_offset[axis]) / (texcoord_scale[axis] != 0.0f ? texcoord_scale[axis] : 1.0f);
+				EncodeComponent(_texcoord_encoding, value, p_vertex + _texcoord_offset, axis);
+			}
+
+			if (_color)
+			{
+				const float* p_color = p_colors != nullptr ? Attribute(p_colors, vertex) : nullptr;
+				for (uint32_t channel = 0; channel < 4; ++channel)
+				{
+					float value = p_color != nullptr && channel < 3 ? p_color[channel] : 1.0f;
+					p_vertex[_color_offset + channel] = static_cast<uint8_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+				}
+			}
+		}
+
+		return dequantization;
+	}
+
+	// round to nearest even, overflow saturates to infinity and tiny values flush through the subnormals
+	static uint16_t FloatToHalf(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		uint32_t sign = (bits >> 16) & 0x8000;
+		uint32_t exponent = (bits >> 23) & 0xFF;
+		uint32_t mantissa = bits & 0x7FFFFF;
+
+		if (exponent == 0xFF)
+		{
+			return static_cast<uint16_t>(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+		}
+
+		int32_t half_exponent = static_cast<int32_t>(exponent) - 127 + 15;
+
+		if (half_exponent >= 31)
+		{
+			return static_cast<uint16_t>(sign | 0x7C00);
+		}
+
+		if (half_exponent <= 0)
+		{
+			if (half_exponent < -10)
+			{
+				return static_cast<uint16_t>(sign);
+			}
+
+			// subnormal - shift the implicit one into the mantissa
+			mantissa |= 0x800000;
+			uint32_t shift = static_cast<uint32_t>(14 - half_exponent);
+			uint32_t half_mantissa = mantissa >> shift;
+			uint32_t remainder = mantissa & ((1u << shift) - 1);
+			uint32_t halfway = 1u << (shift - 1);
+
+			if (remainder > halfway || (remainder == halfway && (half_mantissa & 1)))
+			{
+				++half_mantissa;
+			}
+
+			return static_cast<uint16_t>(sign | half_mantissa);
+		}
+
+		uint32_t half = sign | (static_cast<uint32_t>(half_exponent) << 10) | (mantissa >> 13);
+		uint32_t remainder = mantissa & 0x1FFF;
+
+		// a carry out of the mantissa correctly bumps the exponent
+		if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+		{
+			++half;
+		}
+
+		return static_cast<uint16_t>(half);
+	}
+
+private:
+	static const uint32_t COLOR_SIZE = 4;
+
+	uint32_t PositionSize() const
+	{
+		return _position_encoding == AttributeEncoding::Float32 ? 3 * sizeof(float) : 4 * sizeof(uint16_t);
+	}
+
+	uint32_t TexcoordSize() const
+	{
+		return _texcoord_encoding == AttributeEncoding::Float32 ? 2 * sizeof(float) : 2 * sizeof(uint16_t);
+	}
+
+	static void EncodeComponent(AttributeEncoding encoding, float value, uint8_t* p_attribute, uint32_t component)
+	{
+		if (encoding == AttributeEncoding::Float32)
+		{
+			memcpy(p_attribute + component * sizeof(float), &value, sizeof(float));
+			return;
+		}
+
+		uint16_t encoded = encoding == AttributeEncoding::Unorm16
+			? static_cast<uint16_t>(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f + 0.5f)
+			: FloatToHalf(value);
+
+		memcpy(p_attribute + component * sizeof(uint16_t), &encoded, sizeof(uint16_t));
+	}
+
+	// BEGIN PRIVATE MEMBERS
+	AttributeEncoding _position_encoding;
+	AttributeEncoding _texcoord_encoding;
+	bool _color;
+	uint32_t _position_offset;
+	uint32_t _color_offset;
+	uint32_t _texcoord_offset;
+	uint32_t _stride;
+	// END PRIVATE MEMBERS
+};
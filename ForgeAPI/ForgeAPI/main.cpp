@@ -1,5 +1,10 @@
+// FORGE_NO_WINDOW builds only the headless backend and needs no GLFW, see CMakeLists.txt
+#ifdef FORGE_NO_WINDOW
+#include <vulkan/vulkan.h>
+#else
 #define GLFW_INCLUDE_VULKAN
-#include <glfw/glfw3.h>
+#include <GLFW/glfw3.h>
+#endif
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -13,6 +18,7 @@
 #include <glm/gtx/hash.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 #include <chrono>
 #include <fstream>
@@ -23,6 +29,33 @@
 #include <set>
 #include <iostream>
 #include <stdexcept>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+
+#include "BlockCompressor.h"
+#include "DescriptorAllocator.h"
+#include "DeviceMemoryAllocator.h"
+#include "FrameProfiler.h"
+#include "FrustumCuller.h"
+#include "MatrixBatch.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+#include "PipelineCache.h"
+#include "PipelineRegistry.h"
+#include "ShaderReloader.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "TextureTable.h"
+#include "UniformRing.h"
+#include "UploadManager.h"
+#include "VertexDeduplicator.h"
+#include "VertexLayout.h"
 
 // debug extension functions
 #ifndef NDEBUG
@@ -52,43 +85,51 @@ void DestroyDebugReportCallbackEXT(VkInstance instance, VkDebugReportCallbackEXT
 const std::vector<const char*> VALIDATION_LAYERS = { "VK_LAYER_LUNARG_standard_validation" };
 const std::vector<const char*> DEVICE_EXTENSIONS = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
+const uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+const VkDeviceSize UNIFORM_RING_FRAME_SIZE = 256 * 1024;	///< uniform bytes each frame can sub-allocate
+const uint32_t VERTEX_FORMAT_VERSION = 3;	///< bump when Vertex or the cooking in CookModel changes, stale cooked meshes are rebuilt
+const VkDeviceSize UPLOAD_STAGING_SIZE = 32 * 1024 * 1024;	///< staging ring shared by all uploads, larger uploads get their own buffer
+const VkDeviceSize TEXTURE_STAGING_SIZE = 64 * 1024 * 1024;	///< decode workers write textures here, a larger texture fails to stream
+const size_t PARALLEL_DEDUP_CORNERS = 1 << 20;	///< meshes with at least this many face corners dedup their vertices on all threads
+const float OVERDRAW_THRESHOLD = 1.05f;	///< acmr the overdraw pass may give up relative to the vertex cache order, 0 skips the pass
+const uint32_t CULL_GROUP_SIZE = 64;	///< local_size_x of cull.comp
+const uint32_t PIPELINE_COMPILE_THREADS = 2;	///< pipeline registry workers, new variants compile here while draws use another
+const uint32_t TEXTURE_TABLE_CAPACITY = 4096;	///< bindless texture slots with descriptor indexing, clamped to the device limits
+const uint32_t TEXTURE_TABLE_FALLBACK_CAPACITY = 16;	///< without it every slot is written - the minimum maxPerStageDescriptorSamplers
+const uint32_t FRAME_DESCRIPTOR_SETS_PER_POOL = 16;	///< sets in each pool of a frame's DescriptorAllocator
+const char* const PIPELINE_CACHE_PATH = "pipeline.cache";	///< driver pipeline cache, rebuilt whenever the gpu or driver changes
+
+// cooking format - the gpu buffer is packed from it in the layout VertexLayout describes
 struct Vertex
 {
 	glm::vec3 pos;
 	glm::vec3 color;
 	glm::vec2 uv;
 
-	static VkVertexInputBindingDescription GetBindingDescription()
-	{
-		VkVertexInputBindingDescription bind_description = {};
-
-		bind_description.binding = 0;
-		bind_description.stride = sizeof(Vertex);
-		bind_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-		return bind_description;
-	}
-
-	static std::array<VkVertexInputAttributeDescription, 3> GetAttributeDescriptions()
+	// white vertex from one obj face corner, uv flipped to vulkan's top left origin
+	static Vertex FromObj(const ObjMesh& mesh, const ObjIndex& index)
 	{
-		std::array<VkVertexInputAttributeDescription, 3> attribute_descriptions = {};
+		Vertex vert = {};
 
-		attribute_descriptions[0].binding = 0;
-		attribute_descriptions[0].location = 0;
-		attribute_descriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attribute_descriptions[0].offset = offsetof(Vertex, pos);
+		vert.pos =
+		{
+			mesh._positions[3 * index._position + 0],
+			mesh._positions[3 * index._position + 1],
+			mesh._positions[3 * index._position + 2]
+		};
 
-		attribute_descriptions[1].binding = 0;
-		attribute_descriptions[1].location = 1;
-		attribute_descriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attribute_descriptions[1].offset = offsetof(Vertex, color);
+		if (index._texcoord >= 0)
+		{
+			vert.uv =
+			{
+				mesh._texcoords[2 * index._texcoord + 0],
+				1 - mesh._texcoords[2 * index._texcoord + 1]
+			};
+		}
 
-		attribute_descriptions[2].binding = 0;
-		attribute_descriptions[2].location = 2;
-		attribute_descriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-		attribute_descriptions[2].offset = offsetof(Vertex, uv);
+		vert.color = { 1.0f, 1.0f, 1.0f };
 
-		return attribute_descriptions;
+		return vert;
 	}
 
 	bool operator ==(const Vertex& other) const
@@ -97,6 +138,10 @@ struct Vertex
 	}
 };
 
+// VertexDeduplicator hashes and compares raw bytes, padding would make equal vertices differ
+static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertex Must Not Contain Padding!");
+
+// only the reference std::unordered_map of the dedup benchmark still uses this
 namespace std
 {
 	template<> struct hash<Vertex>
@@ -113,12 +158,48 @@ struct UniformBufferObject
 	glm::mat4 model;
 	glm::mat4 view;
 	glm::mat4 proj;
+	glm::vec4 frustum_planes[6];	///< model space, what the cull compute pass tests against
+};
+
+// push constants of the graphics pipeline, pushed with the draw state - anything that no longer fits the 128 bytes
+// every device guarantees is pushed to the uniform ring instead and bound at the dynamic offset Push returns
+struct DrawConstants
+{
+	glm::vec4 position_scale;	///< VertexDequantization, undoes the vertex layout's quantization
+	glm::vec4 position_offset;
+	glm::vec4 texcoord_transform;
+};
+
+static_assert(sizeof(DrawConstants) <= 128, "DrawConstants Exceed The Guaranteed maxPushConstantsSize!");
+
+// std430 element of the instance storage buffer, read in the vertex shader through gl_InstanceIndex
+struct InstanceData
+{
+	glm::mat4 model;	///< applied before the ubo model matrix
+	glm::vec3 color;	///< tint multiplied into the texture
+	uint32_t texture_slot;	///< TextureTable slot the fragment shader samples
+};
+
+// std430 element of the submesh bounds buffer read by cull.comp
+struct SubmeshBounds
+{
+	glm::vec4 center;	///< w unused
+	glm::vec4 extent;
+};
+
+// consecutive instances of one submesh that survived culling, drawn with one instanced call
+struct InstanceRange
+{
+	uint32_t _submesh;
+	uint32_t _first_instance;
+	uint32_t _instance_count;
 };
 
 struct QueueFamilies
 {
 	int _graphics_family = -1;
 	int _present_family = -1;
+	int _transfer_family = -1;	///< transfer only family when available, otherwise the graphics family
 
 	bool QueuesAquired()
 	{
@@ -133,34 +214,242 @@ struct SwapChainSupport
 	std::vector<VkPresentModeKHR> _present_modes;
 };
 
+enum class CullingMode
+{
+	None,	///< every instance, command buffers are recorded once
+	Cpu,	///< bvh on the cpu, the acquired image's draws are re-recorded every frame
+	Gpu,	///< a compute pass compacts the visible instances into indirect draws, nothing is re-recorded
+};
+
+struct ApplicationSettings
+{
+	uint32_t _frames_in_flight = 2;	///< frames the cpu may record ahead of the gpu - clamped to [1, MAX_FRAMES_IN_FLIGHT]
+	uint32_t _frame_limit = 0;		///< stop after this many frames, 0 runs until the window closes
+	bool _headless = false;			///< render into offscreen images - no window, surface or swapchain
+	std::string _readback_directory;	///< headless only - copy every frame back and write it here as a .ppm
+	std::string _profile_output;		///< per frame cpu/gpu timings, .json for chrome trace or .csv - empty disables profiling
+	bool _print_memory_statistics = false;
+	std::string _model_path = "Models/type-99.obj";
+	AttributeEncoding _position_encoding = AttributeEncoding::Unorm16;	///< falls back to Float32 when the device cannot fetch the format
+	AttributeEncoding _texcoord_encoding = AttributeEncoding::Unorm16;
+	bool _vertex_color = false;	///< cooked colors are always white, the shader substitutes white without the attribute
+	bool _cpu_mip_generation = false;	///< build texture mips with the cpu box filter even when the gpu can blit them
+	std::string _texture_compression = "bc7";	///< bc7, bc3, bc1 or none - weaker formats are tried when the device lacks the requested one
+	bool _async_textures = true;	///< false waits for every texture before the first frame instead of drawing the placeholder
+	uint32_t _instance_count = 1;	///< copies of the model laid out on a grid
+	uint32_t _record_threads = 0;	///< record the draws every frame into this many secondary command buffers in parallel, 0 records primaries only
+	bool _instanced_draws = true;	///< one instanced draw per submesh, false issues one draw per instance (benchmark baseline)
+	CullingMode _culling = CullingMode::Cpu;	///< Gpu falls back to Cpu without drawIndirectFirstInstance
+	bool _shader_hot_reload = false;	///< recompile and swap in the pipelines whenever a shader in Shaders/ changes
+	bool _wireframe = false;	///< start in the wireframe variant, F toggles it at runtime - needs fillModeNonSolid
+	bool _cpu_transforms = true;	///< multiply every instance's mvp on the cpu, false chains the matrices per vertex (benchmark baseline)
+};
+
+struct FrameStatistics
+{
+	uint64_t _frame_count = 0;
+	double _elapsed_seconds = 0.0;
+	bool _pipeline_cache_loaded = false;	///< the pipeline cache was seeded from disk
+	std::vector<double> _pipeline_creation_seconds;	///< startup first, then one per surface format change - resizes keep the pipeline
+	uint32_t _vertex_stride = 0;
+	uint64_t _vertex_buffer_bytes = 0;
+	double _texture_latency_seconds = 0.0;	///< texture request until resident, 0 when it never streamed in
+	uint64_t _triangles_per_frame = 0;		///< all instances
+	uint64_t _visible_triangles = 0;		///< last frame, after culling
+	double _record_seconds = 0.0;			///< cpu time spent recording per frame command buffers, all frames
+	double _transform_seconds = 0.0;		///< cpu time spent multiplying instance mvps, all frames
+	double _gpu_seconds = 0.0;				///< profiling only - gpu time of the frames in _gpu_frame_count
+	uint64_t _gpu_frame_count = 0;
+	std::vector<double> _pipeline_switch_seconds;	///< per shader reload or variant switch, from the change until the new pipelines were bound
+};
+
+// resources owned by one frame in flight - reused once _in_flight_fence signals
+struct FrameData
+{
+	VkFence _in_flight_fence;
+	VkSemaphore _image_available_semaphore;
+	VkSemaphore _render_finished_semaphore;
+	DescriptorAllocator _descriptor_allocator;	///< the frame's sets, see AllocateFrameDescriptors
+	VkDescriptorSet _descriptor_set = VK_NULL_HANDLE;	///< from _descriptor_allocator
+	VkImageView _texture_view = VK_NULL_HANDLE;	///< what the texture's slot in the frame's table set references, the placeholder until it streams in
+	std::vector<VkCommandPool> _vk_secondary_command_pools;	///< one per recording thread, reset every frame
+	std::vector<VkCommandBuffer> _secondary_command_buffers;	///< IMPLICITLY DESTROYED BY POOL - one per recording thread, executed in order
+	VkDescriptorSet _cull_descriptor_set = VK_NULL_HANDLE;	///< gpu culling only - from _descriptor_allocator
+	VkBuffer _vk_draw_command_buffer = VK_NULL_HANDLE;	///< gpu culling only - one indirect command per submesh, host visible so the survivors can be counted
+	GpuAllocation _draw_command_allocation;
+	VkBuffer _vk_visible_instance_buffer = VK_NULL_HANDLE;	///< gpu culling only - visible instance indices, one slice per submesh
+	GpuAllocation _visible_instance_allocation;
+	VkBuffer _vk_transform_buffer = VK_NULL_HANDLE;	///< cpu transforms only - one mvp per instance, host visible and rewritten every frame
+	GpuAllocation _transform_allocation;
+	VkBuffer _vk_readback_buffer = VK_NULL_HANDLE;	///< headless readback only - the frame's image, copied at the end of its command buffer
+	GpuAllocation _readback_allocation;
+	uint64_t _readback_frame = UINT64_MAX;	///< frame number _vk_readback_buffer holds once the fence signals, UINT64_MAX for none
+	uint64_t _submission = 0;	///< serial of the last submit that signals _in_flight_fence
+	uint32_t _pipeline_generation = 0;	///< what the command buffers were recorded with, see UpdatePipelines
+};
+
+// a pipeline in use - draws keep the bound variant until the requested one has compiled
+struct PipelineSlot
+{
+	PipelineHandle _requested = INVALID_PIPELINE;
+	PipelineHandle _bound = INVALID_PIPELINE;
+};
+
+// PipelineState::_layout of the application's pipelines
+enum PipelineLayoutId : uint32_t
+{
+	GRAPHICS_PIPELINE_LAYOUT,
+	CULL_PIPELINE_LAYOUT,
+};
+
+// extent dependent resources a resize replaced - frames submitted before the rebuild may still use them,
+// so they are destroyed once the fence of the last of those frames has signaled instead of idling the device
+struct RetiredSwapchain
+{
+	uint64_t _last_submission;	///< serial of the last submit that can reference the resources
+	VkSwapchainKHR _vk_swapchain;	///< already retired through oldSwapchain, only the handle is left
+	std::vector<VkImageView> _vk_image_views;
+	std::vector<VkFramebuffer> _vk_frame_buffers;
+	std::vector<VkCommandBuffer> _vk_command_buffers;
+	VkImage _vk_color_image;
+	GpuAllocation _color_image_allocation;
+	VkImageView _vk_color_image_view;
+	VkImage _vk_depth_image;
+	GpuAllocation _depth_image_allocation;
+	VkImageView _vk_depth_image_view;
+	VkRenderPass _vk_render_pass;	///< VK_NULL_HANDLE unless the surface format changed, then the old one
+	std::vector<PipelineHandle> _pipelines;	///< evicted from the registry along with _vk_render_pass
+};
+
 class HelloTriangleApplication
 {
 public:
-	HelloTriangleApplication()
+	HelloTriangleApplication(const ApplicationSettings& settings = ApplicationSettings())
 	{
 		_window_height = 600;
 		_window_width = 800;
 		_window_name = "ForgeVK";
+
+		_settings = settings;
+		_settings._frames_in_flight = std::max(1u, std::min(_settings._frames_in_flight, MAX_FRAMES_IN_FLIGHT));
 	}
 
 	void Run()
 	{
-		InitializeWindow();
+		if (!_settings._headless)
+		{
+			InitializeWindow();
+		}
+
 		InitializeVulkan();
 		MainLoop();
 		EndProgram();
 	}
 
+	const FrameStatistics& Statistics() const
+	{
+		return _statistics;
+	}
+
 private:
+	// everything that touches GLFW - headless runs never call these
+#ifndef FORGE_NO_WINDOW
 	void InitializeWindow()
 	{
 		glfwInit();
 		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 		_p_glfw_window = glfwCreateWindow(_window_width, _window_height, _window_name, nullptr, nullptr);
 		glfwSetWindowUserPointer(_p_glfw_window, this);
-		glfwSetWindowSizeCallback(_p_glfw_window, HelloTriangleApplication::OnWindowResize);
+		glfwSetFramebufferSizeCallback(_p_glfw_window, HelloTriangleApplication::OnWindowResize);
+		glfwSetKeyCallback(_p_glfw_window, HelloTriangleApplication::OnKey);
+	}
+
+	void ReleaseWindow()
+	{
+		glfwDestroyWindow(_p_glfw_window);
+		glfwTerminate();
+	}
+
+	bool WindowClosed()
+	{
+		return glfwWindowShouldClose(_p_glfw_window) != 0;
 	}
 
+	// wait blocks until the next event, e.g. while minimized
+	void PollWindowEvents(bool wait)
+	{
+		if (wait)
+		{
+			glfwWaitEvents();
+		}
+		else
+		{
+			glfwPollEvents();
+		}
+	}
+
+	void WindowFramebufferSize(int& width, int& height)
+	{
+		glfwGetFramebufferSize(_p_glfw_window, &width, &height);
+	}
+
+	void CreateSurface()
+	{
+		if (glfwCreateWindowSurface(_vk_instance, _p_glfw_window, nullptr, &_vk_surface) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Window Surface Creation Failed!");
+		}
+	}
+
+	void AddWindowExtensions(std::vector<const char*>& extensions)
+	{
+		uint32_t glfw_ret_val_num = 0;
+		const char** pp_glfw_ret_val_names;
+		pp_glfw_ret_val_names = glfwGetRequiredInstanceExtensions(&glfw_ret_val_num);
+
+		if (pp_glfw_ret_val_names == nullptr)
+		{
+			// vulkan not supported or no ret_vals to draw to screen exist
+			throw std::runtime_error("Vulkan Graphics Unavailable!");
+		}
+
+		// add layer extensions
+		for (uint32_t i = 0; i < glfw_ret_val_num; ++i)
+		{
+			extensions.push_back(pp_glfw_ret_val_names[i]);
+		}
+	}
+
+	// only flags the swapchain - a drag fires this many times per frame, Draw rebuilds at most once before acquiring
+	static void OnWindowResize(GLFWwindow* window, int width, int height)
+	{
+		HelloTriangleApplication* application = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+		application->_swapchain_resize_pending = true;
+	}
+
+	// F toggles wireframe - the variant compiles in the background the first time, the current one draws meanwhile
+	static void OnKey(GLFWwindow* window, int key, int scancode, int action, int mods)
+	{
+		if (key == GLFW_KEY_F && action == GLFW_PRESS)
+		{
+			HelloTriangleApplication* application = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+			application->_wireframe_toggled = true;
+		}
+	}
+#else
+	void InitializeWindow()
+	{
+		throw std::runtime_error("Built Without Window Support, Run With --headless!");
+	}
+
+	void ReleaseWindow() {}
+	bool WindowClosed() { return true; }
+	void PollWindowEvents(bool wait) {}
+	void WindowFramebufferSize(int& width, int& height) { width = 0; height = 0; }
+	void CreateSurface() {}
+	void AddWindowExtensions(std::vector<const char*>& extensions) {}
+#endif
+
 	void InitializeVulkan()
 	{
 		CreateVkInstance();
@@ -178,82 +467,197 @@ private:
 		}
 #endif
 
-		CreateSurface();
-		SelectPhysicalDevice();
-		CreateLogicalDevice(_available_queue_families);
-		CreateSwapChain(_available_queue_families);
+		if (_settings._headless)
+		{
+			SelectPhysicalDevice();
+			CreateLogicalDevice(_available_queue_families);
+			CreateOffscreenImages();
+		}
+		else
+		{
+			CreateSurface();
+			SelectPhysicalDevice();
+			CreateLogicalDevice(_available_queue_families);
+			CreateSwapChain(_available_queue_families);
+		}
+
 		CreateImageViews();
 		CreateRenderPass();
 		CreateDescriptorSetLayout();
+		SelectVertexLayout();
 		CreateGraphicsPipeline();
+		CreateCullPipeline();
 		CreateCommandPool(_available_queue_families);
+		CreateColorResources();
 		CreateDepthResources();
 		CreateFrameBuffers();
 		CreateTextureImage();
-		CreateTextureImageView();
 		CreateTextureSampler();
 		LoadModel();
 		CreateVertexBuffer();
 		CreateIndexBuffer();
-		CreateUniformBuffer();
-		CreateDescriptorPool();
-		CreateDescriptorSet();
+		CreateInstanceBuffer();
+		CreateCullBuffers();
+		ReleaseMeshData();
+
+		// the uploads are ordered before the first frame on the graphics queue, nothing waits on the cpu
+		_upload_manager.Flush();
+
+		if (!_settings._async_textures)
+		{
+			_texture_streamer.Finish();
+			_statistics._texture_latency_seconds = _texture_streamer.ResidentLatency(_texture);
+		}
+
+		CreateUniformBuffers();
+		CreateIndirectDrawBuffers();
+		CreateTransformBuffers();
+		CreateReadbackBuffers();
+		CreateFrameDescriptors();
+		CreateTimestampQueryPool();
+		CreateRecordingResources();
 		CreateCommandBuffers();
-		CreateSemaphores();
+		CreateSyncObjects();
+
+		if (_settings._shader_hot_reload)
+		{
+			StartShaderReloader();
+		}
+
+		if (!_settings._profile_output.empty())
+		{
+			_profiler.Open(_settings._profile_output, static_cast<uint32_t>(_frames.size()));
+		}
 	}
 
 	void MainLoop()
 	{
-		while (!glfwWindowShouldClose(_p_glfw_window))
+		auto start_time = std::chrono::high_resolution_clock::now();
+
+		while (_settings._headless || !WindowClosed())
 		{
-			glfwPollEvents();
-			UpdateUniformBuffer();
-			Draw();
+			if (_settings._headless)
+			{
+				DrawOffscreen();
+			}
+			else
+			{
+				PollWindowEvents(false);
+				Draw();
+			}
+
+			++_statistics._frame_count;
+			if (_settings._frame_limit != 0 && _statistics._frame_count >= _settings._frame_limit)
+			{
+				break;
+			}
 		}
 
 		vkDeviceWaitIdle(_vk_logical_device);
+
+		auto end_time = std::chrono::high_resolution_clock::now();
+		_statistics._elapsed_seconds = std::chrono::duration<double, std::chrono::seconds::period>(end_time - start_time).count();
+
+		// every frame has finished, collect the timings and images still waiting on the gpu
+		for (uint32_t i = 0; i < _frames.size(); ++i)
+		{
+			ResolveGpuTimestamps(i);
+			WriteReadback(i);
+		}
+
+		_profiler.Close();
+
+		if (_settings._print_memory_statistics)
+		{
+			_memory_allocator.PrintStatistics(std::cout);
+		}
 	}
 
 	void EndProgram()
 	{
+		_shader_reloader.Release();
+		// variants still compiling read the layouts and the render pass released below
+		_pipeline_registry.WaitIdle();
+		DestroyRetiredSwapchains(std::numeric_limits<uint64_t>::max());
 		ReleaseSwapchain();
 		vkDestroySampler(_vk_logical_device, _vk_texture_sampler, nullptr);
-		vkDestroyImageView(_vk_logical_device, _vk_texture_image_view, nullptr);
-		vkDestroyImage(_vk_logical_device, _vk_texture_image, nullptr);
-		vkFreeMemory(_vk_logical_device, _vk_texture_image_memory, nullptr);
-		vkDestroyDescriptorPool(_vk_logical_device, _vk_descriptor_pool, nullptr);
+		_texture_streamer.Release();
+		_texture_table.Release();
 		vkDestroyDescriptorSetLayout(_vk_logical_device, _vk_descriptor_set_layout, nullptr);
-		vkDestroyBuffer(_vk_logical_device, _vk_uniform_buffer, nullptr);
-		vkFreeMemory(_vk_logical_device, _vk_uniform_buffer_memory, nullptr);
 		vkDestroyBuffer(_vk_logical_device, _vk_index_buffer, nullptr);
-		vkFreeMemory(_vk_logical_device, _vk_index_buffer_memory, nullptr);
+		_memory_allocator.Free(_index_buffer_allocation);
 		vkDestroyBuffer(_vk_logical_device, _vk_vertex_buffer, nullptr);
-		vkFreeMemory(_vk_logical_device, _vk_vertex_buffer_memory, nullptr);
-		vkDestroySwapchainKHR(_vk_logical_device, _vk_swapchain, nullptr);
-		vkDestroySemaphore(_vk_logical_device, _vk_frame_complete_semaphore, nullptr);
-		vkDestroySemaphore(_vk_logical_device, _vk_image_available_semaphore, nullptr);
+		_memory_allocator.Free(_vertex_buffer_allocation);
+		vkDestroyBuffer(_vk_logical_device, _vk_instance_buffer, nullptr);
+		_memory_allocator.Free(_instance_buffer_allocation);
+		vkDestroyBuffer(_vk_logical_device, _vk_instance_index_buffer, nullptr);
+		_memory_allocator.Free(_instance_index_buffer_allocation);
+		vkDestroyBuffer(_vk_logical_device, _vk_submesh_bounds_buffer, nullptr);
+		_memory_allocator.Free(_submesh_bounds_buffer_allocation);
+		vkDestroyBuffer(_vk_logical_device, _vk_draw_command_template, nullptr);
+		_memory_allocator.Free(_draw_command_template_allocation);
+		vkDestroyPipelineLayout(_vk_logical_device, _vk_cull_pipeline_layout, nullptr);
+		vkDestroyDescriptorSetLayout(_vk_logical_device, _vk_cull_descriptor_set_layout, nullptr);
+		vkDestroyBuffer(_vk_logical_device, _vk_uniform_buffer, nullptr);
+		_memory_allocator.Free(_uniform_buffer_allocation);
+		if (_settings._headless)
+		{
+			ReleaseOffscreenImages();
+		}
+		else
+		{
+			vkDestroySwapchainKHR(_vk_logical_device, _vk_swapchain, nullptr);
+		}
+
+		for (auto& frame : _frames)
+		{
+			frame._descriptor_allocator.Release();
+			for (VkCommandPool command_pool : frame._vk_secondary_command_pools)
+			{
+				vkDestroyCommandPool(_vk_logical_device, command_pool, nullptr);
+			}
+			vkDestroyBuffer(_vk_logical_device, frame._vk_draw_command_buffer, nullptr);
+			_memory_allocator.Free(frame._draw_command_allocation);
+			vkDestroyBuffer(_vk_logical_device, frame._vk_visible_instance_buffer, nullptr);
+			_memory_allocator.Free(frame._visible_instance_allocation);
+			vkDestroyBuffer(_vk_logical_device, frame._vk_transform_buffer, nullptr);
+			_memory_allocator.Free(frame._transform_allocation);
+			vkDestroyBuffer(_vk_logical_device, frame._vk_readback_buffer, nullptr);
+			_memory_allocator.Free(frame._readback_allocation);
+			vkDestroyFence(_vk_logical_device, frame._in_flight_fence, nullptr);
+			vkDestroySemaphore(_vk_logical_device, frame._render_finished_semaphore, nullptr);
+			vkDestroySemaphore(_vk_logical_device, frame._image_available_semaphore, nullptr);
+		}
+
+		if (_vk_timestamp_query_pool != VK_NULL_HANDLE)
+		{
+			vkDestroyQueryPool(_vk_logical_device, _vk_timestamp_query_pool, nullptr);
+		}
+
 		vkDestroyCommandPool(_vk_logical_device, _vk_command_pool, nullptr);
+
+		// every variant compiled this run goes into the cache file
+		_pipeline_registry.Release();
+		_pipeline_cache.Release();
+		_upload_manager.Release();
+		_memory_allocator.Release();
 		vkDestroyDevice(_vk_logical_device, nullptr);
 
 #ifndef NDEBUG
 		DestroyDebugReportCallbackEXT(_vk_instance, _vk_callback, nullptr);
 #endif // !NDEBUG
 
-		vkDestroySurfaceKHR(_vk_instance, _vk_surface, nullptr);
+		if (!_settings._headless)
+		{
+			vkDestroySurfaceKHR(_vk_instance, _vk_surface, nullptr);
+		}
+
 		vkDestroyInstance(_vk_instance, nullptr);
-		glfwDestroyWindow(_p_glfw_window);
-		glfwTerminate();
-	}
 
-	static void OnWindowResize(GLFWwindow* window, int width, int height)
-	{
-		if (width == 0 || height == 0)
+		if (!_settings._headless)
 		{
-			return;
+			ReleaseWindow();
 		}
-
-		HelloTriangleApplication* application = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
-		application->RecreateSwapChain();
 	}
 
 	void CreateVkInstance()
@@ -297,13 +701,6 @@ private:
 		}
 	}
 	
-	void CreateSurface()
-	{
-		if (glfwCreateWindowSurface(_vk_instance, _p_glfw_window, nullptr, &_vk_surface) != VK_SUCCESS)
-		{
-			throw std::runtime_error("Window Surface Creation Failed!");
-		}
-	}
 
 	void SelectPhysicalDevice()
 	{
@@ -331,6 +728,7 @@ private:
 		if (sufficient_devices.size() > 0)
 		{
 			_vk_physical_device = sufficient_devices[0];
+			_vk_sample_count_flag_bits = ClampSampleCount(_vk_sample_count_flag_bits);
 		}
 		else
 		{
@@ -344,7 +742,7 @@ private:
 
 		// generate queue create structs
 		std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
-		std::set<int> unique_queue_families = { queue_family_data._graphics_family, queue_family_data._present_family };
+		std::set<int> unique_queue_families = { queue_family_data._graphics_family, queue_family_data._present_family, queue_family_data._transfer_family };
 
 		float queue_priority = 1.0f;
 
@@ -360,8 +758,49 @@ private:
 		}
 		
 		// device features
+		VkPhysicalDeviceFeatures supported_features;
+		vkGetPhysicalDeviceFeatures(_vk_physical_device, &supported_features);
+
+		// only what is used - software rasterizers such as lavapipe may lack some of these
 		VkPhysicalDeviceFeatures device_features = {};
-		device_features.samplerAnisotropy = VK_TRUE;
+		device_features.samplerAnisotropy = supported_features.samplerAnisotropy;
+		device_features.textureCompressionBC = supported_features.textureCompressionBC;
+		device_features.multiDrawIndirect = supported_features.multiDrawIndirect;
+		device_features.drawIndirectFirstInstance = supported_features.drawIndirectFirstInstance;
+		device_features.fillModeNonSolid = supported_features.fillModeNonSolid;
+		_sampler_anisotropy = supported_features.samplerAnisotropy == VK_TRUE;
+		_texture_compression_bc = supported_features.textureCompressionBC == VK_TRUE;
+		_multi_draw_indirect = supported_features.multiDrawIndirect == VK_TRUE;
+		_fill_mode_non_solid = supported_features.fillModeNonSolid == VK_TRUE;
+
+		if (_settings._wireframe && !_fill_mode_non_solid)
+		{
+			std::cerr << "fillModeNonSolid is not supported, no wireframe" << std::endl;
+		}
+		_wireframe = _settings._wireframe && _fill_mode_non_solid;
+
+		// the texture table is indexed per instance - without descriptor indexing all instances of a draw must agree,
+		// the index is still not a constant, so TestPhysicalDevice only accepts devices with dynamic indexing
+		device_features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+		_descriptor_indexing = SupportsDescriptorIndexing(_texture_table_capacity);
+		if (!_descriptor_indexing)
+		{
+			std::cerr << "VK_EXT_descriptor_indexing is not supported, the texture table is fully bound and all instances of a draw share a texture" << std::endl;
+		}
+
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptor_indexing_features = {};
+		descriptor_indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+		descriptor_indexing_features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+		descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		descriptor_indexing_features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+		descriptor_indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+
+		// every submesh's indirect draw starts at its own slice of the visible instances
+		if (_settings._culling == CullingMode::Gpu && supported_features.drawIndirectFirstInstance != VK_TRUE)
+		{
+			std::cerr << "drawIndirectFirstInstance is not supported, culling on the cpu instead" << std::endl;
+			_settings._culling = CullingMode::Cpu;
+		}
 
 		// logical device info
 		VkDeviceCreateInfo device_create_info = {};
@@ -369,8 +808,15 @@ private:
 		device_create_info.pQueueCreateInfos = queue_create_infos.data();
 		device_create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
 		device_create_info.pEnabledFeatures = &device_features;
-		device_create_info.enabledExtensionCount = static_cast<uint32_t>(DEVICE_EXTENSIONS.size());
-		device_create_info.ppEnabledExtensionNames = DEVICE_EXTENSIONS.data();
+		std::vector<const char*> device_extensions = RequiredDeviceExtensions();
+		if (_descriptor_indexing)
+		{
+			device_extensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+			device_extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+			device_create_info.pNext = &descriptor_indexing_features;
+		}
+		device_create_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
+		device_create_info.ppEnabledExtensionNames = device_extensions.data();
 #ifndef DEBUG
 		device_create_info.enabledLayerCount = static_cast<uint32_t>(VALIDATION_LAYERS.size());
 		device_create_info.ppEnabledLayerNames = VALIDATION_LAYERS.data();
@@ -386,13 +832,26 @@ private:
 		// get queue handles - no new creation occurs here
 		vkGetDeviceQueue(_vk_logical_device, queue_family_data._graphics_family, 0, &_vk_graphics_queue);
 		vkGetDeviceQueue(_vk_logical_device, queue_family_data._present_family, 0, &_vk_present_queue);
+		vkGetDeviceQueue(_vk_logical_device, queue_family_data._transfer_family, 0, &_vk_transfer_queue);
+
+		_memory_allocator.Initialize(_vk_physical_device, _vk_logical_device);
+		_upload_manager.Initialize(_vk_logical_device, _memory_allocator, queue_family_data._transfer_family, _vk_transfer_queue, queue_family_data._graphics_family, _vk_graphics_queue, UPLOAD_STAGING_SIZE);
+
+		_pipeline_cache.Initialize(_vk_physical_device, _vk_logical_device, PIPELINE_CACHE_PATH);
+		_statistics._pipeline_cache_loaded = _pipeline_cache.LoadedFromDisk();
+
+		_pipeline_registry.Initialize(_vk_logical_device, [this](const PipelineState& state, VkRenderPass render_pass) { return BuildPipeline(state, render_pass); }, PIPELINE_COMPILE_THREADS);
 	}
 	
 	void ReleaseSwapchain()
 	{
+		vkDestroyImageView(_vk_logical_device, _vk_color_image_view, nullptr);
+		vkDestroyImage(_vk_logical_device, _vk_color_image, nullptr);
+		_memory_allocator.Free(_color_image_allocation);
+
 		vkDestroyImageView(_vk_logical_device, _vk_depth_image_view, nullptr);
 		vkDestroyImage(_vk_logical_device, _vk_depth_image, nullptr);
-		vkFreeMemory(_vk_logical_device, _vk_depth_image_memory, nullptr);
+		_memory_allocator.Free(_depth_image_allocation);
 
 		for (auto frame_buffer : _vk_swapchain_frame_buffers)
 		{
@@ -401,7 +860,6 @@ private:
 		
 		vkFreeCommandBuffers(_vk_logical_device, _vk_command_pool, static_cast<uint32_t>(_vk_command_buffers.size()), _vk_command_buffers.data());
 		
-		vkDestroyPipeline(_vk_logical_device, _vk_pipeline, nullptr);
 		vkDestroyPipelineLayout(_vk_logical_device, _vk_pipeline_layout, nullptr);
 		
 		vkDestroyRenderPass(_vk_logical_device, _vk_render_pass, nullptr);
@@ -412,21 +870,118 @@ private:
 		}
 	}
 
+	// called from Draw only, at most once per frame - viewport and scissor are dynamic, so the render pass and pipeline
+	// survive a resize and only the extent dependent resources are rebuilt, the old ones retire behind the frame fences
 	void RecreateSwapChain()
 	{
-		VkSwapchainKHR old = _vk_swapchain;
-		CreateSwapChain(_available_queue_families, old);
-		vkDeviceWaitIdle(_vk_logical_device);
-		ReleaseSwapchain();
-		vkDestroySwapchainKHR(_vk_logical_device, old, nullptr);
+		// minimized - stays pending until the window has an area again
+		int width = 0, height = 0;
+		WindowFramebufferSize(width, height);
+		if (width == 0 || height == 0)
+		{
+			PollWindowEvents(true);
+			return;
+		}
+
+		_swapchain_resize_pending = false;
+
+		RetiredSwapchain retired = {};
+		retired._last_submission = _submission_serial;
+		retired._vk_swapchain = _vk_swapchain;
+		retired._vk_image_views.swap(_vk_swapchain_image_views);
+		retired._vk_frame_buffers.swap(_vk_swapchain_frame_buffers);
+		retired._vk_command_buffers.swap(_vk_command_buffers);
+		retired._vk_color_image = _vk_color_image;
+		retired._color_image_allocation = _color_image_allocation;
+		retired._vk_color_image_view = _vk_color_image_view;
+		retired._vk_depth_image = _vk_depth_image;
+		retired._depth_image_allocation = _depth_image_allocation;
+		retired._vk_depth_image_view = _vk_depth_image_view;
+		_retired_swapchains.push_back(std::move(retired));
+
+		VkFormat old_format = _vk_swapchain_format;
+		CreateSwapChain(_available_queue_families, _retired_swapchains.back()._vk_swapchain);
 		CreateImageViews();
-		CreateRenderPass();
-		CreateGraphicsPipeline();
+
+		// the render pass, and the pipelines built against it, only depend on the surface format - practically never changes
+		// when it does they retire with the swapchain, compiles still building against the old pass keep it alive longer
+		if (_vk_swapchain_format != old_format)
+		{
+			RetiredSwapchain& retired_pass = _retired_swapchains.back();
+			retired_pass._vk_render_pass = _vk_render_pass;
+			retired_pass._pipelines = _pipeline_registry.Evict(_vk_render_pass);
+			CreateRenderPass();
+			BindGraphicsPipeline();
+		}
+
+		CreateColorResources();
 		CreateDepthResources();
 		CreateFrameBuffers();
 		CreateCommandBuffers();
 	}
 
+	// frees what earlier rebuilds retired once the gpu has finished every submit that could reference it - a signaled
+	// fence covers all earlier submits on the queue, so the newest serial waited for completes everything before it
+	void DestroyRetiredSwapchains(uint64_t completed_submission)
+	{
+		size_t kept = 0;
+
+		for (size_t i = 0; i < _retired_swapchains.size(); ++i)
+		{
+			RetiredSwapchain& retired = _retired_swapchains[i];
+
+			bool compiling = false;
+			for (PipelineHandle pipeline : retired._pipelines)
+			{
+				compiling = compiling || _pipeline_registry.IsPending(pipeline);
+			}
+
+			if (retired._last_submission > completed_submission || compiling)
+			{
+				if (kept != i)
+				{
+					_retired_swapchains[kept] = std::move(retired);
+				}
+				++kept;
+				continue;
+			}
+
+			vkDestroyImageView(_vk_logical_device, retired._vk_color_image_view, nullptr);
+			vkDestroyImage(_vk_logical_device, retired._vk_color_image, nullptr);
+			_memory_allocator.Free(retired._color_image_allocation);
+
+			vkDestroyImageView(_vk_logical_device, retired._vk_depth_image_view, nullptr);
+			vkDestroyImage(_vk_logical_device, retired._vk_depth_image, nullptr);
+			_memory_allocator.Free(retired._depth_image_allocation);
+
+			for (auto frame_buffer : retired._vk_frame_buffers)
+			{
+				vkDestroyFramebuffer(_vk_logical_device, frame_buffer, nullptr);
+			}
+
+			vkFreeCommandBuffers(_vk_logical_device, _vk_command_pool, static_cast<uint32_t>(retired._vk_command_buffers.size()), retired._vk_command_buffers.data());
+
+			for (auto view : retired._vk_image_views)
+			{
+				vkDestroyImageView(_vk_logical_device, view, nullptr);
+			}
+
+			vkDestroySwapchainKHR(_vk_logical_device, retired._vk_swapchain, nullptr);
+
+			for (PipelineHandle pipeline : retired._pipelines)
+			{
+				_pipeline_registry.Destroy(pipeline);
+			}
+
+			if (retired._vk_render_pass != VK_NULL_HANDLE)
+			{
+				vkDestroyRenderPass(_vk_logical_device, retired._vk_render_pass, nullptr);
+			}
+		}
+
+		_retired_swapchains.resize(kept);
+	}
+
 	void CreateSwapChain(const QueueFamilies& queue_families, VkSwapchainKHR old = VK_NULL_HANDLE)
 	{
 		// get swap chain details
@@ -490,20 +1045,45 @@ private:
 		vkGetSwapchainImagesKHR(_vk_logical_device, _vk_swapchain, &image_count, _vk_swapchain_images.data());
 	}
 
-	void CreateImageViews()
+	// headless stand-in for the swapchain - one device local color image per frame in flight so
+	// CreateImageViews, CreateFrameBuffers and CreateCommandBuffers work on them unchanged
+	void CreateOffscreenImages()
 	{
-		_vk_swapchain_image_views.resize(_vk_swapchain_images.size());
+		_vk_swapchain_format = VK_FORMAT_R8G8B8A8_UNORM;
+		_vk_swapchain_extent = { _window_width, _window_height };
 
-		for (uint32_t i = 0; i < _vk_swapchain_image_views.size(); ++i)
+		_vk_swapchain_images.resize(_settings._frames_in_flight);
+		_offscreen_image_allocations.resize(_settings._frames_in_flight);
+
+		for (size_t i = 0; i < _vk_swapchain_images.size(); ++i)
 		{
-			_vk_swapchain_image_views[i] = CreateImageView(_vk_swapchain_images[i], _vk_swapchain_format, VK_IMAGE_ASPECT_COLOR_BIT);
+			CreateImage(_vk_swapchain_extent.width, _vk_swapchain_extent.height, _vk_swapchain_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_SAMPLE_COUNT_1_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vk_swapchain_images[i], _offscreen_image_allocations[i], true);
 		}
 	}
 
-	void CreateRenderPass()
+	void ReleaseOffscreenImages()
 	{
-		VkAttachmentDescription depth_attachment = {};
-		depth_attachment.format = FindDepthFormat();
+		for (size_t i = 0; i < _vk_swapchain_images.size(); ++i)
+		{
+			vkDestroyImage(_vk_logical_device, _vk_swapchain_images[i], nullptr);
+			_memory_allocator.Free(_offscreen_image_allocations[i]);
+		}
+	}
+
+	void CreateImageViews()
+	{
+		_vk_swapchain_image_views.resize(_vk_swapchain_images.size());
+
+		for (uint32_t i = 0; i < _vk_swapchain_image_views.size(); ++i)
+		{
+			_vk_swapchain_image_views[i] = CreateImageView(_vk_swapchain_images[i], _vk_swapchain_format, VK_IMAGE_ASPECT_COLOR_BIT);
+		}
+	}
+
+	void CreateRenderPass()
+	{
+		VkAttachmentDescription depth_attachment = {};
+		depth_attachment.format = FindDepthFormat();
 		depth_attachment.samples = _vk_sample_count_flag_bits;
 		depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 		depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
@@ -516,53 +1096,74 @@ private:
 		depth_attachment_reference.attachment = 1;
 		depth_attachment_reference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
-		// render pass attachment
+		// multisampled render target - only the resolved result is kept
 		VkAttachmentDescription color_attachment = {};
 		color_attachment.format = _vk_swapchain_format;
 		color_attachment.samples = _vk_sample_count_flag_bits;
 		color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		color_attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 		VkAttachmentReference attachment_reference = {};
 		attachment_reference.attachment = 0;
 		attachment_reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
-		VkAttachmentDescription multisample_attachment = {};
-		multisample_attachment.format = _vk_swapchain_format;
-		multisample_attachment.samples = _vk_sample_count_flag_bits;
-		multisample_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		multisample_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		// single sample swapchain image the multisampled target resolves into
+		VkAttachmentDescription resolve_attachment = {};
+		resolve_attachment.format = _vk_swapchain_format;
+		resolve_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		resolve_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		resolve_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		resolve_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		resolve_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		resolve_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		resolve_attachment.finalLayout = _settings._headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+		VkAttachmentReference resolve_attachment_reference = {};
+		resolve_attachment_reference.attachment = 2;
+		resolve_attachment_reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 		VkSubpassDescription subpass = {};
 		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 		subpass.colorAttachmentCount = 1;
 		subpass.pColorAttachments = &attachment_reference;
-		subpass.pResolveAttachments = ;
+		subpass.pResolveAttachments = &resolve_attachment_reference;
 		subpass.pDepthStencilAttachment = &depth_attachment_reference;
 		
-		VkSubpassDependency subpass_dependency = {};
+		std::array<VkSubpassDependency, 2> subpass_dependencies = {};
+
+		VkSubpassDependency& subpass_dependency = subpass_dependencies[0];
 		subpass_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
 		subpass_dependency.dstSubpass = 0;
-		subpass_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		subpass_dependency.srcAccessMask = 0;
-		subpass_dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		subpass_dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-		std::array<VkAttachmentDescription, 2> attachments = { color_attachment, depth_attachment };
+		// the depth attachment starts UNDEFINED every pass, so it only needs ordering against the previous frame's depth writes
+		subpass_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		subpass_dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		subpass_dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		subpass_dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		// headless readback copies the resolved image right after the pass, in the same command buffer
+		VkSubpassDependency& readback_dependency = subpass_dependencies[1];
+		readback_dependency.srcSubpass = 0;
+		readback_dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+		readback_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		readback_dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		readback_dependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		readback_dependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		std::array<VkAttachmentDescription, 3> attachments = { color_attachment, depth_attachment, resolve_attachment };
 
 		// create render pass
 		VkRenderPassCreateInfo create_info = {};
 		create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-		create_info.attachmentCount = attachments.size();
+		create_info.attachmentCount = static_cast<uint32_t>(attachments.size());
 		create_info.pAttachments = attachments.data();
 		create_info.subpassCount = 1;
 		create_info.pSubpasses = &subpass;
-		create_info.dependencyCount = 1;
-		create_info.pDependencies = &subpass_dependency;
+		create_info.dependencyCount = _settings._headless ? 2 : 1;
+		create_info.pDependencies = subpass_dependencies.data();
 
 		if (vkCreateRenderPass(_vk_logical_device, &create_info, nullptr, &_vk_render_pass) != VK_SUCCESS)
 		{
@@ -574,18 +1175,29 @@ private:
 	{
 		VkDescriptorSetLayoutBinding ubo_layout_binding = {};
 		ubo_layout_binding.binding = 0;
-		ubo_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		ubo_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		ubo_layout_binding.descriptorCount = 1;
 		ubo_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
-		VkDescriptorSetLayoutBinding combined_image_sampler_binding = {};
-		combined_image_sampler_binding.binding = 1;
-		combined_image_sampler_binding.descriptorCount = 1;
-		combined_image_sampler_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		combined_image_sampler_binding.pImmutableSamplers = nullptr;
-		combined_image_sampler_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		VkDescriptorSetLayoutBinding instance_binding = {};
+		instance_binding.binding = 1;
+		instance_binding.descriptorCount = 1;
+		instance_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		instance_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
-		std::array<VkDescriptorSetLayoutBinding, 2> bindings = { ubo_layout_binding, combined_image_sampler_binding };
+		VkDescriptorSetLayoutBinding instance_index_binding = {};
+		instance_index_binding.binding = 2;
+		instance_index_binding.descriptorCount = 1;
+		instance_index_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		instance_index_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+		VkDescriptorSetLayoutBinding transform_binding = {};
+		transform_binding.binding = 3;
+		transform_binding.descriptorCount = 1;
+		transform_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		transform_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+		std::array<VkDescriptorSetLayoutBinding, 4> bindings = { ubo_layout_binding, instance_binding, instance_index_binding, transform_binding };
 
 		VkDescriptorSetLayoutCreateInfo create_info = {};
 		create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -596,16 +1208,111 @@ private:
 		{
 			throw std::runtime_error("Failed To Create Descriptor Set Layout!");
 		}
+
+		// set 1 - the textures, one table set per frame in flight
+		_texture_table.Initialize(_vk_logical_device, _texture_table_capacity, _settings._frames_in_flight, _descriptor_indexing);
 	}
 
 	void CreateGraphicsPipeline()
 	{
-		// shader blob acquisition
-		auto vert_blob = ReadFile("Shaders/vert.spv");
-		auto frag_blob = ReadFile("Shaders/frag.spv");
+		VkDescriptorSetLayout set_layouts[] = { _vk_descriptor_set_layout, _texture_table.Layout() };
+
+		VkPushConstantRange push_constant_range = {};
+		push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		push_constant_range.offset = 0;
+		push_constant_range.size = sizeof(DrawConstants);
+
+		VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
+		pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_create_info.setLayoutCount = 2;
+		pipeline_layout_create_info.pSetLayouts = set_layouts;
+		pipeline_layout_create_info.pushConstantRangeCount = 1;
+		pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+		
+		if (vkCreatePipelineLayout(_vk_logical_device, &pipeline_layout_create_info, nullptr, &_vk_pipeline_layout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Pipeline Layout!");
+		}
+
+		// shader blob acquisition - the color variant is compiled with VERTEX_COLOR defined, the non uniform one with
+		// NON_UNIFORM_INDEXING
+		LoadShader(_vertex_layout.HasColor() ? "vert_color.spv" : "vert.spv");
+		LoadShader(FragmentShaderName());
+
+		BindGraphicsPipeline();
+	}
+
+	// requests the current graphics variant and waits for it - at startup and after a render pass change there is
+	// nothing to draw with in the meantime
+	void BindGraphicsPipeline()
+	{
+		// pipeline cache - warm from the last run's file, and from the first creation on every surface format change
+		auto start_time = std::chrono::high_resolution_clock::now();
+
+		_graphics_pipeline._requested = _pipeline_registry.Request(GraphicsPipelineState(), _vk_render_pass);
+		_graphics_pipeline._bound = _graphics_pipeline._requested;
+		_vk_pipeline = _pipeline_registry.Wait(_graphics_pipeline._bound);
+
+		auto end_time = std::chrono::high_resolution_clock::now();
+		_statistics._pipeline_creation_seconds.push_back(std::chrono::duration<double, std::chrono::seconds::period>(end_time - start_time).count());
+	}
+
+	// reads Shaders/name into the registry, pipeline states refer to it by content hash
+	void LoadShader(const std::string& name)
+	{
+		_shader_hashes[name] = _pipeline_registry.AddShader(ReadFile("Shaders/" + name));
+	}
+
+	// the draw pipeline as the settings currently ask for it
+	PipelineState GraphicsPipelineState()
+	{
+		VkVertexInputBindingDescription vertex_binding_description = _vertex_layout.GetBindingDescription();
+		std::vector<VkVertexInputAttributeDescription> vertex_attribute_descriptions = _vertex_layout.GetAttributeDescriptions();
+
+		// what render pass compatibility depends on
+		VkFormat render_pass_formats[] = { _vk_swapchain_format, FindDepthFormat() };
+
+		PipelineState state;
+		state._vertex_shader = _shader_hashes.at(_vertex_layout.HasColor() ? "vert_color.spv" : "vert.spv");
+		state._fragment_shader = _shader_hashes.at(FragmentShaderName());
+		state._vertex_layout = Hash::Bytes(vertex_attribute_descriptions.data(), vertex_attribute_descriptions.size() * sizeof(VkVertexInputAttributeDescription),
+			Hash::Value(vertex_binding_description));
+		state._render_pass = Hash::Bytes(render_pass_formats, sizeof(render_pass_formats), Hash::Value(_vk_sample_count_flag_bits));
+		state._layout = GRAPHICS_PIPELINE_LAYOUT;
+		state._sample_count = _vk_sample_count_flag_bits;
+		state._polygon_mode = static_cast<uint8_t>(_wireframe ? VK_POLYGON_MODE_LINE : VK_POLYGON_MODE_FILL);
+		// both faces of the wires, back faces would leave the far side of closed meshes out
+		state._cull_mode = static_cast<uint8_t>(_wireframe ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT);
+
+		return state;
+	}
+
+	// instances of one draw may sample different textures only with descriptor indexing
+	const char* FragmentShaderName() const
+	{
+		return _descriptor_indexing ? "frag_nonuniform.spv" : "frag.spv";
+	}
+
+	PipelineState CullPipelineState() const
+	{
+		PipelineState state;
+		state._compute_shader = _shader_hashes.at("cull.spv");
+		state._layout = CULL_PIPELINE_LAYOUT;
+
+		return state;
+	}
+
+	// the registry's factory, runs on its compile workers - only reads state that stays fixed while anything compiles,
+	// the render pass comes from the request since a surface format change replaces it while variants still compile
+	VkPipeline BuildPipeline(const PipelineState& state, VkRenderPass render_pass)
+	{
+		return state._compute_shader != 0 ? BuildCullPipeline(state) : BuildGraphicsPipeline(state, render_pass);
+	}
 
-		VkShaderModule vertex_shader_module = CreateShaderModule(vert_blob);
-		VkShaderModule fragment_shader_module = CreateShaderModule(frag_blob);
+	VkPipeline BuildGraphicsPipeline(const PipelineState& state, VkRenderPass render_pass)
+	{
+		VkShaderModule vertex_shader_module = _pipeline_registry.Shader(state._vertex_shader);
+		VkShaderModule fragment_shader_module = _pipeline_registry.Shader(state._fragment_shader);
 
 		// create vertex shader info
 		VkPipelineShaderStageCreateInfo vertex_stage_create_info = {};
@@ -613,21 +1320,50 @@ private:
 		vertex_stage_create_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
 		vertex_stage_create_info.module = vertex_shader_module;
 		vertex_stage_create_info.pName = "main";
-		// optional ability to add shader constants to stage
-		//vertex_stage_create_info.pSpecializationInfo = nullptr;
+
+		// the cpu transforms switch picks the vertex shader's mvp source, the other branch is compiled out
+		VkBool32 cpu_transforms = _settings._cpu_transforms ? VK_TRUE : VK_FALSE;
+
+		VkSpecializationMapEntry vertex_specialization_entry = {};
+		vertex_specialization_entry.constantID = 0;
+		vertex_specialization_entry.offset = 0;
+		vertex_specialization_entry.size = sizeof(VkBool32);
+
+		VkSpecializationInfo vertex_specialization_info = {};
+		vertex_specialization_info.mapEntryCount = 1;
+		vertex_specialization_info.pMapEntries = &vertex_specialization_entry;
+		vertex_specialization_info.dataSize = sizeof(VkBool32);
+		vertex_specialization_info.pData = &cpu_transforms;
+
+		vertex_stage_create_info.pSpecializationInfo = &vertex_specialization_info;
 
 		// fragment shader info
+		// the texture array is sized by a specialization constant, the capacity is fixed at device creation
+		uint32_t texture_table_capacity = _texture_table.Capacity();
+
+		VkSpecializationMapEntry specialization_entry = {};
+		specialization_entry.constantID = 0;
+		specialization_entry.offset = 0;
+		specialization_entry.size = sizeof(uint32_t);
+
+		VkSpecializationInfo specialization_info = {};
+		specialization_info.mapEntryCount = 1;
+		specialization_info.pMapEntries = &specialization_entry;
+		specialization_info.dataSize = sizeof(uint32_t);
+		specialization_info.pData = &texture_table_capacity;
+
 		VkPipelineShaderStageCreateInfo fragment_stage_create_info = {};
 		fragment_stage_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		fragment_stage_create_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 		fragment_stage_create_info.module = fragment_shader_module;
 		fragment_stage_create_info.pName = "main";
+		fragment_stage_create_info.pSpecializationInfo = &specialization_info;
 
 		VkPipelineShaderStageCreateInfo shader_stages[] = { vertex_stage_create_info, fragment_stage_create_info };
 
 		// vertex binding data
-		auto vertex_binding_description = Vertex::GetBindingDescription();
-		auto vertex_attribute_descriptions = Vertex::GetAttributeDescriptions();
+		auto vertex_binding_description = _vertex_layout.GetBindingDescription();
+		auto vertex_attribute_descriptions = _vertex_layout.GetAttributeDescriptions();
 
 		// vertex stage
 		VkPipelineVertexInputStateCreateInfo vertex_input_create_info = {};
@@ -640,45 +1376,31 @@ private:
 		// Input assembly
 		VkPipelineInputAssemblyStateCreateInfo input_assembly_create_info = {};
 		input_assembly_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-		input_assembly_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		input_assembly_create_info.topology = static_cast<VkPrimitiveTopology>(state._topology);
 		input_assembly_create_info.primitiveRestartEnable = VK_FALSE;
 		
-		// pipeline viewport with vieport and scissor rectangle
-		VkViewport viewport = {};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(_vk_swapchain_extent.width);
-		viewport.height = static_cast<float>(_vk_swapchain_extent.height);
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-
-		VkRect2D scissor_rect = {};
-		scissor_rect.offset = { 0, 0 };
-		scissor_rect.extent = _vk_swapchain_extent;
-
+		// viewport and scissor are dynamic, set from the current extent while recording - the pipeline outlives resizes
 		VkPipelineViewportStateCreateInfo viewport_state_create_info = {};
 		viewport_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 		viewport_state_create_info.viewportCount = 1;
-		viewport_state_create_info.pViewports = &viewport;
 		viewport_state_create_info.scissorCount = 1;
-		viewport_state_create_info.pScissors = &scissor_rect;
 
 		// rasterizer
 		VkPipelineRasterizationStateCreateInfo rasterizer_create_info = {};
 		rasterizer_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
 		rasterizer_create_info.depthClampEnable = VK_FALSE;
 		rasterizer_create_info.rasterizerDiscardEnable = VK_FALSE;
-		rasterizer_create_info.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizer_create_info.polygonMode = static_cast<VkPolygonMode>(state._polygon_mode);
 		rasterizer_create_info.lineWidth = 1.0f;
-		rasterizer_create_info.cullMode = VK_CULL_MODE_BACK_BIT;
-		rasterizer_create_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		rasterizer_create_info.cullMode = static_cast<VkCullModeFlags>(state._cull_mode);
+		rasterizer_create_info.frontFace = static_cast<VkFrontFace>(state._front_face);
 		rasterizer_create_info.depthBiasEnable = VK_FALSE;
 
 		// multisampling
 		VkPipelineMultisampleStateCreateInfo multisampling = {};
 		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
 		multisampling.sampleShadingEnable = VK_TRUE;
-		multisampling.rasterizationSamples = _vk_sample_count_flag_bits;
+		multisampling.rasterizationSamples = static_cast<VkSampleCountFlagBits>(state._sample_count);
 		multisampling.minSampleShading = 0.25f;
 		
 		// depth stencil test
@@ -686,7 +1408,13 @@ private:
 		// color blending
 		VkPipelineColorBlendAttachmentState color_blend_attachment = {};
 		color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_R_BIT;
-		color_blend_attachment.blendEnable = VK_FALSE;
+		color_blend_attachment.blendEnable = state._blend_mode != static_cast<uint8_t>(BlendMode::Opaque) ? VK_TRUE : VK_FALSE;
+		color_blend_attachment.srcColorBlendFactor = state._blend_mode == static_cast<uint8_t>(BlendMode::Alpha) ? VK_BLEND_FACTOR_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+		color_blend_attachment.dstColorBlendFactor = state._blend_mode == static_cast<uint8_t>(BlendMode::Alpha) ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+		color_blend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
+		color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		color_blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
 		VkPipelineColorBlendStateCreateInfo color_blend_create_info = {};
 		color_blend_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -696,31 +1424,20 @@ private:
 
 		VkPipelineDepthStencilStateCreateInfo depth_stencil_create_info = {};
 		depth_stencil_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-		depth_stencil_create_info.depthTestEnable = VK_TRUE;
-		depth_stencil_create_info.depthWriteEnable = VK_TRUE;
-		depth_stencil_create_info.depthCompareOp = VK_COMPARE_OP_LESS;
+		depth_stencil_create_info.depthTestEnable = state._depth_test ? VK_TRUE : VK_FALSE;
+		depth_stencil_create_info.depthWriteEnable = state._depth_write ? VK_TRUE : VK_FALSE;
+		depth_stencil_create_info.depthCompareOp = static_cast<VkCompareOp>(state._depth_compare);
 		depth_stencil_create_info.depthBoundsTestEnable = VK_FALSE;
 		depth_stencil_create_info.stencilTestEnable = VK_FALSE;
 		
 		// dynamic state
-		VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR, VK_DYNAMIC_STATE_LINE_WIDTH };
+		VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
 		
 		VkPipelineDynamicStateCreateInfo dynamic_state_create_info = {};
 		dynamic_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-		dynamic_state_create_info.dynamicStateCount = 2;
+		dynamic_state_create_info.dynamicStateCount = static_cast<uint32_t>(sizeof(dynamic_states) / sizeof(dynamic_states[0]));
 		dynamic_state_create_info.pDynamicStates = dynamic_states;
 
-		// pipeline layout
-		VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
-		pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipeline_layout_create_info.setLayoutCount = 1;
-		pipeline_layout_create_info.pSetLayouts = &_vk_descriptor_set_layout;
-		
-		if (vkCreatePipelineLayout(_vk_logical_device, &pipeline_layout_create_info, nullptr, &_vk_pipeline_layout) != VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed To Create Pipeline Layout!");
-		}
-
 		// create graphics pipeline
 		VkGraphicsPipelineCreateInfo create_info = {};
 		create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -733,21 +1450,94 @@ private:
 		create_info.pMultisampleState = &multisampling;
 		create_info.pDepthStencilState = &depth_stencil_create_info;
 		create_info.pColorBlendState = &color_blend_create_info;
-		create_info.pDynamicState = nullptr;
+		create_info.pDynamicState = &dynamic_state_create_info;
 		create_info.layout = _vk_pipeline_layout;
-		create_info.renderPass = _vk_render_pass;
+		create_info.renderPass = render_pass;
 		create_info.subpass = 0;
 
-		// pipeline cache - data saved for fast pipeline creation later and from file
+		VkPipeline pipeline;
 
-		if (vkCreateGraphicsPipelines(_vk_logical_device, VK_NULL_HANDLE, 1, &create_info, nullptr, &_vk_pipeline) != VK_SUCCESS)
+		if (vkCreateGraphicsPipelines(_vk_logical_device, _pipeline_cache.Handle(), 1, &create_info, nullptr, &pipeline) != VK_SUCCESS)
 		{
 			throw std::runtime_error("Failed To Create Graphics Pipeline!");
 		}
 
-		// clean up VK resources
-		vkDestroyShaderModule(_vk_logical_device, vertex_shader_module, nullptr);
-		vkDestroyShaderModule(_vk_logical_device, fragment_shader_module, nullptr);
+		return pipeline;
+	}
+
+	// the compute pass of gpu culling - independent of the swapchain, so it survives recreation
+	void CreateCullPipeline()
+	{
+		if (_settings._culling != CullingMode::Gpu)
+		{
+			return;
+		}
+
+		// ubo, instances, submesh bounds, indirect commands, visible instance indices
+		std::array<VkDescriptorSetLayoutBinding, 5> bindings = {};
+		for (uint32_t i = 0; i < bindings.size(); ++i)
+		{
+			bindings[i].binding = i;
+			bindings[i].descriptorCount = 1;
+			bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo set_layout_create_info = {};
+		set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		set_layout_create_info.bindingCount = static_cast<uint32_t>(bindings.size());
+		set_layout_create_info.pBindings = bindings.data();
+
+		if (vkCreateDescriptorSetLayout(_vk_logical_device, &set_layout_create_info, nullptr, &_vk_cull_descriptor_set_layout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Cull Descriptor Set Layout!");
+		}
+
+		// instance count and object count
+		VkPushConstantRange push_constant_range = {};
+		push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		push_constant_range.offset = 0;
+		push_constant_range.size = 2 * sizeof(uint32_t);
+
+		VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
+		pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_create_info.setLayoutCount = 1;
+		pipeline_layout_create_info.pSetLayouts = &_vk_cull_descriptor_set_layout;
+		pipeline_layout_create_info.pushConstantRangeCount = 1;
+		pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+
+		if (vkCreatePipelineLayout(_vk_logical_device, &pipeline_layout_create_info, nullptr, &_vk_cull_pipeline_layout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Cull Pipeline Layout!");
+		}
+
+		LoadShader("cull.spv");
+
+		_cull_pipeline._requested = _pipeline_registry.Request(CullPipelineState());
+		_cull_pipeline._bound = _cull_pipeline._requested;
+		_vk_cull_pipeline = _pipeline_registry.Wait(_cull_pipeline._bound);
+	}
+
+	VkPipeline BuildCullPipeline(const PipelineState& state)
+	{
+		VkShaderModule compute_shader_module = _pipeline_registry.Shader(state._compute_shader);
+
+		VkComputePipelineCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		create_info.stage.module = compute_shader_module;
+		create_info.stage.pName = "main";
+		create_info.layout = _vk_cull_pipeline_layout;
+
+		VkPipeline pipeline;
+
+		if (vkCreateComputePipelines(_vk_logical_device, _pipeline_cache.Handle(), 1, &create_info, nullptr, &pipeline) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Cull Pipeline!");
+		}
+
+		return pipeline;
 	}
 
 	VkFormat FindDepthFormat()
@@ -760,23 +1550,28 @@ private:
 		return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 	}
 
+	void CreateColorResources()
+	{
+		CreateImage(_vk_swapchain_extent.width, _vk_swapchain_extent.height, _vk_swapchain_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, _vk_sample_count_flag_bits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vk_color_image, _color_image_allocation, true);
+		_vk_color_image_view = CreateImageView(_vk_color_image, _vk_swapchain_format, VK_IMAGE_ASPECT_COLOR_BIT);
+	}
+
 	void CreateDepthResources()
 	{
 		VkFormat depth_format = FindDepthFormat();
-		CreateImage(_vk_swapchain_extent.width, _vk_swapchain_extent.height, depth_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_SAMPLE_COUNT_1_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vk_depth_image, _vk_depth_image_memory);
+		CreateImage(_vk_swapchain_extent.width, _vk_swapchain_extent.height, depth_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, _vk_sample_count_flag_bits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vk_depth_image, _depth_image_allocation, true);
 		_vk_depth_image_view = CreateImageView(_vk_depth_image, depth_format, VK_IMAGE_ASPECT_DEPTH_BIT);
-		TransitionImageLayout(_vk_depth_image, depth_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
 	}
 
 	void CreateFrameBuffers()
 	{
 		_vk_swapchain_frame_buffers.resize(_vk_swapchain_image_views.size());
 
-		std::array<VkImageView, 2> attachments = { _vk_swapchain_image_views[0], _vk_depth_image_view };
+		std::array<VkImageView, 3> attachments = { _vk_color_image_view, _vk_depth_image_view, _vk_swapchain_image_views[0] };
 
 		for (size_t i = 0; i < _vk_swapchain_image_views.size(); ++i)
 		{
-			attachments[0] = _vk_swapchain_image_views[i];
+			attachments[2] = _vk_swapchain_image_views[i];
 
 			VkFramebufferCreateInfo create_info = {};
 			create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -799,6 +1594,8 @@ private:
 	{
 		VkCommandPoolCreateInfo create_info = {};
 		create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		// frame command buffers are re-recorded one frame slot at a time when a texture streams in
+		create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 		create_info.queueFamilyIndex = queue_families._graphics_family;
 
 		if (vkCreateCommandPool(_vk_logical_device, &create_info, nullptr, &_vk_command_pool) != VK_SUCCESS)
@@ -807,1057 +1604,3409 @@ private:
 		}
 	}
 	
+	// block compressed when the device samples one of the requested formats, RGBA8 otherwise
+	// the file is decoded on the streamer's workers, the placeholder is bound until it is resident
 	void CreateTextureImage()
 	{
-		int texture_width, texture_height, texture_channels;
-
-		stbi_uc* pixels = stbi_load("Textures/body.tga", &texture_width, &texture_height, &texture_channels, STBI_rgb_alpha);
-
-		VkDeviceSize image_size = texture_width * texture_height * 4;
+		// linear filtered RGBA8 sampling is mandatory, so the search always ends there
+		const VkFormatFeatureFlags SAMPLE_FEATURES = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+		_texture_format = FindSupportedFormat(TextureFormatCandidates(), VK_IMAGE_TILING_OPTIMAL, SAMPLE_FEATURES);
 
-		if (!pixels)
-		{
-			throw std::runtime_error("Failed To Load Image File!");
-		}
+		// the blit cascade needs linear filtered blits in both directions, otherwise the chain is built on the cpu
+		VkFormatProperties format_properties;
+		vkGetPhysicalDeviceFormatProperties(_vk_physical_device, VK_FORMAT_R8G8B8A8_UNORM, &format_properties);
 
-		VkBuffer staging_buffer;
-		VkDeviceMemory staging_buffer_memory;
+		const VkFormatFeatureFlags BLIT_FEATURES = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+		_gpu_texture_mips = !_settings._cpu_mip_generation && (format_properties.optimalTilingFeatures & BLIT_FEATURES) == BLIT_FEATURES;
 
-		CreateBuffer(image_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, staging_buffer, staging_buffer_memory);
+		uint32_t decode_threads = std::max(1u, std::thread::hardware_concurrency() / 2);
 
-		void* data;
-		vkMapMemory(_vk_logical_device, staging_buffer_memory, 0, image_size, 0, &data);
-		memcpy(data, pixels, static_cast<size_t>(image_size));
-		vkUnmapMemory(_vk_logical_device, staging_buffer_memory);
-
-		stbi_image_free(pixels);
+		_texture_streamer.Initialize(_vk_logical_device, _memory_allocator, _upload_manager, [this](const std::string& path, DecodedTexture& decoded, const TextureStager& stage)
+		{
+			DecodeTexture(path, decoded, stage);
+		}, decode_threads, TEXTURE_STAGING_SIZE);
 
-		CreateImage(texture_width, texture_height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_SAMPLE_COUNT_1_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vk_texture_image, _vk_texture_image_memory);
+		_texture = _texture_streamer.Request("Textures/body.tga");
+		_texture_slot = _texture_table.Add();
+	}
 
-		TransitionImageLayout(_vk_texture_image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	// the requested format first, then the weaker block formats, then RGBA8
+	std::vector<VkFormat> TextureFormatCandidates() const
+	{
+		std::vector<VkFormat> candidates;
 
-		CopyBufferToImage(staging_buffer, _vk_texture_image, static_cast<uint32_t>(texture_width), static_cast<uint32_t>(texture_height));
+		if (_texture_compression_bc)
+		{
+			const std::string& compression = _settings._texture_compression;
 
-		TransitionImageLayout(_vk_texture_image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			if (compression == "bc7")
+			{
+				candidates.push_back(VK_FORMAT_BC7_UNORM_BLOCK);
+			}
+			if (compression == "bc7" || compression == "bc3")
+			{
+				candidates.push_back(VK_FORMAT_BC3_UNORM_BLOCK);
+			}
+			if (compression == "bc7" || compression == "bc3" || compression == "bc1")
+			{
+				candidates.push_back(VK_FORMAT_BC1_RGB_UNORM_BLOCK);
+			}
+		}
 
-		vkDestroyBuffer(_vk_logical_device, staging_buffer, nullptr);
-		vkFreeMemory(_vk_logical_device, staging_buffer_memory, nullptr);
+		candidates.push_back(VK_FORMAT_R8G8B8A8_UNORM);
+		return candidates;
 	}
 
-	void CreateTextureImageView()
+	static BlockFormat ToBlockFormat(VkFormat format)
 	{
-		_vk_texture_image_view = CreateImageView(_vk_texture_image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+		switch (format)
+		{
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK: return BlockFormat::BC1;
+		case VK_FORMAT_BC3_UNORM_BLOCK: return BlockFormat::BC3;
+		default: return BlockFormat::BC7;
+		}
 	}
 
-	void CreateTextureSampler()
+	// decode worker - only reads state that is fixed before the first Request
+	void DecodeTexture(const std::string& source_path, DecodedTexture& decoded, const TextureStager& stage)
 	{
-		VkSamplerCreateInfo create_info = {};
-		create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-		create_info.magFilter = VK_FILTER_LINEAR;
-		create_info.minFilter = VK_FILTER_LINEAR;
-		create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		create_info.anisotropyEnable = VK_TRUE;
-		create_info.maxAnisotropy = 16;
-		create_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-		create_info.unnormalizedCoordinates = VK_FALSE;
-		create_info.compareEnable = VK_FALSE;
-		create_info.compareOp = VK_COMPARE_OP_ALWAYS;
-		create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-		create_info.mipLodBias = 0.0f;
-		create_info.minLod = 0.0f;
-		create_info.maxLod = 0.0f;
+		decoded._format = _texture_format;
 
-		if (vkCreateSampler(_vk_logical_device, &create_info, nullptr, &_vk_texture_sampler) != VK_SUCCESS)
+		if (_texture_format == VK_FORMAT_R8G8B8A8_UNORM)
 		{
-			throw std::runtime_error("Failed To Create Texture Sampler!");
+			DecodeUncompressedTexture(source_path, decoded, stage);
+		}
+		else
+		{
+			DecodeCompressedTexture(source_path, decoded, stage);
 		}
 	}
 
-	void CreateVertexBuffer()
+	// maps the cooked texture when it matches the source, otherwise decodes and compresses every level and writes a new one
+	void DecodeCompressedTexture(const std::string& source_path, DecodedTexture& decoded, const TextureStager& stage)
 	{
-		VkDeviceSize buffer_size = sizeof(_vertices[0]) * _vertices.size();
+		static const char* const FORMAT_NAMES[] = { "bc1", "bc3", "bc7" };
 
-		VkBuffer staging_buffer;
-		VkDeviceMemory staging_buffer_memory;
+		BlockFormat block_format = ToBlockFormat(_texture_format);
+		const std::string cooked_path = source_path + "." + FORMAT_NAMES[static_cast<uint32_t>(block_format)] + ".cooked";
 
-		CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer, staging_buffer_memory);
-		
-		void* data;
-		vkMapMemory(_vk_logical_device, staging_buffer_memory, 0, buffer_size, 0, &data);
-		memcpy(data, _vertices.data(), static_cast<size_t>(buffer_size));
-		vkUnmapMemory(_vk_logical_device, staging_buffer_memory);
-
-		CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vk_vertex_buffer, _vk_vertex_buffer_memory);
-
-		CopyBuffer(staging_buffer, _vk_vertex_buffer, buffer_size);
+		SourceFile source;
+		if (!source.Open(source_path))
+		{
+			throw std::runtime_error("Failed To Load Image File!");
+		}
 
-		vkDestroyBuffer(_vk_logical_device, staging_buffer, nullptr);
-		vkFreeMemory(_vk_logical_device, staging_buffer_memory, nullptr);
-	}
+		CookedTexture cooked_texture;
 
-	void CreateIndexBuffer()
-	{
-		VkDeviceSize buffer_size = sizeof(_indices[0]) * _indices.size();
-		VkBuffer staging_buffer;
-		VkDeviceMemory staging_buffer_memory;
-		CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer, staging_buffer_memory);
+		if (cooked_texture.Open(cooked_path, source, _texture_format))
+		{
+			const CookedTextureHeader& header = cooked_texture.Header();
+			decoded._width = header._width;
+			decoded._height = header._height;
+			decoded._mip_levels = header._level_count;
+			decoded._levels.assign(cooked_texture.Levels(), cooked_texture.Levels() + header._level_count);
 
-		void* data;
-		vkMapMemory(_vk_logical_device, staging_buffer_memory, 0, buffer_size, 0, &data);
-		memcpy(data, _indices.data(), static_cast<size_t>(buffer_size));
-		vkUnmapMemory(_vk_logical_device, staging_buffer_memory);
+			memcpy(stage(header._data_size), cooked_texture.Data(), static_cast<size_t>(header._data_size));
+			return;
+		}
 
-		CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vk_index_buffer, _vk_index_buffer_memory);
+		std::vector<uint8_t> blocks;
+		CookTexture(source_path, block_format, decoded._width, decoded._height, decoded._levels, blocks);
+		decoded._mip_levels = static_cast<uint32_t>(decoded._levels.size());
 
-		CopyBuffer(staging_buffer, _vk_index_buffer, buffer_size);
+		// a read only asset directory only costs the next startup another compression
+		if (!CookedTexture::Write(cooked_path, source, _texture_format, decoded._width, decoded._height, decoded._levels.data(), decoded._mip_levels, blocks.data(), blocks.size()))
+		{
+			std::cerr << "Failed to write cooked texture " << cooked_path << std::endl;
+		}
 
-		vkDestroyBuffer(_vk_logical_device, staging_buffer, nullptr);
-		vkFreeMemory(_vk_logical_device, staging_buffer_memory, nullptr);
+		memcpy(stage(blocks.size()), blocks.data(), blocks.size());
 	}
 
-	void CreateUniformBuffer()
+	// cpu mip chain of the decoded image, every level compressed across the thread pool
+	void CookTexture(const std::string& source_path, BlockFormat block_format, uint32_t& width, uint32_t& height, std::vector<ImageLevel>& levels, std::vector<uint8_t>& blocks)
 	{
-		VkDeviceSize buffer_size = sizeof(UniformBufferObject);
-		CreateBuffer(buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _vk_uniform_buffer, _vk_uniform_buffer_memory);
+		auto start = std::chrono::high_resolution_clock::now();
 
-	}
+		int texture_width, texture_height, texture_channels;
+		stbi_uc* pixels = stbi_load(source_path.c_str(), &texture_width, &texture_height, &texture_channels, STBI_rgb_alpha);
 
-	void CreateDescriptorPool()
-	{
-		std::array<VkDescriptorPoolSize, 2> pool_sizes = {};
+		if (!pixels)
+		{
+			throw std::runtime_error("Failed To Load Image File!");
+		}
 
-		pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		pool_sizes[0].descriptorCount = 1;
+		width = static_cast<uint32_t>(texture_width);
+		height = static_cast<uint32_t>(texture_height);
 
-		pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		pool_sizes[1].descriptorCount = 1;
-		
-		VkDescriptorPoolCreateInfo create_info = {};
-		create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		create_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
-		create_info.pPoolSizes = pool_sizes.data();
-		create_info.maxSets = 1;
+		std::vector<ImageLevel> texel_levels;
+		std::vector<uint8_t> mip_chain = MipChain::Build(pixels, width, height, texel_levels);
+		stbi_image_free(pixels);
+
+		levels.resize(texel_levels.size());
 
-		if (vkCreateDescriptorPool(_vk_logical_device, &create_info, nullptr, &_vk_descriptor_pool) != VK_SUCCESS)
+		uint64_t total_size = 0;
+		for (size_t level = 0; level < levels.size(); ++level)
 		{
-			throw std::runtime_error("Failed To Create Descriptor Pool!");
+			levels[level]._width = texel_levels[level]._width;
+			levels[level]._height = texel_levels[level]._height;
+			levels[level]._offset = total_size;
+			levels[level]._size = BlockCompressor::ImageBytes(block_format, levels[level]._width, levels[level]._height);
+
+			// blocks are 8 or 16 bytes, 16 byte aligned levels keep every copy offset legal
+			total_size += (levels[level]._size + 15) / 16 * 16;
 		}
-	}
 
-	void CreateDescriptorSet()
-	{
-		VkDescriptorSetLayout layouts[] = { _vk_descriptor_set_layout };
-		VkDescriptorSetAllocateInfo alloc_info = {};
-		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		alloc_info.descriptorPool = _vk_descriptor_pool;
-		alloc_info.descriptorSetCount = 1;
-		alloc_info.pSetLayouts = layouts;
+		blocks.assign(static_cast<size_t>(total_size), 0);
 
-		if (vkAllocateDescriptorSets(_vk_logical_device, &alloc_info, &_vk_descriptor_set) != VK_SUCCESS)
+		// decode workers are not pool tasks, so they may spread the blocks over the shared pool
+		for (size_t level = 0; level < levels.size(); ++level)
 		{
-			throw std::runtime_error("Failed To Allocate Descriptor Set!");
+			BlockCompressor::CompressImage(block_format, mip_chain.data() + texel_levels[level]._offset, levels[level]._width, levels[level]._height,
+				blocks.data() + levels[level]._offset, _thread_pool);
 		}
 
-		VkDescriptorBufferInfo buffer_info = {};
-		buffer_info.buffer = _vk_uniform_buffer;
-		buffer_info.offset = 0;
-		buffer_info.range = sizeof(UniformBufferObject);
-
-		VkDescriptorImageInfo image_info = {};
-		image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		image_info.imageView = _vk_texture_image_view;
-		image_info.sampler = _vk_texture_sampler;
+		double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
 
-		std::array<VkWriteDescriptorSet, 2> write_descriptors = {};
-
-		write_descriptors[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		write_descriptors[0].dstSet = _vk_descriptor_set;
-		write_descriptors[0].dstBinding = 0;
-		write_descriptors[0].dstArrayElement = 0;
-		write_descriptors[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		write_descriptors[0].descriptorCount = 1;
-		write_descriptors[0].pBufferInfo = &buffer_info;
-
-		write_descriptors[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		write_descriptors[1].dstSet = _vk_descriptor_set;
-		write_descriptors[1].dstBinding = 1;
-		write_descriptors[1].dstArrayElement = 0;
-		write_descriptors[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		write_descriptors[1].descriptorCount = 1;
-		write_descriptors[1].pImageInfo = &image_info;
-
-		vkUpdateDescriptorSets(_vk_logical_device, static_cast<uint32_t>(write_descriptors.size()), write_descriptors.data(), 0, nullptr);
+		std::cout << "cooked " << source_path << " | " << levels.size() << " levels | " << mip_chain.size() << " -> " << blocks.size()
+			<< " bytes | " << seconds * 1000.0 << " ms" << std::endl;
 	}
 
-	void CreateCommandBuffers()
+	// stb_image always allocates its own output, so the decoded texels take exactly one copy into staging
+	void DecodeUncompressedTexture(const std::string& source_path, DecodedTexture& decoded, const TextureStager& stage)
 	{
-		_vk_command_buffers.resize(_vk_swapchain_frame_buffers.size());
+		int texture_width, texture_height, texture_channels;
 
-		VkCommandBufferAllocateInfo alloc_info = {};
-		alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		alloc_info.commandPool = _vk_command_pool;
-		alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		alloc_info.commandBufferCount = static_cast<uint32_t>(_vk_command_buffers.size());
+		stbi_uc* pixels = stbi_load(source_path.c_str(), &texture_width, &texture_height, &texture_channels, STBI_rgb_alpha);
 
-		if (vkAllocateCommandBuffers(_vk_logical_device, &alloc_info, _vk_command_buffers.data()) != VK_SUCCESS)
+		if (!pixels)
 		{
-			throw std::runtime_error("Failed To Allocate Command Buffers!");
+			throw std::runtime_error("Failed To Load Image File!");
 		}
 
-		VkCommandBufferBeginInfo begin_info = {};
-		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+		decoded._width = static_cast<uint32_t>(texture_width);
+		decoded._height = static_cast<uint32_t>(texture_height);
+		decoded._mip_levels = MipChain::LevelCount(decoded._width, decoded._height);
+		decoded._generate_mips = _gpu_texture_mips;
 
-		VkRenderPassBeginInfo render_pass_begin_info = {};
-		render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		render_pass_begin_info.renderPass = _vk_render_pass;
-		render_pass_begin_info.renderArea.offset = { 0,0 };
-		render_pass_begin_info.renderArea.extent = _vk_swapchain_extent;
-		
-		std::array<VkClearValue, 2> clear_values = {};
-		clear_values[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-		clear_values[1].depthStencil = { 1.0f, 0 };
+		try
+		{
+			if (_gpu_texture_mips)
+			{
+				uint64_t image_size = static_cast<uint64_t>(decoded._width) * decoded._height * 4;
+				decoded._levels.push_back({ decoded._width, decoded._height, 0, image_size });
 
-		render_pass_begin_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
-		render_pass_begin_info.pClearValues = clear_values.data();
-		
-		VkBuffer vertex_buffers[] = { _vk_vertex_buffer };
-		VkDeviceSize offsets[] = {0};
+				memcpy(stage(image_size), pixels, static_cast<size_t>(image_size));
+			}
+			else
+			{
+				std::vector<uint8_t> mip_chain = MipChain::Build(pixels, decoded._width, decoded._height, decoded._levels);
+				memcpy(stage(mip_chain.size()), mip_chain.data(), mip_chain.size());
+			}
+		}
+		catch (...)
+		{
+			stbi_image_free(pixels);
+			throw;
+		}
+
+		stbi_image_free(pixels);
+	}
 
-		for (size_t i = 0; i < _vk_command_buffers.size(); ++i)
+	// uploads what the decode workers finished and points the texture's slot in the frame's table at its current view
+	// only call once the fence of frame_index has signaled, the frame's command buffers may be re-recorded
+	void StreamTextures(uint32_t frame_index)
+	{
+		if (_texture_streamer.Update() && _texture_streamer.IsResident(_texture))
 		{
-			vkBeginCommandBuffer(_vk_command_buffers[i], &begin_info);
-			render_pass_begin_info.framebuffer = _vk_swapchain_frame_buffers[i];
-			vkCmdBeginRenderPass(_vk_command_buffers[i], &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
-			vkCmdBindPipeline(_vk_command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, _vk_pipeline);
-			vkCmdBindVertexBuffers(_vk_command_buffers[i], 0, 1, vertex_buffers, offsets);
-			vkCmdBindIndexBuffer(_vk_command_buffers[i], _vk_index_buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdBindDescriptorSets(_vk_command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, _vk_pipeline_layout, 0, 1, &_vk_descriptor_set, 0, nullptr);
-			vkCmdDrawIndexed(_vk_command_buffers[i], static_cast<uint32_t>(_indices.size()), 1, 0, 0, 0);
+			_statistics._texture_latency_seconds = _texture_streamer.ResidentLatency(_texture);
+			std::cout << "streamed " << _texture_streamer.Path(_texture) << " | resident after " << _statistics._texture_latency_seconds * 1000.0
+				<< " ms | frame " << _statistics._frame_count << std::endl;
+		}
 
+		FrameData& frame = _frames[frame_index];
+		VkImageView view = _texture_streamer.View(_texture);
 
-			// resolve multisampling????
+		if (frame._texture_view == view)
+		{
+			return;
+		}
 
+		_texture_table.Write(frame_index, _texture_slot, _vk_texture_sampler, view);
+		frame._texture_view = view;
 
-			vkCmdEndRenderPass(_vk_command_buffers[i]);
-			if (vkEndCommandBuffer(_vk_command_buffers[i]) != VK_SUCCESS)
-			{
-				throw std::runtime_error("Failed To Record Command Buffer!");
-			}
+		// without update after bind the write invalidated the command buffers the table is bound in, per frame
+		// recording redoes them anyway
+		if (!_texture_table.UpdateAfterBind() && !PerFrameRecording())
+		{
+			RecordCommandBuffers(frame_index);
 		}
 	}
 
-	void CreateSemaphores()
+	// watches Shaders/ for the files compileSPIRV.bat reads and writes
+	void StartShaderReloader()
 	{
-		VkSemaphoreCreateInfo create_info = {};
-		create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-		if (vkCreateSemaphore(_vk_logical_device, &create_info, nullptr, &_vk_image_available_semaphore) != VK_SUCCESS || 
-			vkCreateSemaphore(_vk_logical_device, &create_info, nullptr, &_vk_frame_complete_semaphore) != VK_SUCCESS)
+		std::vector<ShaderCompileRule> rules =
 		{
-			throw std::runtime_error("Failed To Create Semaphores!");
+			{ "shader.vert", "vert.spv", "" },
+			{ "shader.vert", "vert_color.spv", "-DVERTEX_COLOR" },
+			{ "shader.frag", "frag.spv", "" },
+			{ "shader.frag", "frag_nonuniform.spv", "-DNON_UNIFORM_INDEXING" },
+			{ "cull.comp", "cull.spv", "" },
+		};
+
+		if (!_shader_reloader.Initialize("Shaders", ShaderReloader::DefaultCompiler(), std::move(rules)))
+		{
+			std::cerr << "Shader hot reload is unavailable, the shader directory cannot be watched" << std::endl;
 		}
 	}
 
-	void UpdateUniformBuffer()
+	// requests the variants the current shaders and settings ask for, they compile while the bound ones keep drawing
+	void RequestPipelines(const std::string& reason)
 	{
-		static auto start_time = std::chrono::high_resolution_clock::now();
+		_graphics_pipeline._requested = _pipeline_registry.Request(GraphicsPipelineState(), _vk_render_pass);
 
-		auto current_time = std::chrono::high_resolution_clock::now();
-		float time = std::chrono::duration<float, std::chrono::seconds::period>(current_time - start_time).count();
-
-		UniformBufferObject ubo = {};
-		ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(20.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		ubo.view = glm::lookAt(glm::vec3(0.0f, 7.0f, 15.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		ubo.proj = glm::perspective(glm::radians(45.0f), _vk_swapchain_extent.width / static_cast<float>(_vk_swapchain_extent.height), 0.1f, 100.0f);
-		ubo.proj[1][1] *= -1;
+		if (_vk_cull_pipeline != VK_NULL_HANDLE)
+		{
+			_cull_pipeline._requested = _pipeline_registry.Request(CullPipelineState());
+		}
 
-		void* data;
-		vkMapMemory(_vk_logical_device, _vk_uniform_buffer_memory, 0, sizeof(ubo), 0,&data);
-		memcpy(data, &ubo, sizeof(ubo));
-		vkUnmapMemory(_vk_logical_device, _vk_uniform_buffer_memory);
+		_pipeline_request_reason = reason;
+		_pipeline_request_time = std::chrono::high_resolution_clock::now();
 	}
 
-	void Draw()
+	// binds a slot's requested variant once it compiled - a failed one is given up for the bound one
+	bool BindReadyPipeline(PipelineSlot& slot, VkPipeline& vk_pipeline)
 	{
-		// wait for previous frame
-		vkDeviceWaitIdle(_vk_logical_device);
-		
-		uint32_t image_index;
-		VkResult result = vkAcquireNextImageKHR(_vk_logical_device, _vk_swapchain, std::numeric_limits<uint64_t>::max(), _vk_image_available_semaphore, VK_NULL_HANDLE, &image_index);
-		
-		// break and update swapchain
-		if (result == VK_ERROR_OUT_OF_DATE_KHR)
+		if (slot._requested == slot._bound)
 		{
-			RecreateSwapChain();
-			return;
+			return false;
 		}
-		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+
+		if (_pipeline_registry.IsFailed(slot._requested))
 		{
-			throw std::runtime_error("Failed To Acquire Swapchain Image!");
+			std::cerr << "Pipeline variant failed to build, keeping the current one: " << _pipeline_registry.Error(slot._requested) << std::endl;
+			slot._requested = slot._bound;
+			return false;
 		}
 
-		VkSemaphore wait_semaphores[] = { _vk_image_available_semaphore };
-		VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		VkSemaphore signal_semaphores[] = { _vk_frame_complete_semaphore };
-
-		VkSubmitInfo submit_info= {};
-		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submit_info.waitSemaphoreCount = 1;
-		submit_info.pWaitSemaphores = wait_semaphores;
-		submit_info.pWaitDstStageMask = wait_stages;
-		submit_info.commandBufferCount = 1;
-		submit_info.pCommandBuffers = &_vk_command_buffers[image_index];
-		submit_info.signalSemaphoreCount = 1;
-		submit_info.pSignalSemaphores = signal_semaphores;
+		VkPipeline pipeline = _pipeline_registry.Get(slot._requested);
 
-		if (vkQueueSubmit(_vk_graphics_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+		if (pipeline == VK_NULL_HANDLE)
 		{
-			throw std::runtime_error("Failed To Submit Draw Command Buffer!");
+			return false;
 		}
 
-		VkSwapchainKHR swapchains[] = { _vk_swapchain };
-
-		VkPresentInfoKHR present_info = {};
-		present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-		present_info.waitSemaphoreCount = 1;
-		present_info.pWaitSemaphores = signal_semaphores;
-		present_info.swapchainCount = 1;
-		present_info.pSwapchains = swapchains;
-		present_info.pImageIndices = &image_index;
-
-		result = vkQueuePresentKHR(_vk_present_queue, &present_info);
+		slot._bound = slot._requested;
+		vk_pipeline = pipeline;
 
-		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
-		{
-			RecreateSwapChain();
-		}
-		else if (result != VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed To Present Swapchain Image!");
-		}
+		return true;
 	}
 
-	int TestPhysicalDevice(VkPhysicalDevice device)
+	// frame boundary - hands reloaded spir-v to the registry and binds the variants that finished compiling, draws never
+	// wait for one. the pipelines stay alive in the registry, so frames still in flight with the old ones are unaffected
+	// only call once the fence of frame_index has signaled, the frame's command buffers may be re-recorded
+	void UpdatePipelines(uint32_t frame_index)
 	{
-		bool swap_chain_supported = false;
+		ShaderReload reload;
 
-		if (CheckExtensions(device))
+		if (_shader_reloader.IsWatching() && _shader_reloader.Update(reload))
 		{
-			VkPhysicalDeviceProperties device_properties;
-			vkGetPhysicalDeviceProperties(device, &device_properties);
+			if (!reload._error.empty())
+			{
+				std::cerr << "Shader reload failed, keeping the old pipelines: " << reload._error << std::endl;
+			}
+			else
+			{
+				std::string reason = "reloaded";
+				for (size_t i = 0; i < reload._outputs.size(); ++i)
+				{
+					if (_shader_hashes.count(reload._outputs[i]) != 0)
+					{
+						_shader_hashes[reload._outputs[i]] = _pipeline_registry.AddShader(reload._spirv[i]);
+						reason += " " + reload._outputs[i];
+					}
+				}
 
-			VkPhysicalDeviceFeatures device_features;
-			vkGetPhysicalDeviceFeatures(device, &device_features);
-			
-			SwapChainSupport swap_chain_support = CheckSwapChainSupport(device);
+				RequestPipelines(reason);
 
-			swap_chain_supported = !swap_chain_support._formats.empty() && !swap_chain_support._present_modes.empty() && device_features.samplerAnisotropy;
+				// latency counts from the file change, not from when the compiled spir-v arrived
+				_pipeline_request_time = reload._change_time;
+				_shader_compile_seconds = reload._compile_seconds;
+			}
 		}
 
-		return swap_chain_supported;
-	}
-
-	bool CheckExtensions(VkPhysicalDevice device)
-	{
-		bool ret_val = true;
-		
-		uint32_t extension_num;
-		vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_num, nullptr);
-		std::vector<VkExtensionProperties> extensions(extension_num);
-		vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_num, extensions.data());
-		
-		for (const char* name : DEVICE_EXTENSIONS)
+		if (_wireframe_toggled)
 		{
-			bool found = false;
+			_wireframe_toggled = false;
 
-			for (VkExtensionProperties properties : extensions)
+			if (_fill_mode_non_solid)
 			{
-				if (strncmp(properties.extensionName, name, strlen(properties.extensionName)) == 0)
-				{
-					found = true;
-					break;
-				}
+				_wireframe = !_wireframe;
+				RequestPipelines(_wireframe ? "wireframe" : "shaded");
+				_shader_compile_seconds = 0.0;
 			}
-
-			if (!found)
+			else
 			{
-				ret_val = false;
-				break;
+				std::cerr << "fillModeNonSolid is not supported, no wireframe" << std::endl;
 			}
 		}
 
-		return ret_val;
-	}
+		bool pending = _graphics_pipeline._requested != _graphics_pipeline._bound || _cull_pipeline._requested != _cull_pipeline._bound;
 
-	bool CheckValidationLayers()
-	{
-		bool ret_val = true;
-		uint32_t layer_num;
-		vkEnumerateInstanceLayerProperties(&layer_num, nullptr);
-		std::vector<VkLayerProperties> layers(layer_num);
-		vkEnumerateInstanceLayerProperties(&layer_num, layers.data());
+		bool bound = BindReadyPipeline(_graphics_pipeline, _vk_pipeline);
+		bound = BindReadyPipeline(_cull_pipeline, _vk_cull_pipeline) || bound;
 
-		for (const char* layer_name : VALIDATION_LAYERS)
+		if (bound)
 		{
-			bool layer_found = false;
+			++_pipeline_generation;
+		}
 
-			for (const auto& layer : layers)
-			{
-				if (strncmp(layer_name, layer.layerName, strlen(layer_name)) == 0)
-				{
-					layer_found = true;
-					break;
-				}
-			}
+		if (pending && _graphics_pipeline._requested == _graphics_pipeline._bound && _cull_pipeline._requested == _cull_pipeline._bound)
+		{
+			double live_seconds = std::chrono::duration<double, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - _pipeline_request_time).count();
+			_statistics._pipeline_switch_seconds.push_back(live_seconds);
 
-			if (!layer_found)
-			{
-				ret_val = false;
-				break;
-			}
+			std::cout << _pipeline_request_reason << " | compiled in " << _shader_compile_seconds * 1000.0 << " ms | pipeline built in "
+				<< _pipeline_registry.CompileSeconds(_graphics_pipeline._bound) * 1000.0 << " ms | live after " << live_seconds * 1000.0
+				<< " ms | frame " << _statistics._frame_count << " | " << _pipeline_registry.Size() << " pipelines" << std::endl;
 		}
 
-		return ret_val;
+		// recorded once command buffers still reference the pipelines that were replaced
+		if (!PerFrameRecording() && _frames[frame_index]._pipeline_generation != _pipeline_generation)
+		{
+			RecordCommandBuffers(frame_index);
+		}
 	}
 
-	QueueFamilies CheckQueueFamilies(VkPhysicalDevice device)
+	void CreateTextureSampler()
 	{
-		QueueFamilies queue_family_data;
+		VkPhysicalDeviceProperties device_properties;
+		vkGetPhysicalDeviceProperties(_vk_physical_device, &device_properties);
 
-		// get physical device queue families to use
-		uint32_t queue_family_num = 0;
-		vkGetPhysicalDeviceQueueFamilyProperties(_vk_physical_device, &queue_family_num, nullptr);
+		VkSamplerCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		create_info.magFilter = VK_FILTER_LINEAR;
+		create_info.minFilter = VK_FILTER_LINEAR;
+		create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		create_info.anisotropyEnable = _sampler_anisotropy ? VK_TRUE : VK_FALSE;
+		create_info.maxAnisotropy = _sampler_anisotropy ? std::min(16.0f, device_properties.limits.maxSamplerAnisotropy) : 1.0f;
+		create_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+		create_info.unnormalizedCoordinates = VK_FALSE;
+		create_info.compareEnable = VK_FALSE;
+		create_info.compareOp = VK_COMPARE_OP_ALWAYS;
+		create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		create_info.mipLodBias = 0.0f;
+		create_info.minLod = 0.0f;
+		// shared by the placeholder and the streamed texture, every view clamps to its own levels
+		create_info.maxLod = VK_LOD_CLAMP_NONE;
 
-		std::vector<VkQueueFamilyProperties> queue_families(queue_family_num);
-		vkGetPhysicalDeviceQueueFamilyProperties(_vk_physical_device, &queue_family_num, queue_families.data());
+		if (vkCreateSampler(_vk_logical_device, &create_info, nullptr, &_vk_texture_sampler) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Texture Sampler!");
+		}
+	}
 
-		for (uint32_t i = 0; i < queue_families.size(); ++i)
+	// quantized encodings need a vertex buffer format the device can fetch, anything else falls back to floats
+	void SelectVertexLayout()
+	{
+		auto Supported = [this](VkFormat format)
 		{
-			if (queue_families[i].queueCount > 0 && queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
-			{
-				queue_family_data._graphics_family = i;
-			}
+			VkFormatProperties properties;
+			vkGetPhysicalDeviceFormatProperties(_vk_physical_device, format, &properties);
+			return (properties.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT) != 0;
+		};
 
-			VkBool32 present_support = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(_vk_physical_device, i, _vk_surface, &present_support);
+		AttributeEncoding position_encoding = _settings._position_encoding;
+		AttributeEncoding texcoord_encoding = _settings._texcoord_encoding;
 
-			if (queue_families[i].queueCount > 0 && present_support)
-			{
-				queue_family_data._present_family = i;
-			}
+		if (!Supported(VertexLayout(position_encoding).PositionFormat()))
+		{
+			position_encoding = AttributeEncoding::Float32;
 		}
 
-		if (!queue_family_data.QueuesAquired())
+		if (!Supported(VertexLayout(AttributeEncoding::Float32, texcoord_encoding).TexcoordFormat()))
 		{
-			throw std::runtime_error("Required Queues Unavailable!");
+			texcoord_encoding = AttributeEncoding::Float32;
 		}
 
-		return queue_family_data;
+		_vertex_layout = VertexLayout(position_encoding, texcoord_encoding, _settings._vertex_color);
 	}
 
-	SwapChainSupport CheckSwapChainSupport(VkPhysicalDevice device)
+	void CreateVertexBuffer()
 	{
-		SwapChainSupport support;
+		std::vector<uint8_t> packed_vertices;
+		_vertex_dequantization = _vertex_layout.Pack(&_p_mesh_vertices->pos.x, &_p_mesh_vertices->uv.x, &_p_mesh_vertices->color.x, sizeof(Vertex), _mesh_vertex_count, packed_vertices);
 
-		vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, _vk_surface, &support._capabilities);
-		
-		uint32_t format_num;
-		vkGetPhysicalDeviceSurfaceFormatsKHR(device, _vk_surface, &format_num, nullptr);
-		if (format_num != 0)
-		{
-			support._formats.resize(format_num);
-			vkGetPhysicalDeviceSurfaceFormatsKHR(device, _vk_surface, &format_num, support._formats.data());
-		}
+		VkDeviceSize buffer_size = packed_vertices.size();
+		_statistics._vertex_stride = _vertex_layout.Stride();
+		_statistics._vertex_buffer_bytes = buffer_size;
 
-		uint32_t present_mode_num;
-		vkGetPhysicalDeviceSurfacePresentModesKHR(device, _vk_surface, &present_mode_num, nullptr);
-		if (present_mode_num != 0)
-		{
-			support._present_modes.resize(present_mode_num);
-			vkGetPhysicalDeviceSurfacePresentModesKHR(device, _vk_surface, &present_mode_num, support._present_modes.data());
-		}
+		CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vk_vertex_buffer, _vertex_buffer_allocation);
 
-		return support;
+		_upload_manager.UploadBuffer(_vk_vertex_buffer, packed_vertices.data(), buffer_size, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
 	}
 
-	VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> & available_formats)
+	void CreateIndexBuffer()
 	{
-		VkSurfaceFormatKHR ret_val;
-
-		// check for no preferred format
-		if (available_formats.size() == 1 && available_formats[0].format == VK_FORMAT_UNDEFINED)
-		{
-			ret_val = { VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
-		}
-		else
-		{
-			// default to first option
-			ret_val = available_formats[0];
+		VkDeviceSize buffer_size = sizeof(uint16_t) * _mesh_index_count;
 
-			// try to find ideal option
-			for (const auto & format : available_formats)
-			{
-				if (format.format == VK_FORMAT_B8G8R8A8_UNORM && format.colorSpace == VK_COLORSPACE_SRGB_NONLINEAR_KHR)
-				{
-					ret_val = format;
-				}
-			}
-		}
+		CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vk_index_buffer, _index_buffer_allocation);
 
-		return ret_val;
+		_upload_manager.UploadBuffer(_vk_index_buffer, _p_mesh_indices, buffer_size, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
 	}
 
-	VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR> available_modes)
+	// instances on a square grid around the origin, spaced by the mesh bounds - a single instance keeps the identity
+	void CreateInstanceBuffer()
 	{
-		// defualt to single guaranteed mode
-		VkPresentModeKHR ret_val = VK_PRESENT_MODE_FIFO_KHR;
+		uint32_t instance_count = std::max(1u, _settings._instance_count);
+		uint32_t grid_side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instance_count))));
 
-		// test for other modes
-		for (const auto & mode : available_modes)
+		glm::vec3 extent = _mesh_bounds_max - _mesh_bounds_min;
+		float spacing = 1.25f * std::max(extent.x, extent.z);
+
+		std::vector<InstanceData> instances(instance_count);
+		_instance_models.resize(instance_count);
+		for (uint32_t i = 0; i < instance_count; ++i)
 		{
-			// best mode
-			if (mode == VK_PRESENT_MODE_MAILBOX_KHR)
-			{
-				ret_val = mode;
-				break;
-			}
-			else if(mode == VK_PRESENT_MODE_IMMEDIATE_KHR)
-			{
-				ret_val = mode;
-			}
+			float x = (static_cast<float>(i % grid_side) - 0.5f * (grid_side - 1)) * spacing;
+			float z = (static_cast<float>(i / grid_side) - 0.5f * (grid_side - 1)) * spacing;
+
+			instances[i].model = glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z));
+			_instance_models[i] = instances[i].model;
+
+			// a cheap per instance hue shift so neighbouring copies can be told apart
+			instances[i].color = instance_count == 1 ? glm::vec3(1.0f) :
+				glm::vec3(0.75f + 0.25f * ((i * 37) % 11) / 10.0f, 0.75f + 0.25f * ((i * 53) % 13) / 12.0f, 0.75f + 0.25f * ((i * 71) % 7) / 6.0f);
+			instances[i].texture_slot = _texture_slot;
 		}
 
-		return ret_val;
+		// the camera backs off with the grid so every layout stays in view
+		_instance_view_scale = static_cast<float>(grid_side);
+
+		_statistics._triangles_per_frame = static_cast<uint64_t>(_mesh_index_count / 3) * instance_count;
+		_statistics._visible_triangles = _statistics._triangles_per_frame;
+
+		BuildCullHierarchy(instances);
+
+		VkDeviceSize buffer_size = sizeof(InstanceData) * instances.size();
+
+		CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vk_instance_buffer, _instance_buffer_allocation);
+
+		_upload_manager.UploadBuffer(_vk_instance_buffer, instances.data(), buffer_size, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
 	}
-	
-	VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR & capabilities)
+
+	// the hierarchy lives in the space before the ubo model matrix, which only the frustum planes see
+	void BuildCullHierarchy(const std::vector<InstanceData>& instances)
 	{
-		VkExtent2D ret_val = capabilities.currentExtent;
+		uint32_t instance_count = static_cast<uint32_t>(instances.size());
 
-		if (capabilities.currentExtent.width == std::numeric_limits<uint32_t>::max())
+		// everything until the first cull, and always when the cpu does not cull
+		_draw_ranges.clear();
+		for (uint32_t submesh = 0; submesh < _submeshes.size(); ++submesh)
 		{
-			int width, height;
-			glfwGetWindowSize(_p_glfw_window, &width, &height);
-			ret_val = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+			_draw_ranges.push_back({ submesh, 0, instance_count });
+		}
 
-			if (ret_val.width < capabilities.minImageExtent.width)
-			{
-				ret_val.width = capabilities.minImageExtent.width;
-			}
-			else if (ret_val.width > capabilities.maxImageExtent.width)
-			{
-				ret_val.width = capabilities.maxImageExtent.width;
-			}
+		BuildDrawList();
 
-			if (ret_val.height < capabilities.minImageExtent.height)
-			{
-				ret_val.height = capabilities.minImageExtent.height;
-			}
-			else if (ret_val.height > capabilities.maxImageExtent.height)
+		if (_settings._culling != CullingMode::Cpu)
+		{
+			return;
+		}
+
+		std::vector<BoundingBox> object_bounds;
+		object_bounds.reserve(_submesh_bounds.size() * instance_count);
+		for (const BoundingBox& submesh_bounds : _submesh_bounds)
+		{
+			for (const InstanceData& instance : instances)
 			{
-				ret_val.height = capabilities.maxImageExtent.height;
+				object_bounds.push_back(submesh_bounds.Transformed(glm::value_ptr(instance.model)));
 			}
 		}
 
-		return ret_val;
+		_cull_hierarchy.Build(object_bounds.data(), static_cast<uint32_t>(object_bounds.size()));
+		_object_visible.assign(object_bounds.size(), 0);
 	}
 
-	void TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout)
+	// the instance index buffer is the identity unless the gpu culls, which also reads the submesh bounds
+	// and resets the frame's indirect commands from a template before every cull pass
+	void CreateCullBuffers()
 	{
-		VkCommandBuffer command_buffer = StartSingleTimeCommands();
-
-		VkImageMemoryBarrier barrier = {};
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		barrier.oldLayout = old_layout;
-		barrier.newLayout = new_layout;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.image = image;
+		uint32_t instance_count = std::max(1u, _settings._instance_count);
 
-		if (new_layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
+		std::vector<uint32_t> identity(instance_count);
+		for (uint32_t i = 0; i < instance_count; ++i)
 		{
-			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+			identity[i] = i;
+		}
 
-			if (HasStencilComponent(format))
-			{
-				barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-			}
+		VkDeviceSize identity_size = sizeof(uint32_t) * identity.size();
+		CreateBuffer(identity_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vk_instance_index_buffer, _instance_index_buffer_allocation);
+		_upload_manager.UploadBuffer(_vk_instance_index_buffer, identity.data(), identity_size, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+		if (_settings._culling != CullingMode::Gpu)
+		{
+			return;
 		}
-		else
+
+		std::vector<SubmeshBounds> bounds;
+		std::vector<VkDrawIndexedIndirectCommand> commands;
+		for (uint32_t submesh = 0; submesh < _submeshes.size(); ++submesh)
 		{
-			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			const BoundingBox& box = _submesh_bounds[submesh];
+			bounds.push_back({ glm::vec4(glm::make_vec3(box._center), 0.0f), glm::vec4(glm::make_vec3(box._extent), 0.0f) });
+
+			VkDrawIndexedIndirectCommand command = {};
+			command.indexCount = _submeshes[submesh]._index_count;
+			command.instanceCount = 0;
+			command.firstIndex = _submeshes[submesh]._first_index;
+			command.vertexOffset = _submeshes[submesh]._vertex_offset;
+			command.firstInstance = submesh * instance_count;
+			commands.push_back(command);
 		}
 
-		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = 0;
+		VkDeviceSize bounds_size = sizeof(SubmeshBounds) * bounds.size();
+		CreateBuffer(bounds_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vk_submesh_bounds_buffer, _submesh_bounds_buffer_allocation);
+		_upload_manager.UploadBuffer(_vk_submesh_bounds_buffer, bounds.data(), bounds_size, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
 
-		VkPipelineStageFlags source_stage;
-		VkPipelineStageFlags dest_stage;
+		VkDeviceSize commands_size = sizeof(VkDrawIndexedIndirectCommand) * commands.size();
+		CreateBuffer(commands_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vk_draw_command_template, _draw_command_template_allocation);
+		_upload_manager.UploadBuffer(_vk_draw_command_template, commands.data(), commands_size, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+	}
 
-		if (old_layout == VK_IMAGE_LAYOUT_UNDEFINED && new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+	// what the cull pass writes has to stay untouched until the frame's draws have read it, so every frame in flight owns a set
+	void CreateIndirectDrawBuffers()
+	{
+		if (_settings._culling != CullingMode::Gpu)
 		{
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			return;
 		}
-		else if (old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+
+		VkDeviceSize commands_size = sizeof(VkDrawIndexedIndirectCommand) * _submeshes.size();
+		VkDeviceSize indices_size = sizeof(uint32_t) * _submeshes.size() * std::max(1u, _settings._instance_count);
+
+		for (FrameData& frame : _frames)
 		{
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-			source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-			dest_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			CreateBuffer(commands_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame._vk_draw_command_buffer, frame._draw_command_allocation);
+			CreateBuffer(indices_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame._vk_visible_instance_buffer, frame._visible_instance_allocation);
+
+			// read back before the first cull pass ran
+			memset(frame._draw_command_allocation._p_mapped, 0, static_cast<size_t>(commands_size));
 		}
-		else if (old_layout == VK_IMAGE_LAYOUT_UNDEFINED && new_layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
+	}
+
+	// the cpu rewrites a frame's mvps every frame, so like the ubo region every frame in flight owns its buffer
+	void CreateTransformBuffers()
+	{
+		if (!_settings._cpu_transforms)
 		{
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-			source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			dest_stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+			return;
 		}
-		else
+
+		VkDeviceSize transforms_size = sizeof(glm::mat4) * _instance_models.size();
+
+		for (FrameData& frame : _frames)
 		{
-			throw std::runtime_error("Unsupported Layout Transition!");
+			CreateBuffer(transforms_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				frame._vk_transform_buffer, frame._transform_allocation);
 		}
+	}
 
-		vkCmdPipelineBarrier(command_buffer, source_stage, dest_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-		EndSingleTimeCommands(command_buffer);
-	}
-
-	void CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkSampleCountFlagBits samples, VkMemoryPropertyFlags mem_properties, VkImage& image, VkDeviceMemory& image_memory)
+	// only valid once the fence of frame_index has signaled - counts what the frame's last cull pass let through
+	void ReadGpuCullResults(uint32_t frame_index)
 	{
-		VkImageCreateInfo create_info = {};
-		create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-		create_info.imageType = VK_IMAGE_TYPE_2D;
-		create_info.extent.width = width;
-		create_info.extent.height = height;
-		create_info.extent.depth = 1;
-		create_info.mipLevels = 1;
-		create_info.arrayLayers = 1;
-		create_info.format = format;
-		create_info.tiling = tiling;
-		create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		create_info.usage = usage;
-		create_info.samples = samples;
-		create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-		if (vkCreateImage(_vk_logical_device, &create_info, nullptr, &image) != VK_SUCCESS)
+		if (_settings._culling != CullingMode::Gpu)
 		{
-			throw std::runtime_error("Failed To Create Image!");
+			return;
 		}
 
-		VkMemoryRequirements mem_requirements;
-		vkGetImageMemoryRequirements(_vk_logical_device, image, &mem_requirements);
+		const VkDrawIndexedIndirectCommand* p_commands = static_cast<const VkDrawIndexedIndirectCommand*>(_frames[frame_index]._draw_command_allocation._p_mapped);
 
-		VkMemoryAllocateInfo alloc_info = {};
-		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		alloc_info.allocationSize = mem_requirements.size;
-		alloc_info.memoryTypeIndex = FindMemoryType(mem_requirements.memoryTypeBits, mem_properties);
-
-		if (vkAllocateMemory(_vk_logical_device, &alloc_info, nullptr, &image_memory) != VK_SUCCESS)
+		uint64_t visible_triangles = 0;
+		for (uint32_t submesh = 0; submesh < _submeshes.size(); ++submesh)
 		{
-			throw std::runtime_error("Failed To Allocate Image Memory!");
+			visible_triangles += static_cast<uint64_t>(p_commands[submesh].instanceCount) * (p_commands[submesh].indexCount / 3);
 		}
 
-		vkBindImageMemory(_vk_logical_device, image, image_memory, 0);
+		_statistics._visible_triangles = visible_triangles;
 	}
 
-	VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect_flags)
+	// turns the visible objects into runs of consecutive instances per submesh - a linear sweep over the
+	// flags keeps them sorted without sorting the bvh's output
+	void CullScene()
 	{
-		VkImageViewCreateInfo create_info = {};
-		create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-		create_info.image = image;
-		create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		create_info.format = format;
-		create_info.subresourceRange.aspectMask = aspect_flags;
-		create_info.subresourceRange.baseMipLevel = 0;
-		create_info.subresourceRange.levelCount = 1;
-		create_info.subresourceRange.baseArrayLayer = 0;
-		create_info.subresourceRange.layerCount = 1;
+		_visible_objects.clear();
+		_cull_hierarchy.Cull(_cull_frustum, _visible_objects);
 
-		VkImageView image_view;
-		if (vkCreateImageView(_vk_logical_device, &create_info, nullptr, &image_view) != VK_SUCCESS)
+		for (uint32_t object : _visible_objects)
 		{
-			throw std::runtime_error("Failed To Create Texture Image View!");
+			_object_visible[object] = 1;
 		}
 
-		return image_view;
-	}
+		uint32_t instance_count = std::max(1u, _settings._instance_count);
+		uint64_t visible_triangles = 0;
 
-	void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
-	{
-		VkCommandBuffer command_buffer = StartSingleTimeCommands();
+		_draw_ranges.clear();
+		for (uint32_t submesh = 0; submesh < _submeshes.size(); ++submesh)
+		{
+			uint8_t* p_visible = &_object_visible[submesh * instance_count];
+			for (uint32_t instance = 0; instance < instance_count; ++instance)
+			{
+				if (!p_visible[instance])
+				{
+					continue;
+				}
 
-		VkBufferImageCopy image_copy = {};
-		image_copy.bufferOffset = 0;
-		image_copy.bufferRowLength = 0;
-		image_copy.bufferImageHeight = 0;
-		image_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		image_copy.imageSubresource.mipLevel = 0;
-		image_copy.imageSubresource.baseArrayLayer = 0;
-		image_copy.imageSubresource.layerCount = 1;
-		image_copy.imageOffset = { 0, 0, 0 };
-		image_copy.imageExtent = { width, height, 1 };
+				p_visible[instance] = 0;
+				visible_triangles += _submeshes[submesh]._index_count / 3;
+
+				if (!_draw_ranges.empty() && _draw_ranges.back()._submesh == submesh && _draw_ranges.back()._first_instance + _draw_ranges.back()._instance_count == instance)
+				{
+					++_draw_ranges.back()._instance_count;
+				}
+				else
+				{
+					_draw_ranges.push_back({ submesh, instance, 1 });
+				}
+			}
+		}
 
-		vkCmdCopyBufferToImage(command_buffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &image_copy);
+		_statistics._visible_triangles = visible_triangles;
 
-		EndSingleTimeCommands(command_buffer);
+		BuildDrawList();
 	}
 
-	// 
-	
+	void CreateUniformBuffers()
+	{
+		// one region per frame in flight so the cpu never writes data the gpu is still reading
+		_frames.resize(_settings._frames_in_flight);
+
+		VkPhysicalDeviceProperties device_properties;
+		vkGetPhysicalDeviceProperties(_vk_physical_device, &device_properties);
+
+		VkDeviceSize alignment = device_properties.limits.minUniformBufferOffsetAlignment;
+		VkDeviceSize frame_size = (UNIFORM_RING_FRAME_SIZE + alignment - 1) / alignment * alignment;
+		VkDeviceSize buffer_size = frame_size * _frames.size();
 
-	// CHANGE COMMANDS SHIT TO ASYNC
-	// setupcommandbuffer, helpers with buffer comms add and then flush any added comms
+		// host visible allocations stay mapped for the lifetime of the buffer, see DeviceMemoryAllocator
+		CreateBuffer(buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _vk_uniform_buffer, _uniform_buffer_allocation);
 
+		_uniform_ring.Initialize(_uniform_buffer_allocation._p_mapped, frame_size, static_cast<uint32_t>(_frames.size()), alignment);
+	}
 
-	VkCommandBuffer StartSingleTimeCommands()
+	// every frame allocates its sets linearly from pools of its own, see DescriptorAllocator
+	void CreateFrameDescriptors()
 	{
-		VkCommandBufferAllocateInfo alloc_info = {};
-		alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		alloc_info.commandPool = _vk_command_pool;
-		alloc_info.commandBufferCount = 1;
+		// per set - the larger of the draw and cull sets
+		std::vector<VkDescriptorPoolSize> pool_sizes =
+		{
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 },
+		};
 
-		VkCommandBuffer command_buffer;
-		vkAllocateCommandBuffers(_vk_logical_device, &alloc_info, &command_buffer);
+		VkImageView placeholder_view = _texture_streamer.View(_texture);
 
-		VkCommandBufferBeginInfo begin_info = {};
-		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		for (uint32_t i = 0; i < _frames.size(); ++i)
+		{
+			_frames[i]._descriptor_allocator.Initialize(_vk_logical_device, pool_sizes, FRAME_DESCRIPTOR_SETS_PER_POOL);
+			AllocateFrameDescriptors(i);
 
-		vkBeginCommandBuffer(command_buffer, &begin_info);
+			_frames[i]._texture_view = placeholder_view;
+			_texture_table.Write(i, _texture_slot, _vk_texture_sampler, placeholder_view);
+		}
 
-		return command_buffer;
+		_texture_table.WriteUnused(_vk_texture_sampler, placeholder_view);
 	}
 
-	void EndSingleTimeCommands(VkCommandBuffer command_buffer)
+	// resets the frame's allocator and writes its sets anew - only call once the fence of frame_index has signaled
+	// per frame recording calls it before every recording. pre-recorded command buffers keep the sets allocated at
+	// startup, a resize records them again while the frame's previous recordings may still be in flight
+	void AllocateFrameDescriptors(uint32_t frame_index)
 	{
-		vkEndCommandBuffer(command_buffer);
+		FrameData& frame = _frames[frame_index];
 
-		VkSubmitInfo submit_info = {};
-		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submit_info.commandBufferCount = 1;
-		submit_info.pCommandBuffers = &command_buffer;
+		frame._descriptor_allocator.Reset();
+		frame._descriptor_set = frame._descriptor_allocator.Allocate(_vk_descriptor_set_layout);
+
+		// binding order of shader.vert - the dynamic offset bound with the set picks the frame region and object
+		// without cpu transforms the shader never reads binding 3, the instance buffer only keeps it valid
+		std::array<VkDescriptorBufferInfo, 4> buffer_infos = {};
+		buffer_infos[0] = { _vk_uniform_buffer, 0, sizeof(UniformBufferObject) };
+		buffer_infos[1] = { _vk_instance_buffer, 0, VK_WHOLE_SIZE };
+		buffer_infos[2] = { _settings._culling == CullingMode::Gpu ? frame._vk_visible_instance_buffer : _vk_instance_index_buffer, 0, VK_WHOLE_SIZE };
+		buffer_infos[3] = { _settings._cpu_transforms ? frame._vk_transform_buffer : _vk_instance_buffer, 0, VK_WHOLE_SIZE };
+
+		std::array<VkWriteDescriptorSet, 4> write_descriptors = {};
+		for (uint32_t binding = 0; binding < write_descriptors.size(); ++binding)
+		{
+			write_descriptors[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write_descriptors[binding].dstSet = frame._descriptor_set;
+			write_descriptors[binding].dstBinding = binding;
+			write_descriptors[binding].dstArrayElement = 0;
+			write_descriptors[binding].descriptorType = binding == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			write_descriptors[binding].descriptorCount = 1;
+			write_descriptors[binding].pBufferInfo = &buffer_infos[binding];
+		}
 
-		vkQueueSubmit(_vk_graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
-		vkQueueWaitIdle(_vk_graphics_queue);
+		vkUpdateDescriptorSets(_vk_logical_device, static_cast<uint32_t>(write_descriptors.size()), write_descriptors.data(), 0, nullptr);
 
-		vkFreeCommandBuffers(_vk_logical_device, _vk_command_pool, 1, &command_buffer);
+		if (_settings._culling == CullingMode::Gpu)
+		{
+			AllocateCullDescriptorSet(frame_index);
+		}
 	}
 
+	void AllocateCullDescriptorSet(uint32_t frame_index)
+	{
+		FrameData& frame = _frames[frame_index];
 
+		frame._cull_descriptor_set = frame._descriptor_allocator.Allocate(_vk_cull_descriptor_set_layout);
 
+		// binding order of cull.comp - the ubo region is picked by the dynamic offset, like the graphics set
+		std::array<VkDescriptorBufferInfo, 5> buffer_infos = {};
+		buffer_infos[0] = { _vk_uniform_buffer, 0, sizeof(UniformBufferObject) };
+		buffer_infos[1] = { _vk_instance_buffer, 0, VK_WHOLE_SIZE };
+		buffer_infos[2] = { _vk_submesh_bounds_buffer, 0, VK_WHOLE_SIZE };
+		buffer_infos[3] = { frame._vk_draw_command_buffer, 0, VK_WHOLE_SIZE };
+		buffer_infos[4] = { frame._vk_visible_instance_buffer, 0, VK_WHOLE_SIZE };
 
+		std::array<VkWriteDescriptorSet, 5> write_descriptors = {};
+		for (uint32_t binding = 0; binding < write_descriptors.size(); ++binding)
+		{
+			write_descriptors[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write_descriptors[binding].dstSet = frame._cull_descriptor_set;
+			write_descriptors[binding].dstBinding = binding;
+			write_descriptors[binding].dstArrayElement = 0;
+			write_descriptors[binding].descriptorType = binding == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			write_descriptors[binding].descriptorCount = 1;
+			write_descriptors[binding].pBufferInfo = &buffer_infos[binding];
+		}
 
+		vkUpdateDescriptorSets(_vk_logical_device, static_cast<uint32_t>(write_descriptors.size()), write_descriptors.data(), 0, nullptr);
+	}
 
-	void CopyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size)
+	// command buffers are recorded per frame in flight and per swapchain image - [frame * image_count + image]
+	// each one is only resubmitted after its frame fence signals, so none are ever pending twice
+	VkCommandBuffer& FrameCommandBuffer(uint32_t frame_index, uint32_t image_index)
 	{
-		VkCommandBuffer command_buffer = StartSingleTimeCommands();
-		
-		VkBufferCopy copy = {};
-		copy.size = size;
-		vkCmdCopyBuffer(command_buffer, src, dst, 1, &copy);
-		
-		EndSingleTimeCommands(command_buffer);
+		return _vk_command_buffers[frame_index * _vk_swapchain_frame_buffers.size() + image_index];
 	}
 
-	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& buffer_memory)
+	void CreateCommandBuffers()
 	{
-		VkBufferCreateInfo create_info = {};
-		create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		create_info.size = size;
-		create_info.usage = usage;
-		create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		_vk_command_buffers.resize(_frames.size() * _vk_swapchain_frame_buffers.size());
 
-		if (vkCreateBuffer(_vk_logical_device, &create_info, nullptr, &buffer) != VK_SUCCESS)
+		VkCommandBufferAllocateInfo alloc_info = {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		alloc_info.commandPool = _vk_command_pool;
+		alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		alloc_info.commandBufferCount = static_cast<uint32_t>(_vk_command_buffers.size());
+
+		if (vkAllocateCommandBuffers(_vk_logical_device, &alloc_info, _vk_command_buffers.data()) != VK_SUCCESS)
 		{
-			throw std::runtime_error("Failed To Create Buffer!");
+			throw std::runtime_error("Failed To Allocate Command Buffers!");
 		}
 
-		VkMemoryRequirements memory_requirements;
-		vkGetBufferMemoryRequirements(_vk_logical_device, buffer, &memory_requirements);
-
-		VkMemoryAllocateInfo alloc_info = {};
-		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		alloc_info.allocationSize = memory_requirements.size;
-		alloc_info.memoryTypeIndex = FindMemoryType(memory_requirements.memoryTypeBits, properties);
-
-		if (vkAllocateMemory(_vk_logical_device, &alloc_info, nullptr, &buffer_memory) != VK_SUCCESS)
+		// per frame recording fills them right before submitting - recording here would also reset the secondaries
+		// of slots still in flight after a resize
+		if (PerFrameRecording())
 		{
-			throw std::runtime_error("Failed To Allocate Buffer Memory!");
+			return;
 		}
 
-		vkBindBufferMemory(_vk_logical_device, buffer, buffer_memory, 0);
+		for (uint32_t frame_index = 0; frame_index < _frames.size(); ++frame_index)
+		{
+			RecordCommandBuffers(frame_index);
+		}
 	}
 
-	uint32_t FindMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties)
+	// records the command buffers of one frame slot, one per swapchain image
+	void RecordCommandBuffers(uint32_t frame_index)
 	{
-		VkPhysicalDeviceMemoryProperties memory_properties;
-		vkGetPhysicalDeviceMemoryProperties(_vk_physical_device, &memory_properties);
+		_frames[frame_index]._pipeline_generation = _pipeline_generation;
 
-		for (uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i)
+		if (_settings._record_threads > 0)
 		{
-			if (type_filter & (1 << i) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
-			{
-				return i;
-			}
+			RecordSecondaryCommandBuffers(frame_index);
 		}
 
-		throw std::runtime_error("Failed To Find Suitable Memory Type!");
+		for (uint32_t image_index = 0; image_index < _vk_swapchain_frame_buffers.size(); ++image_index)
+		{
+			RecordCommandBuffer(frame_index, image_index);
+		}
 	}
 
-	VkFormat FindSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
+	// per frame recording - only the image about to be submitted, its slot's other images are recorded when acquired
+	void RecordFrame(uint32_t frame_index, uint32_t image_index)
 	{
-		for (VkFormat format : candidates)
+		AllocateFrameDescriptors(frame_index);
+
+		if (_settings._record_threads > 0)
 		{
-			VkFormatProperties props;
-			vkGetPhysicalDeviceFormatProperties(_vk_physical_device, format, &props);
+			RecordSecondaryCommandBuffers(frame_index);
+		}
 
-			if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features)
-			{
-				return format;
-			}
-			else if (tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features)
-			{
-				return format;
-			}
+		RecordCommandBuffer(frame_index, image_index);
+	}
 
-			throw std::runtime_error("Failed To Find Supported Format!");
-		}
+	// anything that changes the draws every frame re-records them every frame, otherwise they are recorded once
+	bool PerFrameRecording() const
+	{
+		return _settings._culling == CullingMode::Cpu || _settings._record_threads > 0;
 	}
 
-	std::vector<const char*> RequiredExtensions()
+	// only call once the fence of frame_index has signaled - with recording threads the render pass
+	// executes the frame's secondary command buffers, which must have been recorded first
+	void RecordCommandBuffer(uint32_t frame_index, uint32_t image_index)
 	{
-		std::vector<const char*> ret_val;
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
-		// get required extensions
-		uint32_t glfw_ret_val_num = 0;
-		const char** pp_glfw_ret_val_names;
-		pp_glfw_ret_val_names = glfwGetRequiredInstanceExtensions(&glfw_ret_val_num);
+		VkRenderPassBeginInfo render_pass_begin_info = {};
+		render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		render_pass_begin_info.renderPass = _vk_render_pass;
+		render_pass_begin_info.renderArea.offset = { 0,0 };
+		render_pass_begin_info.renderArea.extent = _vk_swapchain_extent;
+		
+		std::array<VkClearValue, 2> clear_values = {};
+		clear_values[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+		clear_values[1].depthStencil = { 1.0f, 0 };
 
-		if (pp_glfw_ret_val_names == nullptr)
+		render_pass_begin_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
+		render_pass_begin_info.pClearValues = clear_values.data();
+
+		VkCommandBuffer command_buffer = FrameCommandBuffer(frame_index, image_index);
+
+		vkBeginCommandBuffer(command_buffer, &begin_info);
+
+		// two timestamps per frame slot bracket the render pass
+		if (_vk_timestamp_query_pool != VK_NULL_HANDLE)
 		{
-			// vulkan not supported or no ret_vals to draw to screen exist
-			throw std::runtime_error("Vulkan Graphics Unavailable!");
+			vkCmdResetQueryPool(command_buffer, _vk_timestamp_query_pool, frame_index * 2, 2);
+			vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _vk_timestamp_query_pool, frame_index * 2);
 		}
 
-		// add layer extensions
-		for (uint32_t i = 0; i < glfw_ret_val_num; ++i)
+		if (_settings._culling == CullingMode::Gpu)
 		{
-			ret_val.push_back(pp_glfw_ret_val_names[i]);
+			RecordCullPass(command_buffer, frame_index);
 		}
 
-		// add validation layer extensions
-#ifndef NDEBUG
-		ret_val.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
-#endif
+		render_pass_begin_info.framebuffer = _vk_swapchain_frame_buffers[image_index];
 
-		// get available extensions
-		uint32_t extension_num = 0;
-		vkEnumerateInstanceExtensionProperties(nullptr, &extension_num, nullptr);
-		std::vector<VkExtensionProperties> extensions(extension_num);
-		vkEnumerateInstanceExtensionProperties(nullptr, &extension_num, extensions.data());
+		if (_settings._record_threads > 0)
+		{
+			// the slices in draw list order, so the image matches single threaded recording
+			const FrameData& frame = _frames[frame_index];
+			vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			vkCmdExecuteCommands(command_buffer, static_cast<uint32_t>(frame._secondary_command_buffers.size()), frame._secondary_command_buffers.data());
+		}
+		else
+		{
+			vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+			BindDrawState(command_buffer, frame_index);
+			RecordDraws(command_buffer, frame_index, 0, DrawCount());
+		}
 
-		// validate that all required extensions are present
-		for (uint32_t i = 0; i < ret_val.size(); ++i)
+		vkCmdEndRenderPass(command_buffer);
+
+		if (_vk_timestamp_query_pool != VK_NULL_HANDLE)
 		{
-			VkResult vk_result = VkResult::VK_ERROR_EXTENSION_NOT_PRESENT;
-			for each (VkExtensionProperties vk_ext in extensions)
-			{
-				if (strncmp(ret_val[i], vk_ext.extensionName, strlen(vk_ext.extensionName)) == 0)
-				{
-					vk_result = VkResult::VK_SUCCESS;
-					break;
-				}
-			}
+			vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _vk_timestamp_query_pool, frame_index * 2 + 1);
+		}
 
-			if (vk_result == VkResult::VK_ERROR_EXTENSION_NOT_PRESENT)
-			{
-				throw std::runtime_error("Missing Required Extensions!");
-			}
+		if (_frames[frame_index]._vk_readback_buffer != VK_NULL_HANDLE)
+		{
+			RecordReadback(command_buffer, frame_index, image_index);
 		}
 
-		return ret_val;
+		if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Record Command Buffer!");
+		}
 	}
 
-	VkShaderModule CreateShaderModule(const std::vector<char> & blob)
+	// the render pass's external dependency orders the copy after the resolve, the barrier makes it visible to the
+	// host once the frame's fence has signaled - WriteReadback picks it up then
+	void RecordReadback(VkCommandBuffer command_buffer, uint32_t frame_index, uint32_t image_index)
 	{
-		VkShaderModule shader_module;
+		const FrameData& frame = _frames[frame_index];
+
+		VkBufferImageCopy image_copy = {};
+		image_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		image_copy.imageSubresource.layerCount = 1;
+		image_copy.imageExtent = { _vk_swapchain_extent.width, _vk_swapchain_extent.height, 1 };
 
-		VkShaderModuleCreateInfo create_info = {};
-		create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		create_info.codeSize = blob.size();
-		create_info.pCode = reinterpret_cast<const uint32_t*>(blob.data());
+		vkCmdCopyImageToBuffer(command_buffer, _vk_swapchain_images[image_index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, frame._vk_readback_buffer, 1, &image_copy);
 
-		if (vkCreateShaderModule(_vk_logical_device, &create_info, nullptr, &shader_module) != VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed To Create Shader Module!");
-		}
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = frame._vk_readback_buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
 
-		return shader_module;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
 	}
 
-	void LoadModel()
+	// every slice records a contiguous part of the draw list on one of the recording threads - slice i only
+	// ever uses the frame's pool i, so no pool is touched by two threads at once
+	void RecordSecondaryCommandBuffers(uint32_t frame_index)
 	{
-		tinyobj::attrib_t attribute;
-		std::vector<tinyobj::shape_t> shapes;
-		std::vector<tinyobj::material_t> materials;
-		std::string error;
+		FrameData& frame = _frames[frame_index];
+		uint32_t slice_count = static_cast<uint32_t>(frame._secondary_command_buffers.size());
+		uint32_t draw_count = DrawCount();
+		std::vector<VkResult> results(slice_count);
 
-		if (!tinyobj::LoadObj(&attribute, &shapes, &materials, &error, "Models/type-99.obj"))
+		_p_record_pool->ParallelFor(slice_count, [this, &frame, &results, frame_index, slice_count, draw_count](uint32_t slice)
 		{
-			throw std::runtime_error(error);
-		}
+			// the frame's fence has signaled, so nothing recorded from this pool is still pending
+			vkResetCommandPool(_vk_logical_device, frame._vk_secondary_command_pools[slice], 0);
 
-		std::unordered_map<Vertex, uint32_t> unique_vertices = {};
+			VkCommandBufferInheritanceInfo inheritance_info = {};
+			inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+			inheritance_info.renderPass = _vk_render_pass;
+			inheritance_info.subpass = 0;
+			// left unknown so one recording serves every swapchain image
+			inheritance_info.framebuffer = VK_NULL_HANDLE;
 
-		for (const auto& shape : shapes)
-		{
-			for (const auto& index : shape.mesh.indices)
-			{
-				Vertex vert = {};
+			VkCommandBufferBeginInfo begin_info = {};
+			begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			begin_info.pInheritanceInfo = &inheritance_info;
 
-				vert.pos =
-				{
-					attribute.vertices[3 * index.vertex_index + 0],
-					attribute.vertices[3 * index.vertex_index + 1],
-					attribute.vertices[3 * index.vertex_index + 2]
-				};
+			VkCommandBuffer command_buffer = frame._secondary_command_buffers[slice];
+			uint32_t first_draw = static_cast<uint32_t>(static_cast<uint64_t>(draw_count) * slice / slice_count);
+			uint32_t end_draw = static_cast<uint32_t>(static_cast<uint64_t>(draw_count) * (slice + 1) / slice_count);
 
-				vert.uv =
-				{
-					attribute.texcoords[2 * index.texcoord_index + 0],
-					1 - attribute.texcoords[2 * index.texcoord_index + 1]
-				};
+			vkBeginCommandBuffer(command_buffer, &begin_info);
 
-				vert.color = { 1.0f, 1.0f, 1.0f };
+			// secondaries inherit no state, every slice binds its own
+			BindDrawState(command_buffer, frame_index);
+			RecordDraws(command_buffer, frame_index, first_draw, end_draw - first_draw);
 
-				if (unique_vertices.count(vert) == 0)
-				{
-					unique_vertices[vert] = static_cast<uint32_t>(_vertices.size());
-					_vertices.push_back(vert);
-				}
+			// a throw would end the worker thread, the render thread reports it instead
+			results[slice] = vkEndCommandBuffer(command_buffer);
+		});
 
-				_indices.push_back(unique_vertices[vert]);
+		for (VkResult result : results)
+		{
+			if (result != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed To Record Secondary Command Buffer!");
 			}
 		}
 	}
 
-	static std::vector<char> ReadFile(const std::string & filename)
+	void BindDrawState(VkCommandBuffer command_buffer, uint32_t frame_index)
 	{
-		std::ifstream file(filename, std::ios::ate | std::ios::binary);
+		VkBuffer vertex_buffers[] = { _vk_vertex_buffer };
+		VkDeviceSize offsets[] = {0};
 
-		if (!file.is_open())
+		// dynamic state is not inherited by secondaries, every command buffer that draws sets it
+		VkViewport viewport = {};
+		viewport.width = static_cast<float>(_vk_swapchain_extent.width);
+		viewport.height = static_cast<float>(_vk_swapchain_extent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+
+		VkRect2D scissor_rect = {};
+		scissor_rect.extent = _vk_swapchain_extent;
+
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _vk_pipeline);
+		vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+		vkCmdSetScissor(command_buffer, 0, 1, &scissor_rect);
+		vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
+		vkCmdBindIndexBuffer(command_buffer, _vk_index_buffer, 0, VK_INDEX_TYPE_UINT16);
+		// the model ubo is the first allocation of its frame, see UpdateUniformBuffer
+		// the frame's buffers and its texture table in one bind, draws only select textures through instance data
+		uint32_t dynamic_offset = _uniform_ring.FrameOffset(frame_index);
+		VkDescriptorSet descriptor_sets[] = { _frames[frame_index]._descriptor_set, _texture_table.Set(frame_index) };
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _vk_pipeline_layout, 0, 2, descriptor_sets, 1, &dynamic_offset);
+
+		// fixed for the mesh, so pre-recorded command buffers can keep them
+		DrawConstants constants = {};
+		constants.position_scale = glm::make_vec4(_vertex_dequantization._position_scale);
+		constants.position_offset = glm::make_vec4(_vertex_dequantization._position_offset);
+		constants.texcoord_transform = glm::make_vec4(_vertex_dequantization._texcoord_transform);
+		vkCmdPushConstants(command_buffer, _vk_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+	}
+
+	// indirect draws when the gpu culls - one per submesh, or a single one with multiDrawIndirect - the draw list otherwise
+	uint32_t DrawCount() const
+	{
+		if (_settings._culling == CullingMode::Gpu)
 		{
-			throw std::runtime_error("Failed To Open File!");
+			return _multi_draw_indirect ? 1 : static_cast<uint32_t>(_submeshes.size());
 		}
 
-		size_t file_size = static_cast<size_t>(file.tellg());
-		std::vector<char> buffer(file_size);
+		return static_cast<uint32_t>(_draw_list.size());
+	}
 
-		file.seekg(0);
-		file.read(buffer.data(), file_size);
+	// draws [first_draw, first_draw + draw_count) of DrawCount
+	void RecordDraws(VkCommandBuffer command_buffer, uint32_t frame_index, uint32_t first_draw, uint32_t draw_count)
+	{
+		if (_settings._culling == CullingMode::Gpu)
+		{
+			// the cull pass filled in the instance counts
+			VkBuffer draw_command_buffer = _frames[frame_index]._vk_draw_command_buffer;
+			uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+			uint32_t commands_per_draw = _multi_draw_indirect ? static_cast<uint32_t>(_submeshes.size()) : 1;
 
-		file.close();
+			for (uint32_t draw = first_draw; draw < first_draw + draw_count; ++draw)
+			{
+				vkCmdDrawIndexedIndirect(command_buffer, draw_command_buffer, draw * stride, commands_per_draw, stride);
+			}
+			return;
+		}
 
-		return buffer;
+		for (uint32_t draw = first_draw; draw < first_draw + draw_count; ++draw)
+		{
+			const VkDrawIndexedIndirectCommand& command = _draw_list[draw];
+			vkCmdDrawIndexed(command_buffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+		}
 	}
 
-	static VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(
-		VkDebugReportFlagsEXT flags,
-		VkDebugReportObjectTypeEXT obj_type,
-		uint64_t obj,
-		uint32_t location,
-		int32_t code,
-		const char* layer_prefix,
-		const char* msg,
-		void* user_data
-	)
+	// one instanced draw per run of visible instances of a 16 bit addressable submesh, most meshes have exactly one
+	// gl_InstanceIndex includes firstInstance, so every run and the per instance baseline read the same buffer
+	void BuildDrawList()
 	{
-		std::cerr << "Validation Layer: " << msg << std::endl;
+		_draw_list.clear();
 
-		return VK_FALSE;
-	}
-	
-	// BEGIN PRIVATE MEMBERS
-	VkInstance _vk_instance;
+		for (const InstanceRange& range : _draw_ranges)
+		{
+			const Submesh& submesh = _submeshes[range._submesh];
+
+			if (_settings._instanced_draws)
+			{
+				_draw_list.push_back({ submesh._index_count, range._instance_count, submesh._first_index, submesh._vertex_offset, range._first_instance });
+				continue;
+			}
+
+			for (uint32_t instance = range._first_instance; instance < range._first_instance + range._instance_count; ++instance)
+			{
+				_draw_list.push_back({ submesh._index_count, 1, submesh._first_index, submesh._vertex_offset, instance });
+			}
+		}
+	}
+
+	// one pool per recording thread and frame in flight, each with a single secondary command buffer
+	void CreateRecordingResources()
+	{
+		if (_settings._record_threads == 0)
+		{
+			return;
+		}
+
+		_p_record_pool.reset(new ThreadPool(_settings._record_threads));
+
+		VkCommandPoolCreateInfo pool_create_info = {};
+		pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		// reset as a whole every frame
+		pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		pool_create_info.queueFamilyIndex = _available_queue_families._graphics_family;
+
+		for (FrameData& frame : _frames)
+		{
+			frame._vk_secondary_command_pools.resize(_settings._record_threads);
+			frame._secondary_command_buffers.resize(_settings._record_threads);
+
+			for (uint32_t slice = 0; slice < _settings._record_threads; ++slice)
+			{
+				if (vkCreateCommandPool(_vk_logical_device, &pool_create_info, nullptr, &frame._vk_secondary_command_pools[slice]) != VK_SUCCESS)
+				{
+					throw std::runtime_error("Failed To Create Recording Command Pool!");
+				}
+
+				VkCommandBufferAllocateInfo alloc_info = {};
+				alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				alloc_info.commandPool = frame._vk_secondary_command_pools[slice];
+				alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+				alloc_info.commandBufferCount = 1;
+
+				if (vkAllocateCommandBuffers(_vk_logical_device, &alloc_info, &frame._secondary_command_buffers[slice]) != VK_SUCCESS)
+				{
+					throw std::runtime_error("Failed To Allocate Secondary Command Buffers!");
+				}
+			}
+		}
+	}
+
+	// resets the frame's indirect commands from the template, then culls every submesh of every instance into them
+	void RecordCullPass(VkCommandBuffer command_buffer, uint32_t frame_index)
+	{
+		const FrameData& frame = _frames[frame_index];
+		uint32_t instance_count = std::max(1u, _settings._instance_count);
+		uint32_t object_count = instance_count * static_cast<uint32_t>(_submeshes.size());
+
+		VkBufferCopy copy_region = {};
+		copy_region.size = sizeof(VkDrawIndexedIndirectCommand) * _submeshes.size();
+		vkCmdCopyBuffer(command_buffer, _vk_draw_command_template, frame._vk_draw_command_buffer, 1, &copy_region);
+
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		// frustum planes come from the same ubo region as the frame's matrices
+		uint32_t dynamic_offset = _uniform_ring.FrameOffset(frame_index);
+		uint32_t constants[] = { instance_count, object_count };
+
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _vk_cull_pipeline);
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _vk_cull_pipeline_layout, 0, 1, &frame._cull_descriptor_set, 1, &dynamic_offset);
+		vkCmdPushConstants(command_buffer, _vk_cull_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), constants);
+		vkCmdDispatch(command_buffer, (object_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+		// the draws read the commands and indices, the cpu reads the instance counts once the frame's fence signals
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	void CreateTimestampQueryPool()
+	{
+		if (_settings._profile_output.empty())
+		{
+			return;
+		}
+
+		VkPhysicalDeviceProperties device_properties;
+		vkGetPhysicalDeviceProperties(_vk_physical_device, &device_properties);
+
+		uint32_t queue_family_num = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(_vk_physical_device, &queue_family_num, nullptr);
+		std::vector<VkQueueFamilyProperties> queue_families(queue_family_num);
+		vkGetPhysicalDeviceQueueFamilyProperties(_vk_physical_device, &queue_family_num, queue_families.data());
+
+		// cpu timings still work without gpu timestamps
+		if (queue_families[_available_queue_families._graphics_family].timestampValidBits == 0)
+		{
+			std::cerr << "Profiler: graphics queue has no timestamp support, gpu timings disabled" << std::endl;
+			return;
+		}
+
+		_timestamp_period = device_properties.limits.timestampPeriod;
+
+		VkQueryPoolCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		create_info.queryCount = static_cast<uint32_t>(_frames.size()) * 2;
+
+		if (vkCreateQueryPool(_vk_logical_device, &create_info, nullptr, &_vk_timestamp_query_pool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Timestamp Query Pool!");
+		}
+	}
+
+	// only valid once the fence of frame_slot has signaled - the submission that wrote the queries has completed, so
+	// waiting for them never blocks, it only rules out VK_NOT_READY silently dropping a sample
+	void ResolveGpuTimestamps(uint32_t frame_slot)
+	{
+		if (!_profiler.Enabled() || _vk_timestamp_query_pool == VK_NULL_HANDLE || !_profiler.HasPending(frame_slot))
+		{
+			return;
+		}
+
+		uint64_t timestamps[2];
+		if (vkGetQueryPoolResults(_vk_logical_device, _vk_timestamp_query_pool, frame_slot * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Read GPU Timestamps!");
+		}
+
+		_profiler.ResolveGpu(frame_slot, timestamps[0], timestamps[1], _timestamp_period);
+		_statistics._gpu_seconds += (timestamps[1] - timestamps[0]) * static_cast<double>(_timestamp_period) * 1e-9;
+		++_statistics._gpu_frame_count;
+	}
+
+	void CreateSyncObjects()
+	{
+		VkSemaphoreCreateInfo semaphore_create_info = {};
+		semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		// fences start signaled so the first wait on each frame returns immediately
+		VkFenceCreateInfo fence_create_info = {};
+		fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+		for (auto& frame : _frames)
+		{
+			if (vkCreateSemaphore(_vk_logical_device, &semaphore_create_info, nullptr, &frame._image_available_semaphore) != VK_SUCCESS ||
+				vkCreateSemaphore(_vk_logical_device, &semaphore_create_info, nullptr, &frame._render_finished_semaphore) != VK_SUCCESS ||
+				vkCreateFence(_vk_logical_device, &fence_create_info, nullptr, &frame._in_flight_fence) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed To Create Frame Sync Objects!");
+			}
+		}
+	}
+
+	// only call once the fence of frame_index has signaled, the frame's ring region is rewound
+	void UpdateUniformBuffer(uint32_t frame_index)
+	{
+		static auto start_time = std::chrono::high_resolution_clock::now();
+
+		auto current_time = std::chrono::high_resolution_clock::now();
+		float time = std::chrono::duration<float, std::chrono::seconds::period>(current_time - start_time).count();
+
+		UniformBufferObject ubo = {};
+		ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(20.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		ubo.view = glm::lookAt(glm::vec3(0.0f, 7.0f, 15.0f) * _instance_view_scale, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		ubo.proj = glm::perspective(glm::radians(45.0f), _vk_swapchain_extent.width / static_cast<float>(_vk_swapchain_extent.height), 0.1f, 100.0f * _instance_view_scale);
+		ubo.proj[1][1] *= -1;
+
+		glm::mat4 view_proj_model = ubo.proj * ubo.view * ubo.model;
+
+		_cull_frustum = Frustum::FromMatrix(glm::value_ptr(view_proj_model));
+		memcpy(ubo.frustum_planes, _cull_frustum._planes, sizeof(ubo.frustum_planes));
+
+		_uniform_ring.BeginFrame(frame_index);
+		_uniform_ring.Push(ubo);
+
+		if (_settings._cpu_transforms)
+		{
+			UpdateTransforms(frame_index, view_proj_model);
+		}
+	}
+
+	// every instance's full mvp into the frame's transform buffer, so a vertex costs one matrix instead of four
+	// the mapped memory may be write combined - the kernel only ever stores to it, in order
+	void UpdateTransforms(uint32_t frame_index, const glm::mat4& view_proj_model)
+	{
+		auto transform_start = std::chrono::high_resolution_clock::now();
+
+		MatrixBatch::Multiply(glm::value_ptr(view_proj_model), glm::value_ptr(_instance_models[0]), static_cast<float*>(_frames[frame_index]._transform_allocation._p_mapped),
+			_instance_models.size());
+
+		_statistics._transform_seconds += std::chrono::duration<double, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - transform_start).count();
+	}
+
+	void Draw()
+	{
+		FrameData& frame = _frames[_current_frame];
+
+		if (_profiler.Enabled())
+		{
+			_profiler.BeginFrame(_statistics._frame_count);
+		}
+
+		// wait only for the frame that last used this slot - the others keep the gpu busy
+		{
+			ScopedCpuTimer timer(_profiler, ProfileStage::FrameWait);
+			vkWaitForFences(_vk_logical_device, 1, &frame._in_flight_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		}
+
+		_completed_submission = std::max(_completed_submission, frame._submission);
+		DestroyRetiredSwapchains(_completed_submission);
+
+		// however many resize events arrived since the last frame, the swapchain is rebuilt once
+		if (_swapchain_resize_pending)
+		{
+			RecreateSwapChain();
+
+			if (_swapchain_resize_pending)
+			{
+				return;
+			}
+		}
+
+		ResolveGpuTimestamps(_current_frame);
+		ReadGpuCullResults(_current_frame);
+		_upload_manager.Collect();
+		StreamTextures(_current_frame);
+		UpdatePipelines(_current_frame);
+		
+		uint32_t image_index;
+		VkResult result;
+		{
+			ScopedCpuTimer timer(_profiler, ProfileStage::Acquire);
+			result = vkAcquireNextImageKHR(_vk_logical_device, _vk_swapchain, std::numeric_limits<uint64_t>::max(), frame._image_available_semaphore, VK_NULL_HANDLE, &image_index);
+		}
+		
+		// nothing was acquired, the next frame rebuilds before trying again
+		if (result == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			_swapchain_resize_pending = true;
+			return;
+		}
+		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+		{
+			throw std::runtime_error("Failed To Acquire Swapchain Image!");
+		}
+
+		{
+			ScopedCpuTimer timer(_profiler, ProfileStage::UniformUpdate);
+			UpdateUniformBuffer(_current_frame);
+		}
+
+		if (_settings._culling == CullingMode::Cpu)
+		{
+			ScopedCpuTimer timer(_profiler, ProfileStage::Cull);
+			CullScene();
+		}
+
+		if (PerFrameRecording())
+		{
+			ScopedCpuTimer timer(_profiler, ProfileStage::Record);
+			auto record_start = std::chrono::high_resolution_clock::now();
+			RecordFrame(_current_frame, image_index);
+			_statistics._record_seconds += std::chrono::duration<double, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - record_start).count();
+		}
+
+		VkSemaphore wait_semaphores[] = { frame._image_available_semaphore };
+		VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+		VkSemaphore signal_semaphores[] = { frame._render_finished_semaphore };
+
+		VkSubmitInfo submit_info= {};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.waitSemaphoreCount = 1;
+		submit_info.pWaitSemaphores = wait_semaphores;
+		submit_info.pWaitDstStageMask = wait_stages;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &FrameCommandBuffer(_current_frame, image_index);
+		submit_info.signalSemaphoreCount = 1;
+		submit_info.pSignalSemaphores = signal_semaphores;
+
+		vkResetFences(_vk_logical_device, 1, &frame._in_flight_fence);
+
+		{
+			ScopedCpuTimer timer(_profiler, ProfileStage::Submit);
+			if (vkQueueSubmit(_vk_graphics_queue, 1, &submit_info, frame._in_flight_fence) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed To Submit Draw Command Buffer!");
+			}
+		}
+
+		frame._submission = ++_submission_serial;
+
+		VkSwapchainKHR swapchains[] = { _vk_swapchain };
+
+		VkPresentInfoKHR present_info = {};
+		present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		present_info.waitSemaphoreCount = 1;
+		present_info.pWaitSemaphores = signal_semaphores;
+		present_info.swapchainCount = 1;
+		present_info.pSwapchains = swapchains;
+		present_info.pImageIndices = &image_index;
+
+		{
+			ScopedCpuTimer timer(_profiler, ProfileStage::Present);
+			result = vkQueuePresentKHR(_vk_present_queue, &present_info);
+		}
+
+		if (_profiler.Enabled())
+		{
+			_profiler.EndFrame(_current_frame, _vk_timestamp_query_pool != VK_NULL_HANDLE);
+		}
+
+		_current_frame = (_current_frame + 1) % static_cast<uint32_t>(_frames.size());
+
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+		{
+			_swapchain_resize_pending = true;
+		}
+		else if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Present Swapchain Image!");
+		}
+	}
+
+	void DrawOffscreen()
+	{
+		FrameData& frame = _frames[_current_frame];
+
+		if (_profiler.Enabled())
+		{
+			_profiler.BeginFrame(_statistics._frame_count);
+		}
+
+		{
+			ScopedCpuTimer timer(_profiler, ProfileStage::FrameWait);
+			vkWaitForFences(_vk_logical_device, 1, &frame._in_flight_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		}
+
+		ResolveGpuTimestamps(_current_frame);
+		WriteReadback(_current_frame);
+		ReadGpuCullResults(_current_frame);
+		_upload_manager.Collect();
+		StreamTextures(_current_frame);
+		UpdatePipelines(_current_frame);
+
+		// each frame slot owns its offscreen image, so nothing needs to be acquired
+		uint32_t image_index = _current_frame;
+
+		{
+			ScopedCpuTimer timer(_profiler, ProfileStage::UniformUpdate);
+			UpdateUniformBuffer(_current_frame);
+		}
+
+		if (_settings._culling == CullingMode::Cpu)
+		{
+			ScopedCpuTimer timer(_profiler, ProfileStage::Cull);
+			CullScene();
+		}
+
+		if (PerFrameRecording())
+		{
+			ScopedCpuTimer timer(_profiler, ProfileStage::Record);
+			auto record_start = std::chrono::high_resolution_clock::now();
+			RecordFrame(_current_frame, image_index);
+			_statistics._record_seconds += std::chrono::duration<double, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - record_start).count();
+		}
+
+		VkSubmitInfo submit_info = {};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &FrameCommandBuffer(_current_frame, image_index);
+
+		vkResetFences(_vk_logical_device, 1, &frame._in_flight_fence);
+
+		{
+			ScopedCpuTimer timer(_profiler, ProfileStage::Submit);
+			if (vkQueueSubmit(_vk_graphics_queue, 1, &submit_info, frame._in_flight_fence) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed To Submit Draw Command Buffer!");
+			}
+		}
+
+		frame._submission = ++_submission_serial;
+
+		if (frame._vk_readback_buffer != VK_NULL_HANDLE)
+		{
+			frame._readback_frame = _statistics._frame_count;
+		}
+
+		if (_profiler.Enabled())
+		{
+			_profiler.EndFrame(_current_frame, _vk_timestamp_query_pool != VK_NULL_HANDLE);
+		}
+
+		_current_frame = (_current_frame + 1) % static_cast<uint32_t>(_frames.size());
+	}
+
+	// headless readback only - every frame's command buffer copies its image into one of these, so the copies
+	// run with the frames instead of stalling the cpu on each of them
+	void CreateReadbackBuffers()
+	{
+		if (!_settings._headless || _settings._readback_directory.empty())
+		{
+			return;
+		}
+
+		VkDeviceSize image_size = static_cast<VkDeviceSize>(_vk_swapchain_extent.width) * _vk_swapchain_extent.height * 4;
+
+		for (FrameData& frame : _frames)
+		{
+			CreateBuffer(image_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				frame._vk_readback_buffer, frame._readback_allocation);
+		}
+	}
+
+	// only call once the fence of frame_index has signaled - writes the image its last submission copied back
+	// as a binary ppm
+	void WriteReadback(uint32_t frame_index)
+	{
+		FrameData& frame = _frames[frame_index];
+
+		if (frame._readback_frame == UINT64_MAX)
+		{
+			return;
+		}
+
+		uint32_t width = _vk_swapchain_extent.width;
+		uint32_t height = _vk_swapchain_extent.height;
+
+		char filename[64];
+		snprintf(filename, sizeof(filename), "/frame_%05llu.ppm", static_cast<unsigned long long>(frame._readback_frame));
+		frame._readback_frame = UINT64_MAX;
+
+		std::ofstream file(_settings._readback_directory + filename, std::ios::binary);
+		if (!file.is_open())
+		{
+			throw std::runtime_error("Failed To Open Readback File!");
+		}
+
+		file << "P6\n" << width << " " << height << "\n255\n";
+
+		const uint8_t* p_pixels = static_cast<const uint8_t*>(frame._readback_allocation._p_mapped);
+		std::vector<uint8_t> row(width * 3);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				const uint8_t* p_texel = p_pixels + (y * width + x) * 4;
+				row[x * 3 + 0] = p_texel[0];
+				row[x * 3 + 1] = p_texel[1];
+				row[x * 3 + 2] = p_texel[2];
+			}
+
+			file.write(reinterpret_cast<const char*>(row.data()), row.size());
+		}
+	}
+
+	VkSampleCountFlagBits ClampSampleCount(VkSampleCountFlagBits requested)
+	{
+		VkPhysicalDeviceProperties device_properties;
+		vkGetPhysicalDeviceProperties(_vk_physical_device, &device_properties);
+
+		VkSampleCountFlags supported = device_properties.limits.framebufferColorSampleCounts & device_properties.limits.framebufferDepthSampleCounts;
+
+		// step down until the device supports the count, 1 sample is always available
+		uint32_t samples = static_cast<uint32_t>(requested);
+		while (samples > 1 && (supported & samples) == 0)
+		{
+			samples >>= 1;
+		}
+
+		return static_cast<VkSampleCountFlagBits>(samples);
+	}
+
+	int TestPhysicalDevice(VkPhysicalDevice device)
+	{
+		bool swap_chain_supported = false;
+
+		// the fragment shader indexes the texture table with a per instance value, even without descriptor indexing
+		VkPhysicalDeviceFeatures device_features;
+		vkGetPhysicalDeviceFeatures(device, &device_features);
+
+		if (CheckExtensions(device) && device_features.shaderSampledImageArrayDynamicIndexing == VK_TRUE)
+		{
+			VkPhysicalDeviceProperties device_properties;
+			vkGetPhysicalDeviceProperties(device, &device_properties);
+
+			// other optional features are enabled in CreateLogicalDevice when present, none rule a device out
+			if (_settings._headless)
+			{
+				// nothing is presented, so there is no surface to check against
+				swap_chain_supported = true;
+			}
+			else
+			{
+				SwapChainSupport swap_chain_support = CheckSwapChainSupport(device);
+
+				swap_chain_supported = !swap_chain_support._formats.empty() && !swap_chain_support._present_modes.empty();
+			}
+		}
+
+		return swap_chain_supported;
+	}
+
+	bool HasDeviceExtension(VkPhysicalDevice device, const char* name)
+	{
+		uint32_t extension_num;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_num, nullptr);
+		std::vector<VkExtensionProperties> extensions(extension_num);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_num, extensions.data());
+
+		for (const VkExtensionProperties& properties : extensions)
+		{
+			if (strcmp(properties.extensionName, name) == 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// the texture table is partially bound and written after bind when this holds, capacity is clamped to the
+	// update after bind limits - otherwise it stays at the fallback capacity
+	bool SupportsDescriptorIndexing(uint32_t& capacity)
+	{
+		capacity = TEXTURE_TABLE_FALLBACK_CAPACITY;
+
+		if (!_physical_device_properties2 || !HasDeviceExtension(_vk_physical_device, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) ||
+			!HasDeviceExtension(_vk_physical_device, VK_KHR_MAINTENANCE3_EXTENSION_NAME))
+		{
+			return false;
+		}
+
+		auto get_features2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(_vk_instance, "vkGetPhysicalDeviceFeatures2KHR");
+		auto get_properties2 = (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(_vk_instance, "vkGetPhysicalDeviceProperties2KHR");
+
+		if (get_features2 == nullptr || get_properties2 == nullptr)
+		{
+			return false;
+		}
+
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexing_features = {};
+		indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+		VkPhysicalDeviceFeatures2KHR features = {};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+		features.pNext = &indexing_features;
+
+		get_features2(_vk_physical_device, &features);
+
+		if (indexing_features.shaderSampledImageArrayNonUniformIndexing != VK_TRUE || indexing_features.descriptorBindingSampledImageUpdateAfterBind != VK_TRUE ||
+			indexing_features.descriptorBindingUpdateUnusedWhilePending != VK_TRUE || indexing_features.descriptorBindingPartiallyBound != VK_TRUE)
+		{
+			return false;
+		}
+
+		VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexing_properties = {};
+		indexing_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+		VkPhysicalDeviceProperties2KHR properties = {};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+		properties.pNext = &indexing_properties;
+
+		get_properties2(_vk_physical_device, &properties);
+
+		capacity = std::min({ TEXTURE_TABLE_CAPACITY, indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+			indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages, indexing_properties.maxDescriptorSetUpdateAfterBindSamplers,
+			indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages });
+
+		return true;
+	}
+
+	bool CheckExtensions(VkPhysicalDevice device)
+	{
+		bool ret_val = true;
+		
+		uint32_t extension_num;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_num, nullptr);
+		std::vector<VkExtensionProperties> extensions(extension_num);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_num, extensions.data());
+		
+		for (const char* name : RequiredDeviceExtensions())
+		{
+			bool found = false;
+
+			for (VkExtensionProperties properties : extensions)
+			{
+				if (strncmp(properties.extensionName, name, strlen(properties.extensionName)) == 0)
+				{
+					found = true;
+					break;
+				}
+			}
+
+			if (!found)
+			{
+				ret_val = false;
+				break;
+			}
+		}
+
+		return ret_val;
+	}
+
+	bool CheckValidationLayers()
+	{
+		bool ret_val = true;
+		uint32_t layer_num;
+		vkEnumerateInstanceLayerProperties(&layer_num, nullptr);
+		std::vector<VkLayerProperties> layers(layer_num);
+		vkEnumerateInstanceLayerProperties(&layer_num, layers.data());
+
+		for (const char* layer_name : VALIDATION_LAYERS)
+		{
+			bool layer_found = false;
+
+			for (const auto& layer : layers)
+			{
+				if (strncmp(layer_name, layer.layerName, strlen(layer_name)) == 0)
+				{
+					layer_found = true;
+					break;
+				}
+			}
+
+			if (!layer_found)
+			{
+				ret_val = false;
+				break;
+			}
+		}
+
+		return ret_val;
+	}
+
+	QueueFamilies CheckQueueFamilies(VkPhysicalDevice device)
+	{
+		QueueFamilies queue_family_data;
+
+		// get physical device queue families to use
+		uint32_t queue_family_num = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(_vk_physical_device, &queue_family_num, nullptr);
+
+		std::vector<VkQueueFamilyProperties> queue_families(queue_family_num);
+		vkGetPhysicalDeviceQueueFamilyProperties(_vk_physical_device, &queue_family_num, queue_families.data());
+
+		for (uint32_t i = 0; i < queue_families.size(); ++i)
+		{
+			if (queue_families[i].queueCount > 0 && queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+			{
+				queue_family_data._graphics_family = i;
+			}
+
+			VkBool32 present_support = false;
+			if (!_settings._headless)
+			{
+				vkGetPhysicalDeviceSurfaceSupportKHR(_vk_physical_device, i, _vk_surface, &present_support);
+			}
+
+			if (queue_families[i].queueCount > 0 && present_support)
+			{
+				queue_family_data._present_family = i;
+			}
+
+			// prefer a pure transfer family (dma engine) over one that also does compute
+			bool transfer_only = queue_families[i].queueCount > 0 && (queue_families[i].queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT);
+			bool has_compute = (queue_families[i].queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+
+			if (transfer_only && (queue_family_data._transfer_family < 0 || (!has_compute && (queue_families[queue_family_data._transfer_family].queueFlags & VK_QUEUE_COMPUTE_BIT))))
+			{
+				queue_family_data._transfer_family = i;
+			}
+		}
+
+		// graphics queues always support transfers
+		if (queue_family_data._transfer_family < 0)
+		{
+			queue_family_data._transfer_family = queue_family_data._graphics_family;
+		}
+
+		// headless frames never leave the graphics queue
+		if (_settings._headless)
+		{
+			queue_family_data._present_family = queue_family_data._graphics_family;
+		}
+
+		if (!queue_family_data.QueuesAquired())
+		{
+			throw std::runtime_error("Required Queues Unavailable!");
+		}
+
+		return queue_family_data;
+	}
+
+	SwapChainSupport CheckSwapChainSupport(VkPhysicalDevice device)
+	{
+		SwapChainSupport support;
+
+		vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, _vk_surface, &support._capabilities);
+		
+		uint32_t format_num;
+		vkGetPhysicalDeviceSurfaceFormatsKHR(device, _vk_surface, &format_num, nullptr);
+		if (format_num != 0)
+		{
+			support._formats.resize(format_num);
+			vkGetPhysicalDeviceSurfaceFormatsKHR(device, _vk_surface, &format_num, support._formats.data());
+		}
+
+		uint32_t present_mode_num;
+		vkGetPhysicalDeviceSurfacePresentModesKHR(device, _vk_surface, &present_mode_num, nullptr);
+		if (present_mode_num != 0)
+		{
+			support._present_modes.resize(present_mode_num);
+			vkGetPhysicalDeviceSurfacePresentModesKHR(device, _vk_surface, &present_mode_num, support._present_modes.data());
+		}
+
+		return support;
+	}
+
+	VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> & available_formats)
+	{
+		VkSurfaceFormatKHR ret_val;
+
+		// check for no preferred format
+		if (available_formats.size() == 1 && available_formats[0].format == VK_FORMAT_UNDEFINED)
+		{
+			ret_val = { VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+		}
+		else
+		{
+			// default to first option
+			ret_val = available_formats[0];
+
+			// try to find ideal option
+			for (const auto & format : available_formats)
+			{
+				if (format.format == VK_FORMAT_B8G8R8A8_UNORM && format.colorSpace == VK_COLORSPACE_SRGB_NONLINEAR_KHR)
+				{
+					ret_val = format;
+				}
+			}
+		}
+
+		return ret_val;
+	}
+
+	VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR> available_modes)
+	{
+		// defualt to single guaranteed mode
+		VkPresentModeKHR ret_val = VK_PRESENT_MODE_FIFO_KHR;
+
+		// test for other modes
+		for (const auto & mode : available_modes)
+		{
+			// best mode
+			if (mode == VK_PRESENT_MODE_MAILBOX_KHR)
+			{
+				ret_val = mode;
+				break;
+			}
+			else if(mode == VK_PRESENT_MODE_IMMEDIATE_KHR)
+			{
+				ret_val = mode;
+			}
+		}
+
+		return ret_val;
+	}
+	
+	VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR & capabilities)
+	{
+		VkExtent2D ret_val = capabilities.currentExtent;
+
+		if (capabilities.currentExtent.width == std::numeric_limits<uint32_t>::max())
+		{
+			int width, height;
+			WindowFramebufferSize(width, height);
+			ret_val = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+
+			if (ret_val.width < capabilities.minImageExtent.width)
+			{
+				ret_val.width = capabilities.minImageExtent.width;
+			}
+			else if (ret_val.width > capabilities.maxImageExtent.width)
+			{
+				ret_val.width = capabilities.maxImageExtent.width;
+			}
+
+			if (ret_val.height < capabilities.minImageExtent.height)
+			{
+				ret_val.height = capabilities.minImageExtent.height;
+			}
+			else if (ret_val.height > capabilities.maxImageExtent.height)
+			{
+				ret_val.height = capabilities.maxImageExtent.height;
+			}
+		}
+
+		return ret_val;
+	}
+
+	void CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkSampleCountFlagBits samples, VkMemoryPropertyFlags mem_properties, VkImage& image, GpuAllocation& image_allocation, bool dedicated = false, uint32_t mip_levels = 1)
+	{
+		VkImageCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		create_info.imageType = VK_IMAGE_TYPE_2D;
+		create_info.extent.width = width;
+		create_info.extent.height = height;
+		create_info.extent.depth = 1;
+		create_info.mipLevels = mip_levels;
+		create_info.arrayLayers = 1;
+		create_info.format = format;
+		create_info.tiling = tiling;
+		create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		create_info.usage = usage;
+		create_info.samples = samples;
+		create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateImage(_vk_logical_device, &create_info, nullptr, &image) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Image!");
+		}
+
+		VkMemoryRequirements mem_requirements;
+		vkGetImageMemoryRequirements(_vk_logical_device, image, &mem_requirements);
+
+		ResourceKind kind = tiling == VK_IMAGE_TILING_LINEAR ? ResourceKind::Linear : ResourceKind::Optimal;
+		image_allocation = _memory_allocator.Allocate(mem_requirements, mem_properties, kind, dedicated);
+
+		vkBindImageMemory(_vk_logical_device, image, image_allocation._memory, image_allocation._offset);
+	}
+
+	VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect_flags, uint32_t mip_levels = 1)
+	{
+		VkImageViewCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		create_info.image = image;
+		create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		create_info.format = format;
+		create_info.subresourceRange.aspectMask = aspect_flags;
+		create_info.subresourceRange.baseMipLevel = 0;
+		create_info.subresourceRange.levelCount = mip_levels;
+		create_info.subresourceRange.baseArrayLayer = 0;
+		create_info.subresourceRange.layerCount = 1;
+
+		VkImageView image_view;
+		if (vkCreateImageView(_vk_logical_device, &create_info, nullptr, &image_view) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Texture Image View!");
+		}
+
+		return image_view;
+	}
+
+	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, GpuAllocation& buffer_allocation)
+	{
+		VkBufferCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		create_info.size = size;
+		create_info.usage = usage;
+		create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateBuffer(_vk_logical_device, &create_info, nullptr, &buffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed To Create Buffer!");
+		}
+
+		VkMemoryRequirements memory_requirements;
+		vkGetBufferMemoryRequirements(_vk_logical_device, buffer, &memory_requirements);
+
+		buffer_allocation = _memory_allocator.Allocate(memory_requirements, properties, ResourceKind::Linear);
+
+		vkBindBufferMemory(_vk_logical_device, buffer, buffer_allocation._memory, buffer_allocation._offset);
+	}
+
+	VkFormat FindSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
+	{
+		for (VkFormat format : candidates)
+		{
+			VkFormatProperties props;
+			vkGetPhysicalDeviceFormatProperties(_vk_physical_device, format, &props);
+
+			if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features)
+			{
+				return format;
+			}
+			else if (tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features)
+			{
+				return format;
+			}
+
+		}
+
+		throw std::runtime_error("Failed To Find Supported Format!");
+	}
+
+	std::vector<const char*> RequiredExtensions()
+	{
+		std::vector<const char*> ret_val;
+
+		// get required extensions - headless runs need no surface extensions
+		if (!_settings._headless)
+		{
+			AddWindowExtensions(ret_val);
+		}
+
+		// add validation layer extensions
+#ifndef NDEBUG
+		ret_val.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+#endif
+
+		// get available extensions
+		uint32_t extension_num = 0;
+		vkEnumerateInstanceExtensionProperties(nullptr, &extension_num, nullptr);
+		std::vector<VkExtensionProperties> extensions(extension_num);
+		vkEnumerateInstanceExtensionProperties(nullptr, &extension_num, extensions.data());
+
+		// validate that all required extensions are present
+		for (uint32_t i = 0; i < ret_val.size(); ++i)
+		{
+			VkResult vk_result = VkResult::VK_ERROR_EXTENSION_NOT_PRESENT;
+			for (const VkExtensionProperties& vk_ext : extensions)
+			{
+				if (strncmp(ret_val[i], vk_ext.extensionName, strlen(vk_ext.extensionName)) == 0)
+				{
+					vk_result = VkResult::VK_SUCCESS;
+					break;
+				}
+			}
+
+			if (vk_result == VkResult::VK_ERROR_EXTENSION_NOT_PRESENT)
+			{
+				throw std::runtime_error("Missing Required Extensions!");
+			}
+		}
+
+		// optional - the descriptor indexing features can only be queried through it on a 1.0 instance
+		for (const VkExtensionProperties& vk_ext : extensions)
+		{
+			if (strcmp(vk_ext.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0)
+			{
+				ret_val.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+				_physical_device_properties2 = true;
+				break;
+			}
+		}
+
+		return ret_val;
+	}
+
+	std::vector<const char*> RequiredDeviceExtensions()
+	{
+		std::vector<const char*> ret_val;
+
+		if (!_settings._headless)
+		{
+			ret_val.insert(ret_val.end(), DEVICE_EXTENSIONS.begin(), DEVICE_EXTENSIONS.end());
+		}
+
+		return ret_val;
+	}
+
+	// maps the cooked mesh when it matches the source, otherwise parses the obj and writes a new one
+	void LoadModel()
+	{
+		const std::string source_path = _settings._model_path;
+		const std::string cooked_path = source_path + ".cooked";
+
+		SourceFile source;
+		if (!source.Open(source_path))
+		{
+			throw std::runtime_error("Failed To Open Model File!");
+		}
+
+		if (_cooked_mesh.Open(cooked_path, source, VERTEX_FORMAT_VERSION, sizeof(Vertex)))
+		{
+			const CookedMeshHeader& header = _cooked_mesh.Header();
+			_p_mesh_vertices = static_cast<const Vertex*>(_cooked_mesh.VertexData());
+			_mesh_vertex_count = header._vertex_count;
+			_p_mesh_indices = _cooked_mesh.IndexData();
+			_mesh_index_count = header._index_count;
+			_submeshes.assign(_cooked_mesh.Submeshes(), _cooked_mesh.Submeshes() + header._submesh_count);
+			_mesh_bounds_min = glm::make_vec3(header._bounds_min);
+			_mesh_bounds_max = glm::make_vec3(header._bounds_max);
+			ComputeSubmeshBounds();
+			return;
+		}
+
+		CookModel(source_path);
+
+		_p_mesh_vertices = _vertices.data();
+		_mesh_vertex_count = static_cast<uint32_t>(_vertices.size());
+		_p_mesh_indices = _indices.data();
+		_mesh_index_count = static_cast<uint32_t>(_indices.size());
+
+		_mesh_bounds_min = glm::vec3(std::numeric_limits<float>::max());
+		_mesh_bounds_max = glm::vec3(-std::numeric_limits<float>::max());
+		for (const Vertex& vertex : _vertices)
+		{
+			_mesh_bounds_min = glm::min(_mesh_bounds_min, vertex.pos);
+			_mesh_bounds_max = glm::max(_mesh_bounds_max, vertex.pos);
+		}
+
+		ComputeSubmeshBounds();
+
+		// a read only asset directory only costs the next startup another parse
+		if (!CookedMesh::Write(cooked_path, source, VERTEX_FORMAT_VERSION, _vertices.data(), sizeof(Vertex), _mesh_vertex_count,
+			_indices.data(), _mesh_index_count, _submeshes.data(), static_cast<uint32_t>(_submeshes.size()), glm::value_ptr(_mesh_bounds_min), glm::value_ptr(_mesh_bounds_max)))
+		{
+			std::cerr << "Failed to write cooked mesh " << cooked_path << std::endl;
+		}
+	}
+
+	// every submesh owns a contiguous vertex range, so its bounds need no index walk
+	void ComputeSubmeshBounds()
+	{
+		_submesh_bounds.clear();
+		for (const Submesh& submesh : _submeshes)
+		{
+			glm::vec3 bounds_min(std::numeric_limits<float>::max());
+			glm::vec3 bounds_max(-std::numeric_limits<float>::max());
+			for (uint32_t i = 0; i < submesh._vertex_count; ++i)
+			{
+				bounds_min = glm::min(bounds_min, _p_mesh_vertices[submesh._vertex_offset + i].pos);
+				bounds_max = glm::max(bounds_max, _p_mesh_vertices[submesh._vertex_offset + i].pos);
+			}
+			_submesh_bounds.push_back(BoundingBox::FromMinMax(glm::value_ptr(bounds_min), glm::value_ptr(bounds_max)));
+		}
+	}
+
+	void CookModel(const std::string& source_path)
+	{
+		ObjMesh mesh = ObjLoader::Load(source_path, _thread_pool);
+		std::vector<uint32_t> indices;
+
+		auto MakeVertex = [&mesh](size_t corner)
+		{
+			return Vertex::FromObj(mesh, mesh._indices[corner]);
+		};
+
+		if (mesh._indices.size() >= PARALLEL_DEDUP_CORNERS && _thread_pool.ThreadCount() > 1)
+		{
+			VertexDeduplicator::DeduplicateParallel(mesh._indices.size(), MakeVertex, _thread_pool, _vertices, indices);
+		}
+		else
+		{
+			VertexDeduplicator::Deduplicate(mesh._indices.size(), MakeVertex, _vertices, indices);
+		}
+
+		// obj face order is arbitrary - reorder for the post-transform cache, then overdraw, then vertex fetch
+		VertexCacheStatistics before = MeshOptimizer::AnalyzeVertexCache(indices, _vertices.size());
+
+		std::vector<uint32_t> clusters;
+		MeshOptimizer::OptimizeVertexCache(indices, _vertices.size(), MeshOptimizer::DEFAULT_CACHE_SIZE, &clusters);
+
+		if (OVERDRAW_THRESHOLD > 0.0f)
+		{
+			const float* p_positions = reinterpret_cast<const float*>(reinterpret_cast<const char*>(_vertices.data()) + offsetof(Vertex, pos));
+			MeshOptimizer::OptimizeOverdraw(indices, p_positions, sizeof(Vertex), _vertices.size(), clusters, OVERDRAW_THRESHOLD);
+		}
+
+		MeshOptimizer::OptimizeVertexFetch(_vertices, indices);
+
+		VertexCacheStatistics after = MeshOptimizer::AnalyzeVertexCache(indices, _vertices.size());
+
+		// 16 bit indices halve the index buffer, meshes past 65536 vertices are drawn in several submeshes
+		MeshOptimizer::SplitSubmeshes(_vertices, indices, _indices, _submeshes);
+
+		std::cout << "cooked " << source_path << " | acmr " << before._acmr << " -> " << after._acmr
+			<< " | atvr " << before._atvr << " -> " << after._atvr << " | " << _submeshes.size() << " submeshes" << std::endl;
+	}
+
+	// the gpu buffers hold the mesh from here on, only counts and bounds are kept
+	void ReleaseMeshData()
+	{
+		_cooked_mesh.Close();
+		_vertices = std::vector<Vertex>();
+		_indices = std::vector<uint16_t>();
+		_p_mesh_vertices = nullptr;
+		_p_mesh_indices = nullptr;
+	}
+
+	static std::vector<char> ReadFile(const std::string & filename)
+	{
+		std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+		if (!file.is_open())
+		{
+			throw std::runtime_error("Failed To Open File!");
+		}
+
+		size_t file_size = static_cast<size_t>(file.tellg());
+		std::vector<char> buffer(file_size);
+
+		file.seekg(0);
+		file.read(buffer.data(), file_size);
+
+		file.close();
+
+		return buffer;
+	}
+
+	static VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(
+		VkDebugReportFlagsEXT flags,
+		VkDebugReportObjectTypeEXT obj_type,
+		uint64_t obj,
+		uint32_t location,
+		int32_t code,
+		const char* layer_prefix,
+		const char* msg,
+		void* user_data
+	)
+	{
+		std::cerr << "Validation Layer: " << msg << std::endl;
+
+		return VK_FALSE;
+	}
+	
+	// BEGIN PRIVATE MEMBERS
+	VkInstance _vk_instance;
 	VkDebugReportCallbackEXT _vk_callback;
 	VkSurfaceKHR _vk_surface;
 	VkPhysicalDevice _vk_physical_device = VK_NULL_HANDLE;	///< The vk device - IMPLICITLY DESTROYED WITH INSTANCE
 	VkDevice _vk_logical_device;
 
-	VkSwapchainKHR _vk_swapchain = VK_NULL_HANDLE;
-	std::vector<VkImage> _vk_swapchain_images;  ///< The swapchain images - OWNED BY SWAPCHAIN, DO NOT DESTROY
-	std::vector<VkImageView> _vk_swapchain_image_views;
-	std::vector<VkFramebuffer> _vk_swapchain_frame_buffers;
-	VkFormat _vk_swapchain_format;
-	VkExtent2D _vk_swapchain_extent;
+	VkSwapchainKHR _vk_swapchain = VK_NULL_HANDLE;
+	std::vector<VkImage> _vk_swapchain_images;  ///< The swapchain images - OWNED BY SWAPCHAIN, DO NOT DESTROY (headless: offscreen images, owned by us)
+	std::vector<GpuAllocation> _offscreen_image_allocations;
+	std::vector<VkImageView> _vk_swapchain_image_views;
+	std::vector<VkFramebuffer> _vk_swapchain_frame_buffers;
+	VkFormat _vk_swapchain_format;
+	VkExtent2D _vk_swapchain_extent;
+	bool _swapchain_resize_pending = false;	///< set by resize events and out of date results, consumed by the next Draw
+	std::vector<RetiredSwapchain> _retired_swapchains;
+	uint64_t _submission_serial = 0;	///< graphics submits so far, see FrameData::_submission
+	uint64_t _completed_submission = 0;	///< newest serial whose fence was waited for
+
+	QueueFamilies _available_queue_families;
+	VkQueue _vk_graphics_queue; ///< Queue of vk graphics - IMPLICITLY DESTROYED WITH DEVICE
+	VkQueue _vk_present_queue;
+	VkQueue _vk_transfer_queue;	///< same as the graphics queue without a dedicated transfer family
+
+	VkSampleCountFlagBits _vk_sample_count_flag_bits = VK_SAMPLE_COUNT_4_BIT;
+
+	VkRenderPass _vk_render_pass;
+
+	VkDescriptorSetLayout _vk_descriptor_set_layout;	///< set 0, the frame's buffers
+	TextureTable _texture_table;	///< set 1
+	uint32_t _texture_table_capacity = TEXTURE_TABLE_FALLBACK_CAPACITY;
+	uint32_t _texture_slot = 0;	///< _texture's slot in _texture_table
+
+	VkPipelineLayout _vk_pipeline_layout;
+	VkPipeline _vk_pipeline;	///< owned by _pipeline_registry
+	PipelineCache _pipeline_cache;
+	PipelineRegistry _pipeline_registry;
+	PipelineSlot _graphics_pipeline;	///< _vk_pipeline is its bound variant
+	PipelineSlot _cull_pipeline;	///< _vk_cull_pipeline is its bound variant
+	std::unordered_map<std::string, uint64_t> _shader_hashes;	///< spir-v file name to registry shader
+	uint32_t _pipeline_generation = 0;	///< bumped whenever a new variant is bound
+	std::string _pipeline_request_reason;	///< what the variants compiling right now are for
+	std::chrono::high_resolution_clock::time_point _pipeline_request_time;
+	double _shader_compile_seconds = 0.0;	///< glsl compile time of the reload the variants are for
+	ShaderReloader _shader_reloader;
+	bool _wireframe = false;
+	bool _wireframe_toggled = false;	///< set by the key callback, consumed by UpdatePipelines
+
+	VertexLayout _vertex_layout;
+	VertexDequantization _vertex_dequantization;
+
+	VkCommandPool _vk_command_pool;
+
+	TextureStreamer _texture_streamer;
+	TextureHandle _texture = 0;
+	bool _texture_compression_bc = false;	///< the device samples BC formats, enabled at device creation
+	bool _sampler_anisotropy = false;
+	bool _multi_draw_indirect = false;	///< all submeshes in one vkCmdDrawIndexedIndirect
+	bool _fill_mode_non_solid = false;	///< the wireframe variant can be built
+	bool _physical_device_properties2 = false;	///< the instance can query extended device features
+	bool _descriptor_indexing = false;	///< the texture table is partially bound and written after bind, instances index it freely
+	VkFormat _texture_format = VK_FORMAT_R8G8B8A8_UNORM;	///< fixed before the first Request, decode workers read it
+	bool _gpu_texture_mips = false;
+	VkSampler _vk_texture_sampler;
+
+	std::vector<Vertex> _vertices;	///< only filled while cooking
+	std::vector<uint16_t> _indices;
+	CookedMesh _cooked_mesh;
+	const Vertex* _p_mesh_vertices = nullptr;	///< into the cooked mesh mapping or _vertices, valid until ReleaseMeshData
+	const uint16_t* _p_mesh_indices = nullptr;
+	uint32_t _mesh_vertex_count = 0;
+	uint32_t _mesh_index_count = 0;
+	std::vector<Submesh> _submeshes;	///< kept for drawing after the mesh data is released
+	std::vector<BoundingBox> _submesh_bounds;	///< model space, one per submesh
+	glm::vec3 _mesh_bounds_min;
+	glm::vec3 _mesh_bounds_max;
+	VkBuffer _vk_vertex_buffer;
+	GpuAllocation _vertex_buffer_allocation;
+	VkBuffer _vk_instance_buffer;
+	GpuAllocation _instance_buffer_allocation;
+	std::vector<glm::mat4> _instance_models;	///< InstanceData::model of every instance, what UpdateTransforms multiplies
+	float _instance_view_scale = 1.0f;
+	BoundingVolumeHierarchy _cull_hierarchy;	///< one box per submesh of every instance, object id submesh * instance count + instance
+	Frustum _cull_frustum;	///< model space planes of the last UpdateUniformBuffer
+	std::vector<uint32_t> _visible_objects;
+	std::vector<uint8_t> _object_visible;	///< scratch, all zero between frames
+	std::vector<InstanceRange> _draw_ranges;	///< visible instances without gpu culling
+	std::vector<VkDrawIndexedIndirectCommand> _draw_list;	///< _draw_ranges as draw calls, what the recording slices split
+	std::unique_ptr<ThreadPool> _p_record_pool;	///< _record_threads threads including the render thread
+	VkBuffer _vk_instance_index_buffer;	///< identity, bound in place of the visible instances when the gpu does not cull
+	GpuAllocation _instance_index_buffer_allocation;
+	VkBuffer _vk_submesh_bounds_buffer = VK_NULL_HANDLE;	///< gpu culling only
+	GpuAllocation _submesh_bounds_buffer_allocation;
+	VkBuffer _vk_draw_command_template = VK_NULL_HANDLE;	///< gpu culling only - zero instance counts, copied over the frame's commands before culling
+	GpuAllocation _draw_command_template_allocation;
+	VkDescriptorSetLayout _vk_cull_descriptor_set_layout = VK_NULL_HANDLE;
+	VkPipelineLayout _vk_cull_pipeline_layout = VK_NULL_HANDLE;
+	VkPipeline _vk_cull_pipeline = VK_NULL_HANDLE;	///< owned by _pipeline_registry
+	VkBuffer _vk_index_buffer;
+	GpuAllocation _index_buffer_allocation;
+
+	VkBuffer _vk_uniform_buffer;	///< persistently mapped, one region per frame in flight
+	GpuAllocation _uniform_buffer_allocation;
+	UniformRing _uniform_ring;
+
+	VkImage _vk_color_image;	///< multisampled color target, resolved into the swapchain image
+	GpuAllocation _color_image_allocation;
+	VkImageView _vk_color_image_view;
+
+	VkImage _vk_depth_image;
+	GpuAllocation _depth_image_allocation;
+	VkImageView _vk_depth_image_view;
+
+	std::vector<VkCommandBuffer> _vk_command_buffers;
+
+	std::vector<FrameData> _frames;
+	uint32_t _current_frame = 0;
+
+	ApplicationSettings _settings;
+	FrameStatistics _statistics;
+
+	ThreadPool _thread_pool;	///< shared cpu workers for asset loading
+	DeviceMemoryAllocator _memory_allocator;
+	UploadManager _upload_manager;
+
+	FrameProfiler _profiler;
+	VkQueryPool _vk_timestamp_query_pool = VK_NULL_HANDLE;	///< two timestamps per frame in flight, only created when profiling
+	float _timestamp_period = 1.0f;
+
+#ifndef FORGE_NO_WINDOW
+	GLFWwindow* _p_glfw_window = nullptr;
+#endif
+	uint32_t _window_width;
+	uint32_t _window_height;
+	const char* _window_name;
+	// END PRIVATE MEMBERS
+};
+
+// renders a fixed number of headless frames with 1, 2 and 3 frames in flight and reports throughput
+int RunFramesInFlightBenchmark(uint32_t frame_count)
+{
+	for (uint32_t frames_in_flight = 1; frames_in_flight <= MAX_FRAMES_IN_FLIGHT; ++frames_in_flight)
+	{
+		ApplicationSettings settings;
+		settings._frames_in_flight = frames_in_flight;
+		settings._frame_limit = frame_count;
+		settings._headless = true;
+
+		HelloTriangleApplication app(settings);
+		app.Run();
+
+		const FrameStatistics& statistics = app.Statistics();
+		double frames_per_second = statistics._frame_count / statistics._elapsed_seconds;
+
+		std::cout << "frames in flight: " << frames_in_flight
+			<< " | frames: " << statistics._frame_count
+			<< " | " << frames_per_second << " fps"
+			<< " | " << 1000.0 / frames_per_second << " ms/frame" << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+// allocate/free throughput of the TLSF block sub-allocator under a random resource mix
+int RunAllocatorBenchmark()
+{
+	const uint64_t BLOCK_SIZE = DeviceMemoryAllocator::DEFAULT_BLOCK_SIZE;
+	const uint32_t OPERATIONS = 4000000;
+
+	struct Workload
+	{
+		const char* _name;
+		uint64_t _min_size;
+		uint64_t _max_size;
+		uint64_t _alignment;
+	};
+
+	const Workload workloads[] =
+	{
+		{ "uniform/small buffers", 256, 16 * 1024, 256 },
+		{ "vertex/index buffers", 16 * 1024, 1024 * 1024, 16 },
+		{ "textures", 64 * 1024, 4 * 1024 * 1024, 64 * 1024 },
+	};
+
+	for (const Workload& workload : workloads)
+	{
+		TlsfRangeAllocator ranges(BLOCK_SIZE);
+		std::vector<uint32_t> live;
+		live.reserve(OPERATIONS);
+
+		uint32_t seed = 12345;
+		auto next_random = [&seed]()
+		{
+			seed = seed * 1664525u + 1013904223u;
+			return seed >> 8;
+		};
+
+		uint64_t failed = 0;
+		uint64_t peak_used = 0;
+
+		auto start_time = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t i = 0; i < OPERATIONS; ++i)
+		{
+			// slightly allocation heavy until the block fills, then alloc/free churn
+			if (live.empty() || next_random() % 100 < 52)
+			{
+				uint64_t size = workload._min_size + next_random() % (workload._max_size - workload._min_size);
+				uint64_t offset;
+				uint32_t handle;
+
+				if (ranges.Allocate(size, workload._alignment, offset, handle))
+				{
+					live.push_back(handle);
+					peak_used = std::max(peak_used, ranges.UsedBytes());
+				}
+				else
+				{
+					++failed;
+				}
+			}
+			else
+			{
+				size_t index = next_random() % live.size();
+				ranges.Free(live[index]);
+				live[index] = live.back();
+				live.pop_back();
+			}
+		}
+
+		auto end_time = std::chrono::high_resolution_clock::now();
+		double seconds = std::chrono::duration<double, std::chrono::seconds::period>(end_time - start_time).count();
+
+		std::cout << workload._name
+			<< " | " << OPERATIONS / seconds / 1000000.0 << " M ops/s"
+			<< " | " << seconds * 1000000000.0 / OPERATIONS << " ns/op"
+			<< " | peak block use " << 100.0 * peak_used / BLOCK_SIZE << "%"
+			<< " | " << failed << " full" << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+// writes a grid mesh with positions, texcoords, normals and quad faces - about 170 bytes per grid vertex
+void WriteSyntheticObj(const std::string& path, uint32_t grid_size)
+{
+	FILE* p_file = fopen(path.c_str(), "wb");
+	if (p_file == nullptr)
+	{
+		throw std::runtime_error("Failed To Create Synthetic OBJ!");
+	}
+
+	std::vector<char> buffer(1 << 20);
+	setvbuf(p_file, buffer.data(), _IOFBF, buffer.size());
+
+	fprintf(p_file, "# synthetic benchmark grid %ux%u\no grid\n", grid_size, grid_size);
+
+	for (uint32_t y = 0; y < grid_size; ++y)
+	{
+		for (uint32_t x = 0; x < grid_size; ++x)
+		{
+			float u = x / static_cast<float>(grid_size - 1);
+			float v = y / static_cast<float>(grid_size - 1);
+			float height = 0.25f * sinf(u * 20.0f) * cosf(v * 20.0f);
+
+			fprintf(p_file, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n", u * 100.0f - 50.0f, height, v * 100.0f - 50.0f, u, v, -height, 1.0f, height);
+		}
+	}
+
+	for (uint32_t y = 0; y + 1 < grid_size; ++y)
+	{
+		for (uint32_t x = 0; x + 1 < grid_size; ++x)
+		{
+			uint32_t a = y * grid_size + x + 1;
+			uint32_t b = a + 1;
+			uint32_t c = b + grid_size;
+			uint32_t d = a + grid_size;
+
+			fprintf(p_file, "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c, d, d, d);
+		}
+	}
+
+	fclose(p_file);
+}
+
+// parses the bundled model and a large synthetic grid with tinyobj and with the threaded ObjLoader
+int RunObjLoaderBenchmark()
+{
+	const uint32_t SYNTHETIC_GRID_SIZE = 1000;
+	const uint32_t RUNS = 3;
+	const std::string synthetic_path = "benchmark_synthetic.obj";
+
+	std::cout << "writing " << synthetic_path << "..." << std::endl;
+	WriteSyntheticObj(synthetic_path, SYNTHETIC_GRID_SIZE);
+
+	ThreadPool thread_pool;
+	const std::string paths[] = { "Models/type-99.obj", synthetic_path };
+
+	for (const std::string& path : paths)
+	{
+		double file_megabytes;
+		{
+			MappedFile file(path);
+			if (!file.IsOpen())
+			{
+				throw std::runtime_error("Failed To Open OBJ File!");
+			}
+			file_megabytes = file.Size() / (1024.0 * 1024.0);
+		}
+
+		double tinyobj_seconds = std::numeric_limits<double>::max();
+		size_t tinyobj_index_count = 0;
+
+		for (uint32_t run = 0; run < RUNS; ++run)
+		{
+			tinyobj::attrib_t attribute;
+			std::vector<tinyobj::shape_t> shapes;
+			std::vector<tinyobj::material_t> materials;
+			std::string error;
+
+			auto start_time = std::chrono::high_resolution_clock::now();
+
+			if (!tinyobj::LoadObj(&attribute, &shapes, &materials, &error, path.c_str()))
+			{
+				throw std::runtime_error(error);
+			}
+
+			auto end_time = std::chrono::high_resolution_clock::now();
+			tinyobj_seconds = std::min(tinyobj_seconds, std::chrono::duration<double, std::chrono::seconds::period>(end_time - start_time).count());
+
+			tinyobj_index_count = 0;
+			for (const auto& shape : shapes)
+			{
+				tinyobj_index_count += shape.mesh.indices.size();
+			}
+		}
+
+		double loader_seconds = std::numeric_limits<double>::max();
+		size_t loader_index_count = 0;
+
+		for (uint32_t run = 0; run < RUNS; ++run)
+		{
+			auto start_time = std::chrono::high_resolution_clock::now();
+
+			ObjMesh mesh = ObjLoader::Load(path, thread_pool);
+
+			auto end_time = std::chrono::high_resolution_clock::now();
+			loader_seconds = std::min(loader_seconds, std::chrono::duration<double, std::chrono::seconds::period>(end_time - start_time).count());
+
+			loader_index_count = mesh._indices.size();
+		}
+
+		if (loader_index_count != tinyobj_index_count)
+		{
+			std::cerr << path << ": index count mismatch, tinyobj " << tinyobj_index_count << " vs " << loader_index_count << std::endl;
+		}
+
+		std::cout << path << " (" << file_megabytes << " MB, " << loader_index_count / 3 << " triangles)" << std::endl;
+		std::cout << "  tinyobj   | " << tinyobj_seconds * 1000.0 << " ms | " << file_megabytes / tinyobj_seconds << " MB/s" << std::endl;
+		std::cout << "  ObjLoader | " << loader_seconds * 1000.0 << " ms | " << file_megabytes / loader_seconds << " MB/s | "
+			<< thread_pool.ThreadCount() << " threads | " << tinyobj_seconds / loader_seconds << "x" << std::endl;
+	}
+
+	remove(synthetic_path.c_str());
+
+	return EXIT_SUCCESS;
+}
+
+// live and peak byte counts shared by every rebound copy of a CountingAllocator
+struct AllocationCounter
+{
+	size_t _current_bytes = 0;
+	size_t _peak_bytes = 0;
+};
+
+// lets the dedup benchmark measure what the node based std::unordered_map really allocates
+template<typename T>
+struct CountingAllocator
+{
+	typedef T value_type;
+
+	explicit CountingAllocator(AllocationCounter* p_counter) : _p_counter(p_counter) {}
+
+	template<typename U>
+	CountingAllocator(const CountingAllocator<U>& other) : _p_counter(other._p_counter) {}
+
+	T* allocate(size_t count)
+	{
+		_p_counter->_current_bytes += count * sizeof(T);
+		_p_counter->_peak_bytes = std::max(_p_counter->_peak_bytes, _p_counter->_current_bytes);
+		return static_cast<T*>(::operator new(count * sizeof(T)));
+	}
+
+	void deallocate(T* p, size_t count)
+	{
+		_p_counter->_current_bytes -= count * sizeof(T);
+		::operator delete(p);
+	}
+
+	template<typename U>
+	bool operator ==(const CountingAllocator<U>& other) const
+	{
+		return _p_counter == other._p_counter;
+	}
+
+	template<typename U>
+	bool operator !=(const CountingAllocator<U>& other) const
+	{
+		return _p_counter != other._p_counter;
+	}
+
+	AllocationCounter* _p_counter;
+};
+
+// dedups the bundled model and a synthetic grid with the old std::unordered_map, the flat table and the sharded table
+int RunDedupBenchmark()
+{
+	const uint32_t SYNTHETIC_GRID_SIZE = 1500;
+	const uint32_t RUNS = 3;
+
+	ThreadPool thread_pool;
+
+	std::vector<std::pair<std::string, ObjMesh>> meshes;
+	meshes.emplace_back("Models/type-99.obj", ObjLoader::Load("Models/type-99.obj", thread_pool));
+
+	// same layout as WriteSyntheticObj, built in memory since only the dedup is timed
+	ObjMesh grid;
+	for (uint32_t y = 0; y < SYNTHETIC_GRID_SIZE; ++y)
+	{
+		for (uint32_t x = 0; x < SYNTHETIC_GRID_SIZE; ++x)
+		{
+			float u = x / static_cast<float>(SYNTHETIC_GRID_SIZE - 1);
+			float v = y / static_cast<float>(SYNTHETIC_GRID_SIZE - 1);
+
+			grid._positions.insert(grid._positions.end(), { u * 100.0f - 50.0f, 0.25f * sinf(u * 20.0f) * cosf(v * 20.0f), v * 100.0f - 50.0f });
+			grid._texcoords.insert(grid._texcoords.end(), { u, v });
+		}
+	}
+
+	for (int32_t y = 0; y + 1 < static_cast<int32_t>(SYNTHETIC_GRID_SIZE); ++y)
+	{
+		for (int32_t x = 0; x + 1 < static_cast<int32_t>(SYNTHETIC_GRID_SIZE); ++x)
+		{
+			int32_t a = y * SYNTHETIC_GRID_SIZE + x;
+			int32_t b = a + 1;
+			int32_t c = b + SYNTHETIC_GRID_SIZE;
+			int32_t d = a + SYNTHETIC_GRID_SIZE;
+
+			for (int32_t corner : { a, b, c, a, c, d })
+			{
+				grid._indices.push_back({ corner, corner, -1 });
+			}
+		}
+	}
+
+	meshes.emplace_back("synthetic grid", std::move(grid));
+
+	for (const auto& named_mesh : meshes)
+	{
+		const ObjMesh& mesh = named_mesh.second;
+		const size_t corner_count = mesh._indices.size();
+
+		auto MakeVertex = [&mesh](size_t corner)
+		{
+			return Vertex::FromObj(mesh, mesh._indices[corner]);
+		};
+
+		double map_seconds = std::numeric_limits<double>::max();
+		size_t map_peak_bytes = 0;
+		std::vector<Vertex> map_vertices;
+		std::vector<uint32_t> map_indices;
+
+		for (uint32_t run = 0; run < RUNS; ++run)
+		{
+			AllocationCounter counter;
+			std::vector<Vertex> vertices;
+			std::vector<uint32_t> indices;
+
+			auto start_time = std::chrono::high_resolution_clock::now();
+
+			// the cooking loop this table replaced, kept verbatim as the reference
+			{
+				std::unordered_map<Vertex, uint32_t, std::hash<Vertex>, std::equal_to<Vertex>, CountingAllocator<std::pair<const Vertex, uint32_t>>> unique_vertices(
+					0, std::hash<Vertex>(), std::equal_to<Vertex>(), CountingAllocator<std::pair<const Vertex, uint32_t>>(&counter));
+
+				for (size_t corner = 0; corner < corner_count; ++corner)
+				{
+					Vertex vert = MakeVertex(corner);
+
+					if (unique_vertices.count(vert) == 0)
+					{
+						unique_vertices[vert] = static_cast<uint32_t>(vertices.size());
+						vertices.push_back(vert);
+					}
+
+					indices.push_back(unique_vertices[vert]);
+				}
+
+				map_peak_bytes = counter._peak_bytes + vertices.capacity() * sizeof(Vertex);
+			}
+
+			auto end_time = std::chrono::high_resolution_clock::now();
+			map_seconds = std::min(map_seconds, std::chrono::duration<double, std::chrono::seconds::period>(end_time - start_time).count());
+
+			map_vertices = std::move(vertices);
+			map_indices = std::move(indices);
+		}
+
+		std::cout << named_mesh.first << " (" << corner_count << " corners, " << map_vertices.size() << " unique vertices)" << std::endl;
+
+		auto Report = [&](const char* p_name, double seconds, size_t peak_bytes)
+		{
+			std::cout << "  " << p_name << " | " << seconds * 1000.0 << " ms | " << corner_count / seconds / 1000000.0 << " M corners/s | "
+				<< peak_bytes / (1024.0 * 1024.0) << " MB peak | " << map_seconds / seconds << "x" << std::endl;
+		};
+
+		Report("unordered_map", map_seconds, map_peak_bytes);
+
+		for (uint32_t mode = 0; mode < 2; ++mode)
+		{
+			double seconds = std::numeric_limits<double>::max();
+			size_t peak_bytes = 0;
+			std::vector<Vertex> vertices;
+			std::vector<uint32_t> indices;
+
+			for (uint32_t run = 0; run < RUNS; ++run)
+			{
+				auto start_time = std::chrono::high_resolution_clock::now();
+
+				if (mode == 0)
+				{
+					VertexDeduplicator::Deduplicate(corner_count, MakeVertex, vertices, indices, &peak_bytes);
+				}
+				else
+				{
+					VertexDeduplicator::DeduplicateParallel(corner_count, MakeVertex, thread_pool, vertices, indices, &peak_bytes);
+				}
+
+				auto end_time = std::chrono::high_resolution_clock::now();
+				seconds = std::min(seconds, std::chrono::duration<double, std::chrono::seconds::period>(end_time - start_time).count());
+			}
+
+			// the map numbers vertices in first use order too, any difference is a bug
+			if (indices != map_indices || vertices.size() != map_vertices.size() ||
+				memcmp(vertices.data(), map_vertices.data(), vertices.size() * sizeof(Vertex)) != 0)
+			{
+				std::cerr << named_mesh.first << ": dedup output differs from the unordered_map" << std::endl;
+			}
+
+			Report(mode == 0 ? "flat table   " : "sharded      ", seconds, peak_bytes);
+		}
+
+		std::cout << "  sharded mode ran on " << thread_pool.ThreadCount() << " threads" << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+// creates the pipeline with no cache file, then twice from the file the previous run saved
+int RunPipelineCacheBenchmark()
+{
+	remove(PIPELINE_CACHE_PATH);
+
+	for (uint32_t run = 0; run < 3; ++run)
+	{
+		ApplicationSettings settings;
+		settings._frame_limit = 1;
+		settings._headless = true;
+
+		HelloTriangleApplication app(settings);
+		app.Run();
+
+		const FrameStatistics& statistics = app.Statistics();
+
+		std::cout << (statistics._pipeline_cache_loaded ? "warm" : "cold") << " pipeline cache | "
+			<< statistics._pipeline_creation_seconds.front() * 1000.0 << " ms" << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+// renders the bundled model and a 2M triangle grid with every vertex layout and reports buffer size and frame time
+int RunVertexLayoutBenchmark(uint32_t frame_count)
+{
+	const uint32_t SYNTHETIC_GRID_SIZE = 1000;
+	const std::string synthetic_path = "benchmark_synthetic.obj";
+
+	WriteSyntheticObj(synthetic_path, SYNTHETIC_GRID_SIZE);
+
+	struct LayoutConfiguration
+	{
+		const char* _p_name;
+		AttributeEncoding _position_encoding;
+		AttributeEncoding _texcoord_encoding;
+		bool _color;
+	};
+
+	const LayoutConfiguration configurations[] =
+	{
+		{ "float + color", AttributeEncoding::Float32, AttributeEncoding::Float32, true },
+		{ "float        ", AttributeEncoding::Float32, AttributeEncoding::Float32, false },
+		{ "half         ", AttributeEncoding::Half, AttributeEncoding::Half, false },
+		{ "unorm16      ", AttributeEncoding::Unorm16, AttributeEncoding::Unorm16, false },
+	};
+
+	for (const std::string& path : { std::string("Models/type-99.obj"), synthetic_path })
+	{
+		std::cout << path << std::endl;
+
+		for (const LayoutConfiguration& configuration : configurations)
+		{
+			ApplicationSettings settings;
+			settings._frame_limit = frame_count;
+			settings._headless = true;
+			settings._model_path = path;
+			settings._position_encoding = configuration._position_encoding;
+			settings._texcoord_encoding = configuration._texcoord_encoding;
+			settings._vertex_color = configuration._color;
+
+			HelloTriangleApplication app(settings);
+			app.Run();
+
+			const FrameStatistics& statistics = app.Statistics();
+			uint64_t vertex_count = statistics._vertex_buffer_bytes / statistics._vertex_stride;
+
+			std::cout << "  " << configuration._p_name << " | " << statistics._vertex_stride << " B/vertex | "
+				<< statistics._vertex_buffer_bytes / (1024.0 * 1024.0) << " MB (" << sizeof(Vertex) * vertex_count / (1024.0 * 1024.0) << " MB as 32 byte Vertex) | "
+				<< 1000.0 * statistics._elapsed_seconds / statistics._frame_count << " ms/frame" << std::endl;
+		}
+	}
 
-	QueueFamilies _available_queue_families;
-	VkQueue _vk_graphics_queue; ///< Queue of vk graphics - IMPLICITLY DESTROYED WITH DEVICE
-	VkQueue _vk_present_queue;
+	remove(synthetic_path.c_str());
+	remove((synthetic_path + ".cooked").c_str());
 
-	VkSampleCountFlagBits _vk_sample_count_flag_bits = VK_SAMPLE_COUNT_4_BIT;
+	return EXIT_SUCCESS;
+}
 
-	VkRenderPass _vk_render_pass;
+// one instanced draw against one draw per instance, headless - the bundled model up to 10k copies,
+// a 98 triangle synthetic grid up to 100k where per draw overhead dominates
+int RunInstancingBenchmark(uint32_t frame_count)
+{
+	const uint32_t SYNTHETIC_GRID_SIZE = 8;
+	const std::string synthetic_path = "benchmark_instancing.obj";
 
-	VkDescriptorSetLayout _vk_descriptor_set_layout;
-	VkDescriptorPool _vk_descriptor_pool;
-	VkDescriptorSet _vk_descriptor_set; ///< IMPLICITLY DESTROYED BY POOL
+	WriteSyntheticObj(synthetic_path, SYNTHETIC_GRID_SIZE);
 
-	VkPipelineLayout _vk_pipeline_layout;
-	VkPipeline _vk_pipeline;
+	struct Series
+	{
+		std::string _path;
+		uint32_t _max_instances;
+	};
 
-	VkCommandPool _vk_command_pool;
+	const Series series[] = { { "Models/type-99.obj", 10000 }, { synthetic_path, 100000 } };
 
-	VkBuffer _vk_uniform_buffer;
-	VkDeviceMemory _vk_uniform_buffer_memory;
+	for (const Series& current : series)
+	{
+		std::cout << current._path << std::endl;
 
-	VkImage _vk_texture_image;
-	VkDeviceMemory _vk_texture_image_memory;
-	VkImageView _vk_texture_image_view;
-	VkSampler _vk_texture_sampler;
+		for (uint32_t instance_count = 1; instance_count <= current._max_instances; instance_count *= 10)
+		{
+			for (bool instanced : { true, false })
+			{
+				ApplicationSettings settings;
+				settings._frame_limit = frame_count;
+				settings._headless = true;
+				settings._model_path = current._path;
+				settings._async_textures = false;
+				settings._instance_count = instance_count;
+				settings._instanced_draws = instanced;
+
+				HelloTriangleApplication app(settings);
+				app.Run();
+
+				const FrameStatistics& statistics = app.Statistics();
+				double seconds_per_frame = statistics._elapsed_seconds / statistics._frame_count;
+
+				std::cout << "  " << instance_count << " instances | " << (instanced ? "instanced   " : "per instance") << " | "
+					<< 1000.0 * seconds_per_frame << " ms/frame | " << statistics._triangles_per_frame / seconds_per_frame / 1e6 << " M triangles/s" << std::endl;
+			}
+		}
+	}
 
-	std::vector<Vertex> _vertices;
-	std::vector<uint32_t> _indices;
-	VkBuffer _vk_vertex_buffer;
-	VkDeviceMemory _vk_vertex_buffer_memory;
-	VkBuffer _vk_index_buffer;
-	VkDeviceMemory _vk_index_buffer_memory;
+	remove(synthetic_path.c_str());
+	remove((synthetic_path + ".cooked").c_str());
 
-	VkImage _vk_depth_image;
-	VkDeviceMemory _vk_depth_image_memory;
-	VkImageView _vk_depth_image_view;
+	return EXIT_SUCCESS;
+}
 
-	std::vector<VkCommandBuffer> _vk_command_buffers;
+// scalar, simd and bvh frustum tests over 1M random boxes, from a camera turning around the middle of the cloud
+int RunCullingBenchmark()
+{
+	const uint32_t BOX_COUNT = 1000000;
+	const uint32_t VIEW_COUNT = 32;
+	const float WORLD_SIZE = 1000.0f;
 
-	VkSemaphore _vk_image_available_semaphore;
-	VkSemaphore _vk_frame_complete_semaphore;
+	uint32_t seed = 12345;
+	auto next_random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / static_cast<float>(1 << 24);
+	};
 
-	GLFWwindow* _p_glfw_window;
-	uint32_t _window_width;
-	uint32_t _window_height;
-	char* _window_name;
-	// END PRIVATE MEMBERS
-};
+	std::vector<BoundingBox> boxes(BOX_COUNT);
+	for (BoundingBox& box : boxes)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			box._center[axis] = (next_random() - 0.5f) * WORLD_SIZE;
+			box._extent[axis] = 0.25f + 2.0f * next_random();
+		}
+	}
+
+	BoundingBoxArray box_array;
+	box_array.Assign(boxes.data(), boxes.size());
+
+	auto build_start = std::chrono::high_resolution_clock::now();
+	BoundingVolumeHierarchy hierarchy;
+	hierarchy.Build(boxes.data(), BOX_COUNT);
+	double build_seconds = std::chrono::duration<double, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - build_start).count();
+
+	std::cout << BOX_COUNT << " boxes | bvh build " << build_seconds * 1000.0 << " ms | " << hierarchy.NodeCount() << " nodes" << std::endl;
+
+	std::vector<Frustum> frustums;
+	for (uint32_t view = 0; view < VIEW_COUNT; ++view)
+	{
+		float angle = glm::radians(360.0f) * view / VIEW_COUNT;
+		glm::mat4 view_matrix = glm::lookAt(glm::vec3(0.0f), glm::vec3(std::cos(angle), 0.25f * std::sin(3.0f * angle), std::sin(angle)), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 proj_matrix = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 0.5f * WORLD_SIZE);
+		frustums.push_back(Frustum::FromMatrix(glm::value_ptr(proj_matrix * view_matrix)));
+	}
+
+	std::vector<uint32_t> visible;
+	visible.reserve(BOX_COUNT);
+
+	const char* const names[] = { "scalar", "simd", "bvh" };
+	for (int method = 0; method < 3; ++method)
+	{
+		uint64_t visible_total = 0;
+
+		auto start_time = std::chrono::high_resolution_clock::now();
+
+		for (const Frustum& frustum : frustums)
+		{
+			visible.clear();
+
+			if (method == 0)
+			{
+				for (uint32_t i = 0; i < BOX_COUNT; ++i)
+				{
+					if (frustum.Intersects(boxes[i]))
+					{
+						visible.push_back(i);
+					}
+				}
+			}
+			else if (method == 1)
+			{
+				FrustumCuller::Cull(frustum, box_array, visible);
+			}
+			else
+			{
+				hierarchy.Cull(frustum, visible);
+			}
+
+			visible_total += visible.size();
+		}
+
+		auto end_time = std::chrono::high_resolution_clock::now();
+		double seconds = std::chrono::duration<double, std::chrono::seconds::period>(end_time - start_time).count() / VIEW_COUNT;
+
+		std::cout << names[method]
+			<< " | " << seconds * 1000.0 << " ms/cull"
+			<< " | " << BOX_COUNT / seconds / 1000000.0 << " M boxes/s"
+			<< " | " << visible_total / VIEW_COUNT << " visible" << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+AttributeEncoding ParseAttributeEncoding(const std::string& name)
+{
+	if (name == "float")
+	{
+		return AttributeEncoding::Float32;
+	}
+	else if (name == "unorm16")
+	{
+		return AttributeEncoding::Unorm16;
+	}
+	else if (name == "half")
+	{
+		return AttributeEncoding::Half;
+	}
+
+	throw std::runtime_error("Unknown Vertex Encoding!");
+}
+
+// headless frame time with culling off, on the cpu and on the gpu - 10k copies of a small grid, so per instance
+// work dominates, the visible triangle counts of the cpu and gpu passes should roughly agree
+int RunCullingModesBenchmark(uint32_t frame_count)
+{
+	const uint32_t SYNTHETIC_GRID_SIZE = 8;
+	const uint32_t INSTANCE_COUNT = 10000;
+	const std::string synthetic_path = "benchmark_culling.obj";
+
+	WriteSyntheticObj(synthetic_path, SYNTHETIC_GRID_SIZE);
+
+	const CullingMode modes[] = { CullingMode::None, CullingMode::Cpu, CullingMode::Gpu };
+	const char* const names[] = { "none", "cpu ", "gpu " };
+
+	for (int mode = 0; mode < 3; ++mode)
+	{
+		ApplicationSettings settings;
+		settings._frame_limit = frame_count;
+		settings._headless = true;
+		settings._model_path = synthetic_path;
+		settings._async_textures = false;
+		settings._instance_count = INSTANCE_COUNT;
+		settings._culling = modes[mode];
+
+		HelloTriangleApplication app(settings);
+		app.Run();
+
+		const FrameStatistics& statistics = app.Statistics();
+		double seconds_per_frame = statistics._elapsed_seconds / statistics._frame_count;
+
+		std::cout << names[mode] << " | " << 1000.0 * seconds_per_frame << " ms/frame | "
+			<< statistics._visible_triangles << " of " << statistics._triangles_per_frame << " triangles visible" << std::endl;
+	}
+
+	remove(synthetic_path.c_str());
+	remove((synthetic_path + ".cooked").c_str());
+
+	return EXIT_SUCCESS;
+}
+
+// per frame recording cost against recording threads - 20k single instance draws of a small grid, culled on the cpu
+// in every run so the draw lists match, 0 threads records the primary inline
+int RunRecordingBenchmark(uint32_t frame_count)
+{
+	const uint32_t SYNTHETIC_GRID_SIZE = 8;
+	const uint32_t INSTANCE_COUNT = 20000;
+	const std::string synthetic_path = "benchmark_recording.obj";
+
+	WriteSyntheticObj(synthetic_path, SYNTHETIC_GRID_SIZE);
+
+	for (uint32_t record_threads : { 0u, 1u, 2u, 4u, 8u })
+	{
+		ApplicationSettings settings;
+		settings._frame_limit = frame_count;
+		settings._headless = true;
+		settings._model_path = synthetic_path;
+		settings._async_textures = false;
+		settings._instance_count = INSTANCE_COUNT;
+		settings._instanced_draws = false;
+		settings._culling = CullingMode::Cpu;
+		settings._record_threads = record_threads;
+
+		HelloTriangleApplication app(settings);
+		app.Run();
+
+		const FrameStatistics& statistics = app.Statistics();
+
+		std::cout << record_threads << " threads | " << 1000.0 * statistics._record_seconds / statistics._frame_count << " ms recording/frame | "
+			<< 1000.0 * statistics._elapsed_seconds / statistics._frame_count << " ms/frame" << std::endl;
+	}
+
+	remove(synthetic_path.c_str());
+	remove((synthetic_path + ".cooked").c_str());
+
+	return EXIT_SUCCESS;
+}
+
+// per instance mvps on the cpu against the matrix chain in the vertex shader - first the batch kernel alone over 1M
+// matrices, then headless frames of the bundled model with gpu timestamps, so the cpu cost of the transforms and
+// of every draw can be set against what the vertex shader saves
+int RunTransformBenchmark(uint32_t frame_count)
+{
+	const uint32_t MATRIX_COUNT = 1000000;
+	const uint32_t REPEAT_COUNT = 8;
+	const std::string profile_path = "benchmark_transforms.csv";
+
+	uint32_t seed = 12345;
+	auto next_random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / static_cast<float>(1 << 24);
+	};
+
+	std::vector<glm::mat4> models(MATRIX_COUNT);
+	for (glm::mat4& model : models)
+	{
+		model = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(next_random(), next_random(), next_random()) * 100.0f), next_random() * 6.28f, glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+
+	glm::mat4 view_proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 500.0f) * glm::lookAt(glm::vec3(0.0f, 70.0f, 150.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	std::vector<glm::mat4> reference(MATRIX_COUNT);
+	std::vector<glm::mat4> products(MATRIX_COUNT);
+
+	std::cout << MATRIX_COUNT << " matrices | " << MatrixBatch::PathName() << " kernel" << std::endl;
+
+	const char* const names[] = { "glm   ", "scalar", "simd  " };
+	for (int method = 0; method < 3; ++method)
+	{
+		std::vector<glm::mat4>& output = method == 0 ? reference : products;
+
+		auto start_time = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t repeat = 0; repeat < REPEAT_COUNT; ++repeat)
+		{
+			if (method == 0)
+			{
+				for (uint32_t i = 0; i < MATRIX_COUNT; ++i)
+				{
+					output[i] = view_proj * models[i];
+				}
+			}
+			else if (method == 1)
+			{
+				MatrixBatch::MultiplyScalar(glm::value_ptr(view_proj), glm::value_ptr(models[0]), glm::value_ptr(output[0]), MATRIX_COUNT);
+			}
+			else
+			{
+				MatrixBatch::Multiply(glm::value_ptr(view_proj), glm::value_ptr(models[0]), glm::value_ptr(output[0]), MATRIX_COUNT);
+			}
+		}
+
+		double seconds = std::chrono::duration<double, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - start_time).count() / REPEAT_COUNT;
+
+		// the kernels have to agree with glm up to rounding
+		float max_error = 0.0f;
+		for (uint32_t i = 0; i < MATRIX_COUNT && method != 0; ++i)
+		{
+			for (int element = 0; element < 16; ++element)
+			{
+				max_error = std::max(max_error, std::abs(glm::value_ptr(products[i])[element] - glm::value_ptr(reference[i])[element]));
+			}
+		}
+
+		std::cout << "  " << names[method] << " | " << seconds * 1000.0 << " ms | " << seconds * 1e9 / MATRIX_COUNT << " ns/matrix | max error " << max_error << std::endl;
+	}
+
+	for (uint32_t instance_count : { 1000u, 10000u })
+	{
+		std::cout << instance_count << " instances" << std::endl;
+
+		for (bool instanced : { true, false })
+		{
+			for (bool cpu_transforms : { false, true })
+			{
+				ApplicationSettings settings;
+				settings._frame_limit = frame_count;
+				settings._headless = true;
+				settings._async_textures = false;
+				settings._instance_count = instance_count;
+				settings._instanced_draws = instanced;
+				settings._cpu_transforms = cpu_transforms;
+				settings._profile_output = profile_path;
+
+				HelloTriangleApplication app(settings);
+				app.Run();
+
+				const FrameStatistics& statistics = app.Statistics();
+				double gpu_seconds = statistics._gpu_frame_count > 0 ? statistics._gpu_seconds / statistics._gpu_frame_count : 0.0;
+
+				std::cout << "  " << (instanced ? "instanced   " : "per instance") << " | " << (cpu_transforms ? "cpu mvp" : "gpu mvp") << " | "
+					<< 1000.0 * statistics._elapsed_seconds / statistics._frame_count << " ms/frame | "
+					<< 1000.0 * statistics._transform_seconds / statistics._frame_count << " ms transforms/frame | "
+					<< 1000.0 * statistics._record_seconds / statistics._frame_count << " ms recording/frame | "
+					<< 1000.0 * gpu_seconds << " ms gpu/frame" << std::endl;
+			}
+		}
+	}
+
+	remove(profile_path.c_str());
+
+	return EXIT_SUCCESS;
+}
+
+CullingMode ParseCullingMode(const std::string& name)
+{
+	if (name == "none")
+	{
+		return CullingMode::None;
+	}
+	else if (name == "cpu")
+	{
+		return CullingMode::Cpu;
+	}
+	else if (name == "gpu")
+	{
+		return CullingMode::Gpu;
+	}
+
+	throw std::runtime_error("Unknown Culling Mode!");
+}
+
+// unsigned decimal, anything else is an error instead of a partial parse
+uint32_t ParseCount(const std::string& text)
+{
+	if (text.empty() || text.size() > 9 || text.find_first_not_of("0123456789") != std::string::npos)
+	{
+		throw std::runtime_error("Invalid Number Argument!");
+	}
+
+	return static_cast<uint32_t>(std::stoul(text));
+}
+
+// the value following argv[i], a value flag at the end of the line is an error rather than ignored
+const char* ArgumentValue(int argc, char** argv, int& i)
+{
+	if (i + 1 >= argc)
+	{
+		throw std::runtime_error("Missing Value For " + std::string(argv[i]) + "!");
+	}
+
+	return argv[++i];
+}
+
+// throws on unknown flags, missing and malformed values, main reports it like any other startup error
+void ParseArguments(int argc, char** argv, ApplicationSettings& settings, std::string& benchmark)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+
+		if (argument == "--frames-in-flight")
+		{
+			settings._frames_in_flight = ParseCount(ArgumentValue(argc, argv, i));
+		}
+		else if (argument == "--frames")
+		{
+			settings._frame_limit = ParseCount(ArgumentValue(argc, argv, i));
+		}
+		else if (argument == "--headless")
+		{
+			settings._headless = true;
+		}
+		else if (argument == "--readback")
+		{
+			settings._readback_directory = ArgumentValue(argc, argv, i);
+		}
+		else if (argument == "--profile")
+		{
+			settings._profile_output = ArgumentValue(argc, argv, i);
+		}
+		else if (argument == "--memory-stats")
+		{
+			settings._print_memory_statistics = true;
+		}
+		else if (argument == "--model")
+		{
+			settings._model_path = ArgumentValue(argc, argv, i);
+		}
+		else if (argument == "--position-encoding")
+		{
+			settings._position_encoding = ParseAttributeEncoding(ArgumentValue(argc, argv, i));
+		}
+		else if (argument == "--texcoord-encoding")
+		{
+			settings._texcoord_encoding = ParseAttributeEncoding(ArgumentValue(argc, argv, i));
+		}
+		else if (argument == "--vertex-color")
+		{
+			settings._vertex_color = true;
+		}
+		else if (argument == "--cpu-mips")
+		{
+			settings._cpu_mip_generation = true;
+		}
+		else if (argument == "--instances")
+		{
+			settings._instance_count = std::max(1u, ParseCount(ArgumentValue(argc, argv, i)));
+		}
+		else if (argument == "--record-threads")
+		{
+			settings._record_threads = ParseCount(ArgumentValue(argc, argv, i));
+		}
+		else if (argument == "--culling")
+		{
+			settings._culling = ParseCullingMode(ArgumentValue(argc, argv, i));
+		}
+		else if (argument == "--hot-reload")
+		{
+			settings._shader_hot_reload = true;
+		}
+		else if (argument == "--wireframe")
+		{
+			settings._wireframe = true;
+		}
+		else if (argument == "--gpu-transforms")
+		{
+			settings._cpu_transforms = false;
+		}
+		else if (argument == "--sync-textures")
+		{
+			settings._async_textures = false;
+		}
+		else if (argument == "--texture-compression")
+		{
+			settings._texture_compression = ArgumentValue(argc, argv, i);
+
+			if (settings._texture_compression != "bc7" && settings._texture_compression != "bc3" && settings._texture_compression != "bc1" &&
+				settings._texture_compression != "none")
+			{
+				throw std::runtime_error("Unknown Texture Compression!");
+			}
+		}
+		else if (argument == "--benchmark")
+		{
+			benchmark = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : "frames";
+		}
+		else
+		{
+			throw std::runtime_error("Unknown Argument " + argument + "!");
+		}
+	}
+
+	// only offscreen frames are read back, a windowed run would silently write nothing
+	if (!settings._readback_directory.empty() && !settings._headless)
+	{
+		throw std::runtime_error("--readback Requires --headless!");
+	}
+
+	// a headless run has no window to close
+	if (settings._headless && settings._frame_limit == 0)
+	{
+		settings._frame_limit = 1;
+	}
+}
 
-int main()
+int main(int argc, char** argv)
 {
-	HelloTriangleApplication* p_app = new HelloTriangleApplication();
+	ApplicationSettings settings;
+	std::string benchmark;
 
 	try
 	{
-		p_app->Run();
+		ParseArguments(argc, argv, settings, benchmark);
+
+		if (benchmark == "frames")
+		{
+			return RunFramesInFlightBenchmark(settings._frame_limit != 0 ? settings._frame_limit : 2000);
+		}
+		else if (benchmark == "allocator")
+		{
+			return RunAllocatorBenchmark();
+		}
+		else if (benchmark == "obj")
+		{
+			return RunObjLoaderBenchmark();
+		}
+		else if (benchmark == "dedup")
+		{
+			return RunDedupBenchmark();
+		}
+		else if (benchmark == "pipeline")
+		{
+			return RunPipelineCacheBenchmark();
+		}
+		else if (benchmark == "vertex-layout")
+		{
+			return RunVertexLayoutBenchmark(settings._frame_limit != 0 ? settings._frame_limit : 500);
+		}
+		else if (benchmark == "instancing")
+		{
+			return RunInstancingBenchmark(settings._frame_limit != 0 ? settings._frame_limit : 100);
+		}
+		else if (benchmark == "culling")
+		{
+			return RunCullingBenchmark();
+		}
+		else if (benchmark == "culling-modes")
+		{
+			return RunCullingModesBenchmark(settings._frame_limit != 0 ? settings._frame_limit : 100);
+		}
+		else if (benchmark == "recording")
+		{
+			return RunRecordingBenchmark(settings._frame_limit != 0 ? settings._frame_limit : 100);
+		}
+		else if (benchmark == "transforms")
+		{
+			return RunTransformBenchmark(settings._frame_limit != 0 ? settings._frame_limit : 100);
+		}
+		else if (!benchmark.empty())
+		{
+			throw std::runtime_error("Unknown Benchmark!");
+		}
+
+		HelloTriangleApplication app(settings);
+		app.Run();
 	}
-	catch (const std::runtime_error& e)
+	catch (const std::exception& e)
 	{
 		std::cerr << e.what() << std::endl;
 		return EXIT_FAILURE;